@@ -240,6 +240,66 @@ VLC_API int filter_Blend( filter_t *, picture_t *p_dst, int i_dst_x, int i_dst_y
  */
 VLC_API void filter_DeleteBlend( filter_t * );
 
+/**
+ * Slice callback for filter_ProcessSlices().
+ *
+ * \param slice index of the slice to process, from 0 to count - 1
+ * \param count number of slices the picture is split into
+ */
+typedef void (*filter_slice_cb_t)(void *opaque, unsigned slice, unsigned count);
+
+/**
+ * It processes a picture as horizontal slices, in parallel.
+ *
+ * The callback is invoked once per slice, from the calling thread and from
+ * a pool of worker threads shared by all the filters of the instance. It
+ * returns once all the slices have been processed.
+ *
+ * A slice must only write its own lines (see filter_GetSlice()), but it
+ * may read lines of the neighbouring slices from the input picture.
+ * The number of slices depends on the number of CPUs and on the height of
+ * the picture; it can be 1, notably if the workers are already in use.
+ *
+ * \param lines number of lines of the tallest plane
+ */
+VLC_API void filter_ProcessSlices( filter_t *, unsigned lines,
+                                   filter_slice_cb_t, void *opaque );
+
+/**
+ * It computes the lines [*pi_begin, *pi_end[ of a slice of a plane.
+ *
+ * \param i_lines number of lines of the plane
+ * \param i_align boundaries between slices are multiple of this value
+ */
+static inline void filter_GetSlice( unsigned i_lines, unsigned i_slice,
+                                    unsigned i_count, unsigned i_align,
+                                    unsigned *pi_begin, unsigned *pi_end )
+{
+    unsigned i_begin = (uint64_t)i_lines * i_slice / i_count;
+    unsigned i_end = (uint64_t)i_lines * (i_slice + 1) / i_count;
+
+    *pi_begin = i_slice > 0 ? i_begin - i_begin % i_align : 0;
+    *pi_end = i_slice + 1 < i_count ? i_end - i_end % i_align : i_lines;
+}
+
+/**
+ * It restricts a plane to the visible lines of a slice.
+ *
+ * This allows functions working on whole planes to process one slice.
+ */
+static inline void plane_Slice( plane_t *p_slice, const plane_t *p_plane,
+                                unsigned i_slice, unsigned i_count )
+{
+    unsigned i_begin, i_end;
+
+    filter_GetSlice( p_plane->i_visible_lines, i_slice, i_count, 1,
+                     &i_begin, &i_end );
+    *p_slice = *p_plane;
+    p_slice->p_pixels += i_begin * p_plane->i_pitch;
+    p_slice->i_lines -= i_begin;
+    p_slice->i_visible_lines = i_end - i_begin;
+}
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
@@ -153,6 +153,8 @@ enum stream_query_e
     STREAM_GET_META,        /**< arg1= vlc_meta_t *       res=can fail */
     STREAM_GET_CONTENT_TYPE,    /**< arg1= char **         res=can fail */
     STREAM_GET_SIGNAL,      /**< arg1=double *pf_quality, arg2=double *pf_strength   res=can fail */
+    STREAM_GET_VALIDATOR,   /**< arg1= char **         res=can fail */
+    STREAM_GET_READ_STATS,  /**< arg1=uint64_t *pi_bytes, arg2=uint64_t *pi_rate (bytes/s), arg3=mtime_t *pi_stalled   res=can fail */
 
     STREAM_SET_PAUSE_STATE = 0x200, /**< arg1= bool        res=can fail */
     STREAM_SET_TITLE,       /**< arg1= int          res=can fail */
@@ -207,8 +207,10 @@ VLC_API subpicture_t * subpicture_NewFromPicture( vlc_object_t *, picture_t *, v
 /**
  * This function will update the content of a subpicture created with
  * a non NULL subpicture_updater_t.
+ *
+ * \return true if the regions of the subpicture have been re-created
  */
-VLC_API void subpicture_Update( subpicture_t *, const video_format_t *src, const video_format_t *, mtime_t );
+VLC_API bool subpicture_Update( subpicture_t *, const video_format_t *src, const video_format_t *, mtime_t );
 
 /**
  * This function will blend a given subpicture onto a picture.
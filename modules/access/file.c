@@ -44,6 +44,10 @@
 #   include <linux/magic.h>
 #endif
 
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
+
 #if defined( _WIN32 )
 #   include <io.h>
 #   include <ctype.h>
@@ -65,11 +69,18 @@
 #include <vlc_url.h>
 #include <vlc_interrupt.h>
 
+struct file_readahead;
+
 struct access_sys_t
 {
     int fd;
 
     bool b_pace_control;
+    struct file_readahead *readahead;
+#ifdef HAVE_MMAP
+    size_t mmap_size; /* 0 if not memory mapping */
+    uint64_t pos;
+#endif
 };
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -129,6 +140,16 @@ static bool IsRemote (const char *path)
 #endif
 
 static ssize_t Read (access_t *, void *, size_t);
+#ifdef HAVE_PREAD
+static ssize_t ReadAhead (access_t *, void *, size_t);
+static int ReadAheadOpen (access_t *, unsigned);
+static void ReadAheadClose (access_t *);
+static void ReadAheadSeek (access_t *, uint64_t);
+#endif
+#ifdef HAVE_MMAP
+static block_t *BlockMmap (access_t *, bool *);
+static bool CanMmap (access_t *, const struct stat *);
+#endif
 static int FileSeek (access_t *, uint64_t);
 static int NoSeek (access_t *, uint64_t);
 static int FileControl (access_t *, int, va_list);
@@ -219,6 +240,10 @@ int FileOpen( vlc_object_t *p_this )
     p_access->pf_control = FileControl;
     p_access->p_sys = p_sys;
     p_sys->fd = fd;
+    p_sys->readahead = NULL;
+#ifdef HAVE_MMAP
+    p_sys->mmap_size = 0;
+#endif
 
     if (S_ISREG (st.st_mode) || S_ISBLK (st.st_mode))
     {
@@ -238,6 +263,22 @@ int FileOpen( vlc_object_t *p_this )
         else
             fcntl (fd, F_RDAHEAD, 1);
 #endif
+#ifdef HAVE_MMAP
+        if (CanMmap (p_access, &st))
+        {
+            p_access->pf_read = NULL;
+            p_access->pf_block = BlockMmap;
+        }
+        else
+#endif
+        {
+#ifdef HAVE_PREAD
+            unsigned blocks = var_InheritInteger (p_access, "file-read-ahead");
+            if (blocks > 0 && S_ISREG (st.st_mode)
+             && ReadAheadOpen (p_access, blocks) == VLC_SUCCESS)
+                p_access->pf_read = ReadAhead;
+#endif
+        }
     }
     else
     {
@@ -259,7 +300,7 @@ void FileClose (vlc_object_t * p_this)
 {
     access_t     *p_access = (access_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_readdir != NULL)
     {
         DirClose (p_this);
         return;
@@ -267,6 +308,10 @@ void FileClose (vlc_object_t * p_this)
 
     access_sys_t *p_sys = p_access->p_sys;
 
+#ifdef HAVE_PREAD
+    if (p_sys->readahead != NULL)
+        ReadAheadClose (p_access);
+#endif
     vlc_close (p_sys->fd);
     free (p_sys);
 }
@@ -297,6 +342,453 @@ static ssize_t Read (access_t *p_access, void *p_buffer, size_t i_len)
     return val;
 }
 
+#ifdef HAVE_PREAD
+/*****************************************************************************
+ * Read-ahead: a ring of blocks following the read position, which worker
+ * threads fill with pread() while the input thread consumes the head block.
+ *****************************************************************************/
+#define READ_AHEAD_BLOCK   (256 * 1024)
+#define READ_AHEAD_THREADS 4
+
+enum
+{
+    SLOT_QUEUED,
+    SLOT_READING,
+    SLOT_DONE,
+};
+
+struct file_slot
+{
+    uint64_t offset;
+    size_t   length;
+    int      error;
+    int      state;
+    bool     stale; /* offset changed while reading, read again */
+    uint8_t *buf;
+};
+
+struct file_readahead
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait_work;
+    vlc_cond_t  wait_data;
+    bool        closing;
+    bool        interrupted;
+
+    uint64_t    pos;
+    unsigned    head; /* slot holding the read position */
+    unsigned    count;
+    struct file_slot *slots;
+
+    unsigned     threadc;
+    vlc_thread_t threads[READ_AHEAD_THREADS];
+
+    /* statistics */
+    uint64_t    bytes;
+    mtime_t     start;
+    mtime_t     stalled;
+};
+
+static void ReadAheadQueue (struct file_slot *slot, uint64_t offset)
+{
+    slot->offset = offset;
+    if (slot->state == SLOT_READING)
+        slot->stale = true; /* the worker will queue it back */
+    else
+        slot->state = SLOT_QUEUED;
+}
+
+/* Cancels all the pending reads and restarts from the given position */
+static void ReadAheadReset (access_t *p_access, uint64_t pos)
+{
+    access_sys_t *sys = p_access->p_sys;
+    struct file_readahead *ra = sys->readahead;
+
+    for (unsigned i = 0; i < ra->count; i++)
+        ReadAheadQueue (&ra->slots[(ra->head + i) % ra->count],
+                        pos + (uint64_t)i * READ_AHEAD_BLOCK);
+    ra->pos = pos;
+    posix_fadvise (sys->fd, pos, (off_t)ra->count * READ_AHEAD_BLOCK,
+                   POSIX_FADV_WILLNEED);
+    vlc_cond_broadcast (&ra->wait_work);
+}
+
+/* Moves the head block to the end of the window */
+static void ReadAheadRecycle (struct file_readahead *ra)
+{
+    const struct file_slot *tail =
+        &ra->slots[(ra->head + ra->count - 1) % ra->count];
+
+    ReadAheadQueue (&ra->slots[ra->head], tail->offset + READ_AHEAD_BLOCK);
+    ra->head = (ra->head + 1) % ra->count;
+    vlc_cond_signal (&ra->wait_work);
+}
+
+static void ReadAheadSeek (access_t *p_access, uint64_t pos)
+{
+    access_sys_t *sys = p_access->p_sys;
+    struct file_readahead *ra = sys->readahead;
+
+    vlc_mutex_lock (&ra->lock);
+    /* Keep the blocks still ahead of the new position, if any */
+    unsigned i;
+    for (i = 0; i < ra->count; i++)
+    {
+        const struct file_slot *slot =
+            &ra->slots[(ra->head + i) % ra->count];
+        if (pos >= slot->offset && pos - slot->offset < READ_AHEAD_BLOCK)
+            break;
+    }
+
+    if (i < ra->count)
+    {
+        while (i-- > 0)
+            ReadAheadRecycle (ra);
+        ra->pos = pos;
+    }
+    else
+        ReadAheadReset (p_access, pos);
+    vlc_mutex_unlock (&ra->lock);
+}
+
+static void *ReadAheadThread (void *data)
+{
+    access_t *p_access = data;
+    access_sys_t *sys = p_access->p_sys;
+    struct file_readahead *ra = sys->readahead;
+
+    vlc_mutex_lock (&ra->lock);
+    for (;;)
+    {
+        struct file_slot *slot = NULL;
+
+        /* Serve the blocks closest to the read position first */
+        while (!ra->closing)
+        {
+            for (unsigned i = 0; i < ra->count && slot == NULL; i++)
+            {
+                struct file_slot *s = &ra->slots[(ra->head + i) % ra->count];
+                if (s->state == SLOT_QUEUED)
+                    slot = s;
+            }
+            if (slot != NULL)
+                break;
+            vlc_cond_wait (&ra->wait_work, &ra->lock);
+        }
+        if (ra->closing)
+            break;
+
+        uint64_t offset = slot->offset;
+        slot->state = SLOT_READING;
+        slot->stale = false;
+        vlc_mutex_unlock (&ra->lock);
+
+        ssize_t val = pread (sys->fd, slot->buf, READ_AHEAD_BLOCK, offset);
+        int error = (val < 0) ? errno : 0;
+
+        vlc_mutex_lock (&ra->lock);
+        if (slot->stale || error == EINTR)
+        {
+            slot->state = SLOT_QUEUED;
+            continue;
+        }
+
+        slot->state = SLOT_DONE;
+        slot->length = (val > 0) ? val : 0;
+        slot->error = error;
+        ra->bytes += slot->length;
+        vlc_cond_signal (&ra->wait_data);
+    }
+    vlc_mutex_unlock (&ra->lock);
+    return NULL;
+}
+
+static void ReadAheadInterrupt (void *data)
+{
+    struct file_readahead *ra = data;
+
+    vlc_mutex_lock (&ra->lock);
+    ra->interrupted = true;
+    vlc_cond_signal (&ra->wait_data);
+    vlc_mutex_unlock (&ra->lock);
+}
+
+static ssize_t ReadAhead (access_t *p_access, void *p_buffer, size_t i_len)
+{
+    access_sys_t *sys = p_access->p_sys;
+    struct file_readahead *ra = sys->readahead;
+
+    ra->interrupted = false;
+    vlc_interrupt_register (ReadAheadInterrupt, ra);
+    vlc_mutex_lock (&ra->lock);
+
+    struct file_slot *slot = &ra->slots[ra->head];
+    if (slot->state != SLOT_DONE)
+    {
+        mtime_t start = mdate ();
+
+        while (slot->state != SLOT_DONE && !ra->interrupted)
+        {
+            mutex_cleanup_push (&ra->lock);
+            vlc_cond_wait (&ra->wait_data, &ra->lock);
+            vlc_cleanup_pop ();
+        }
+        ra->stalled += mdate () - start;
+    }
+
+    uint64_t pos = ra->pos;
+    size_t offset = pos - slot->offset;
+    ssize_t val;
+    int error = 0;
+
+    if (slot->state != SLOT_DONE)
+    {
+        error = EINTR;
+        val = -1;
+    }
+    else if (slot->error)
+    {
+        error = slot->error;
+        val = -1;
+    }
+    else if (offset < slot->length)
+    {
+        val = __MIN (i_len, slot->length - offset);
+        memcpy (p_buffer, slot->buf + offset, val);
+        ra->pos += val;
+        if (ra->pos - slot->offset >= READ_AHEAD_BLOCK)
+            ReadAheadRecycle (ra);
+    }
+    else
+        val = 0; /* end of file, as of the last block read */
+
+    vlc_mutex_unlock (&ra->lock);
+    vlc_interrupt_unregister ();
+
+    if (val == 0)
+    {
+        /* The file may be growing: check synchronously */
+        val = pread (sys->fd, p_buffer, i_len, pos);
+        if (val > 0)
+        {
+            vlc_mutex_lock (&ra->lock);
+            ReadAheadReset (p_access, pos + val);
+            vlc_mutex_unlock (&ra->lock);
+        }
+        else if (val < 0)
+            error = errno;
+    }
+
+    if (val < 0)
+    {
+        if (error == EINTR || error == EAGAIN)
+        {
+            errno = error;
+            return -1;
+        }
+
+        msg_Err (p_access, "read error: %s", vlc_strerror_c(error));
+        vlc_dialog_display_error (p_access, _("File reading failed"),
+            _("VLC could not read the file (%s)."),
+            vlc_strerror(error));
+        val = 0;
+    }
+
+    return val;
+}
+
+static int ReadAheadOpen (access_t *p_access, unsigned count)
+{
+    access_sys_t *sys = p_access->p_sys;
+    struct file_readahead *ra = malloc (sizeof (*ra));
+    if (unlikely(ra == NULL))
+        return VLC_ENOMEM;
+
+    ra->slots = calloc (count, sizeof (*ra->slots));
+    if (unlikely(ra->slots == NULL))
+    {
+        free (ra);
+        return VLC_ENOMEM;
+    }
+
+    ra->count = count;
+    for (unsigned i = 0; i < count; i++)
+    {
+        ra->slots[i].buf = malloc (READ_AHEAD_BLOCK);
+        if (unlikely(ra->slots[i].buf == NULL))
+        {
+            while (i-- > 0)
+                free (ra->slots[i].buf);
+            free (ra->slots);
+            free (ra);
+            return VLC_ENOMEM;
+        }
+        ra->slots[i].state = SLOT_DONE;
+    }
+
+    vlc_mutex_init (&ra->lock);
+    vlc_cond_init (&ra->wait_work);
+    vlc_cond_init (&ra->wait_data);
+    ra->closing = false;
+    ra->head = 0;
+    ra->bytes = 0;
+    ra->stalled = 0;
+    ra->start = mdate ();
+    sys->readahead = ra;
+
+    /* The file descriptor may not be at the start (fd:// access) */
+    off_t pos = lseek (sys->fd, 0, SEEK_CUR);
+    ReadAheadReset (p_access, (pos > 0) ? pos : 0);
+
+    ra->threadc = 0;
+    for (unsigned i = 0; i < __MIN(count, READ_AHEAD_THREADS); i++)
+    {
+        if (vlc_clone (&ra->threads[ra->threadc], ReadAheadThread, p_access,
+                       VLC_THREAD_PRIORITY_INPUT))
+            break;
+        ra->threadc++;
+    }
+
+    if (ra->threadc == 0)
+    {
+        ReadAheadClose (p_access);
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg (p_access, "reading %u KiB ahead with %u threads",
+             count * (READ_AHEAD_BLOCK / 1024), ra->threadc);
+    return VLC_SUCCESS;
+}
+
+/* Gets the bytes read, the throughput in bytes per second and the time spent
+ * waiting for the worker threads since the read-ahead was started */
+static void ReadAheadStats (struct file_readahead *ra, uint64_t *bytes,
+                            uint64_t *rate, mtime_t *stalled)
+{
+    vlc_mutex_lock (&ra->lock);
+    mtime_t duration = mdate () - ra->start;
+    *bytes = ra->bytes;
+    *rate = (duration > 0) ? ra->bytes * CLOCK_FREQ / duration : 0;
+    *stalled = ra->stalled;
+    vlc_mutex_unlock (&ra->lock);
+}
+
+static void ReadAheadClose (access_t *p_access)
+{
+    access_sys_t *sys = p_access->p_sys;
+    struct file_readahead *ra = sys->readahead;
+
+    vlc_mutex_lock (&ra->lock);
+    ra->closing = true;
+    vlc_cond_broadcast (&ra->wait_work);
+    vlc_mutex_unlock (&ra->lock);
+
+    for (unsigned i = 0; i < ra->threadc; i++)
+        vlc_join (ra->threads[i], NULL);
+
+    uint64_t bytes, rate;
+    mtime_t stalled;
+
+    ReadAheadStats (ra, &bytes, &rate, &stalled);
+    msg_Dbg (p_access, "read %"PRIu64" bytes at %"PRIu64" KiB/s, "
+             "stalled for %"PRId64" ms", bytes, rate / 1024, stalled / 1000);
+
+    vlc_cond_destroy (&ra->wait_data);
+    vlc_cond_destroy (&ra->wait_work);
+    vlc_mutex_destroy (&ra->lock);
+    for (unsigned i = 0; i < ra->count; i++)
+        free (ra->slots[i].buf);
+    free (ra->slots);
+    free (ra);
+    sys->readahead = NULL;
+}
+#endif
+
+#ifdef HAVE_MMAP
+/*****************************************************************************
+ * Memory mapping: each block maps a window of the file, so that the data is
+ * shared with the page cache instead of being copied.
+ *****************************************************************************/
+static bool CanMmap (access_t *p_access, const struct stat *st)
+{
+    access_sys_t *sys = p_access->p_sys;
+    size_t size = var_InheritInteger (p_access, "file-mmap") * 1024;
+
+    if (size == 0 || !S_ISREG (st->st_mode) || st->st_size == 0
+     || IsRemote (sys->fd, p_access->psz_filepath))
+        return false;
+
+    /* Check that the file system supports it */
+    long page_size = sysconf (_SC_PAGESIZE);
+    void *addr = mmap (NULL, page_size, PROT_READ, MAP_PRIVATE, sys->fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        msg_Dbg (p_access, "cannot map file: %s", vlc_strerror_c(errno));
+        return false;
+    }
+    munmap (addr, page_size);
+
+    sys->mmap_size = (size + page_size - 1) & ~(page_size - 1);
+    off_t pos = lseek (sys->fd, 0, SEEK_CUR);
+    sys->pos = (pos > 0) ? pos : 0;
+    msg_Dbg (p_access, "mapping file by windows of %zu KiB",
+             sys->mmap_size / 1024);
+    return true;
+}
+
+static block_t *BlockMmap (access_t *p_access, bool *restrict eof)
+{
+    access_sys_t *sys = p_access->p_sys;
+    struct stat st;
+
+    /* The file may be growing */
+    if (fstat (sys->fd, &st))
+    {
+        msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+        *eof = true;
+        return NULL;
+    }
+
+    if (sys->pos >= (uint64_t)st.st_size)
+    {
+        *eof = true;
+        return NULL;
+    }
+
+    /* Mappings start at a page boundary */
+    uint64_t offset = sys->pos & ~(uint64_t)(sysconf (_SC_PAGESIZE) - 1);
+    size_t length = sys->mmap_size;
+    if (length > st.st_size - offset)
+        length = st.st_size - offset;
+
+    /* Private writable mapping, as block users may modify the data */
+    void *addr = mmap (NULL, length, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+                       sys->fd, offset);
+    if (addr == MAP_FAILED)
+    {
+        msg_Err (p_access, "memory mapping failed: %s",
+                 vlc_strerror_c(errno));
+        *eof = true;
+        return NULL;
+    }
+#ifdef HAVE_POSIX_MADVISE
+    posix_madvise (addr, length, POSIX_MADV_SEQUENTIAL);
+#endif
+
+    block_t *block = block_mmap_Alloc (addr, length);
+    if (unlikely(block == NULL))
+    {
+        munmap (addr, length);
+        return NULL;
+    }
+
+    block->p_buffer += sys->pos - offset;
+    block->i_buffer -= sys->pos - offset;
+    sys->pos += block->i_buffer;
+    return block;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
@@ -304,6 +796,20 @@ static int FileSeek (access_t *p_access, uint64_t i_pos)
 {
     access_sys_t *sys = p_access->p_sys;
 
+#ifdef HAVE_PREAD
+    if (sys->readahead != NULL)
+    {
+        ReadAheadSeek (p_access, i_pos);
+        return VLC_SUCCESS;
+    }
+#endif
+#ifdef HAVE_MMAP
+    if (sys->mmap_size > 0)
+    {
+        sys->pos = i_pos;
+        return VLC_SUCCESS;
+    }
+#endif
     if (lseek(sys->fd, i_pos, SEEK_SET) == (off_t)-1)
         return VLC_EGENERIC;
     return VLC_SUCCESS;
@@ -358,6 +864,21 @@ static int FileControl( access_t *p_access, int i_query, va_list args )
             *pi_64 *= 1000;
             break;
 
+#ifdef HAVE_PREAD
+        case STREAM_GET_READ_STATS:
+        {
+            if (p_sys->readahead == NULL)
+                return VLC_EGENERIC;
+
+            uint64_t *bytes = va_arg( args, uint64_t * );
+            uint64_t *rate = va_arg( args, uint64_t * );
+            mtime_t *stalled = va_arg( args, mtime_t * );
+
+            ReadAheadStats (p_sys->readahead, bytes, rate, stalled);
+            break;
+        }
+#endif
+
         case STREAM_SET_PAUSE_STATE:
             /* Nothing to do */
             break;
@@ -30,6 +30,17 @@
 #include "fs.h"
 #include <vlc_plugin.h>
 
+#define READ_AHEAD_TEXT N_("Read-ahead blocks")
+#define READ_AHEAD_LONGTEXT N_( \
+    "Number of 256 KiB blocks read in advance by background threads. " \
+    "This hides the latency of slow disks, at the expense of memory. " \
+    "0 disables read-ahead.")
+#define MMAP_TEXT N_("Memory mapping window (KiB)")
+#define MMAP_LONGTEXT N_( \
+    "Size of the file windows mapped in memory instead of being read. " \
+    "This saves a copy of the data, and shares the page cache with other " \
+    "processes playing the same file. 0 disables memory mapping.")
+
 vlc_module_begin ()
     set_description( N_("File input") )
     set_shortname( N_("File") )
@@ -39,6 +50,10 @@ vlc_module_begin ()
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
+    add_integer_with_range( "file-read-ahead", 0, 0, 64,
+                            READ_AHEAD_TEXT, READ_AHEAD_LONGTEXT, true )
+    add_integer_with_range( "file-mmap", 0, 0, 262144,
+                            MMAP_TEXT, MMAP_LONGTEXT, true )
 
     add_submodule()
     set_section( N_("Directory" ), NULL )
@@ -101,6 +101,15 @@ static int FileControl(access_t *access, int query, va_list args)
             *va_arg(args, char **) = vlc_http_file_get_type(sys->resource);
             break;
 
+        case STREAM_GET_VALIDATOR:
+        {
+            char *str = vlc_http_file_get_validator(sys->resource);
+            if (str == NULL)
+                return VLC_EGENERIC;
+            *va_arg(args, char **) = str;
+            break;
+        }
+
         case STREAM_SET_PAUSE_STATE:
             break;
 
@@ -201,6 +201,24 @@ bool vlc_http_file_can_seek(struct vlc_http_resource *res)
     return vlc_http_msg_can_seek(res->response);
 }
 
+char *vlc_http_file_get_validator(struct vlc_http_resource *res)
+{
+    int status = vlc_http_res_get_status(res);
+    if (status < 200 || status >= 300)
+        return NULL;
+
+    /* A weak entity tag does not guarantee byte-for-byte identity */
+    const char *str = vlc_http_msg_get_header(res->response, "ETag");
+    if (str != NULL && memcmp(str, "W/", 2))
+        return strdup(str);
+
+    time_t mtime = vlc_http_msg_get_mtime(res->response);
+    char *ret;
+    if (mtime == -1 || asprintf(&ret, "%lld", (long long)mtime) == -1)
+        ret = NULL;
+    return ret;
+}
+
 int vlc_http_file_seek(struct vlc_http_resource *res, uintmax_t offset)
 {
     struct vlc_http_msg *resp = vlc_http_res_open(res, &offset);
@@ -63,6 +63,16 @@ uintmax_t vlc_http_file_get_size(struct vlc_http_resource *);
  */
 bool vlc_http_file_can_seek(struct vlc_http_resource *);
 
+/**
+ * Gets the file validator.
+ *
+ * Returns a string identifying the file version: the strong entity tag if
+ * any, otherwise the last modification time.
+ *
+ * @return a heap-allocated string or NULL if unknown.
+ */
+char *vlc_http_file_get_validator(struct vlc_http_resource *);
+
 /**
  * Sets the read offset.
  *
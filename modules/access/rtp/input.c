@@ -97,6 +97,79 @@ static int rtp_timeout (mtime_t deadline)
     return t;
 }
 
+#ifdef HAVE_RECVMMSG
+typedef struct mmsghdr rtp_msg_t;
+#else
+typedef struct
+{
+    struct msghdr msg_hdr;
+    unsigned msg_len;
+} rtp_msg_t;
+#endif
+
+/**
+ * Pre-allocated receive buffers for the datagram thread
+ */
+struct rtp_ring
+{
+    unsigned       size;
+    size_t         mru; /**< Receive buffer size */
+    block_t      **blocks;
+    struct iovec  *iov;
+    rtp_msg_t     *msgs;
+#ifdef HAVE_RECVMMSG
+    bool           mmsg; /**< false if the kernel lacks recvmmsg() */
+#endif
+};
+
+static void rtp_ring_cleanup (void *data)
+{
+    struct rtp_ring *ring = data;
+
+    if (ring->blocks != NULL)
+        for (unsigned i = 0; i < ring->size; i++)
+            if (ring->blocks[i] != NULL)
+                block_Release (ring->blocks[i]);
+    free (ring->msgs);
+    free (ring->iov);
+    free (ring->blocks);
+}
+
+/**
+ * Receives up to count datagrams into the ring.
+ * @return the number of received datagrams, or -1 on error.
+ */
+static int rtp_recv (demux_t *demux, int fd, struct rtp_ring *ring,
+                     unsigned count)
+{
+#ifdef HAVE_RECVMMSG
+    if (ring->mmsg)
+    {
+        int n = recvmmsg (fd, ring->msgs, count, MSG_DONTWAIT, NULL);
+        if (n != -1 || errno != ENOSYS)
+            return n;
+
+        msg_Warn (demux, "recvmmsg() not supported, "
+                  "receiving one datagram at a time");
+        ring->mmsg = false;
+    }
+#else
+    (void) demux; (void) count;
+#endif
+
+    rtp_msg_t *msg = &ring->msgs[0];
+#ifdef __linux__
+    msg->msg_hdr.msg_flags = MSG_TRUNC;
+#else
+    msg->msg_hdr.msg_flags = 0;
+#endif
+    ssize_t len = recvmsg (fd, &msg->msg_hdr, 0);
+    if (len == -1)
+        return -1;
+    msg->msg_len = len;
+    return 1;
+}
+
 /**
  * RTP/RTCP session thread for datagram sockets
  */
@@ -106,20 +179,37 @@ void *rtp_dgram_thread (void *opaque)
     demux_sys_t *sys = demux->p_sys;
     mtime_t deadline = VLC_TS_INVALID;
     int rtp_fd = sys->fd;
-    struct iovec iov =
+    struct rtp_ring ring =
     {
-        .iov_len = DEFAULT_MRU,
+        .mru = DEFAULT_MRU,
+#ifdef HAVE_RECVMMSG
+        .size = sys->batch,
+        .mmsg = true,
+#else
+        .size = 1,
+#endif
     };
-    struct msghdr msg =
+
+    ring.blocks = calloc (ring.size, sizeof (*ring.blocks));
+    ring.iov = calloc (ring.size, sizeof (*ring.iov));
+    ring.msgs = calloc (ring.size, sizeof (*ring.msgs));
+    if (unlikely(ring.blocks == NULL || ring.iov == NULL || ring.msgs == NULL))
     {
-        .msg_iov = &iov,
-        .msg_iovlen = 1,
-    };
+        rtp_ring_cleanup (&ring);
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < ring.size; i++)
+    {
+        ring.msgs[i].msg_hdr.msg_iov = &ring.iov[i];
+        ring.msgs[i].msg_hdr.msg_iovlen = 1;
+    }
 
     struct pollfd ufd[1];
     ufd[0].fd = rtp_fd;
     ufd[0].events = POLLIN;
 
+    vlc_cleanup_push (rtp_ring_cleanup, &ring);
     for (;;)
     {
         int n = poll (ufd, 1, rtp_timeout (deadline));
@@ -134,34 +224,62 @@ void *rtp_dgram_thread (void *opaque)
         {
             n--;
             if (unlikely(ufd[0].revents & POLLHUP))
+            {
+                vlc_restorecancel (canc);
                 break; /* RTP socket dead (DCCP only) */
+            }
 
-            block_t *block = block_Alloc (iov.iov_len);
-            if (unlikely(block == NULL))
+            /* Refill the receive ring */
+            unsigned count = 0;
+            while (count < ring.size)
             {
-                if (iov.iov_len == DEFAULT_MRU)
+                block_t *block = ring.blocks[count];
+                if (block == NULL)
+                {
+                    block = block_Alloc (ring.mru);
+                    if (unlikely(block == NULL))
+                        break;
+                    ring.blocks[count] = block;
+                }
+                ring.iov[count].iov_base = block->p_buffer;
+                ring.iov[count].iov_len = block->i_buffer;
+                count++;
+            }
+
+            if (unlikely(count == 0))
+            {
+                if (ring.mru == DEFAULT_MRU)
+                {
+                    vlc_restorecancel (canc);
                     break; /* we are totallly screwed */
-                iov.iov_len = DEFAULT_MRU;
+                }
+                ring.mru = DEFAULT_MRU;
+                vlc_restorecancel (canc);
                 continue; /* retry with shrunk MRU */
             }
 
-            iov.iov_base = block->p_buffer;
-#ifdef __linux__
-            msg.msg_flags = MSG_TRUNC;
-#else
-            msg.msg_flags = 0;
-#endif
+            int rcvd = rtp_recv (demux, rtp_fd, &ring, count);
+            if (rcvd == -1)
+            {
+                if (errno != EAGAIN)
+                    msg_Warn (demux, "RTP network error: %s",
+                              vlc_strerror_c(errno));
+                rcvd = 0;
+            }
 
-            ssize_t len = recvmsg (rtp_fd, &msg, 0);
-            if (len != -1)
+            for (int i = 0; i < rcvd; i++)
             {
+                block_t *block = ring.blocks[i];
+                size_t len = ring.msgs[i].msg_len;
+
+                ring.blocks[i] = NULL;
 #ifdef MSG_TRUNC
-                if (msg.msg_flags & MSG_TRUNC)
+                if (ring.msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
                 {
-                    msg_Err(demux, "%zd bytes packet truncated (MRU was %zu)",
-                            len, iov.iov_len);
+                    msg_Err(demux, "%zu bytes packet truncated (MRU was %zu)",
+                            len, block->i_buffer);
                     block->i_flags |= BLOCK_FLAG_CORRUPTED;
-                    iov.iov_len = len;
+                    ring.mru = len;
                 }
                 else
 #endif
@@ -169,11 +287,12 @@ void *rtp_dgram_thread (void *opaque)
 
                 rtp_process (demux, block);
             }
-            else
+
+            /* Keep unused buffers at the front of the ring */
+            for (unsigned i = rcvd; i < count; i++)
             {
-                msg_Warn (demux, "RTP network error: %s",
-                          vlc_strerror_c(errno));
-                block_Release (block);
+                ring.blocks[i - rcvd] = ring.blocks[i];
+                ring.blocks[i] = NULL;
             }
         }
 
@@ -182,6 +301,8 @@ void *rtp_dgram_thread (void *opaque)
             deadline = VLC_TS_INVALID;
         vlc_restorecancel (canc);
     }
+    vlc_cleanup_pop ();
+    rtp_ring_cleanup (&ring);
     return NULL;
 }
 
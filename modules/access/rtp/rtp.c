@@ -82,6 +82,11 @@
     "(between 96 and 127) if it can't be determined otherwise with " \
     "out-of-band mappings (SDP)" )
 
+#define RTP_BATCH_TEXT N_("Receive batch size")
+#define RTP_BATCH_LONGTEXT N_( \
+    "Maximum number of RTP datagrams received with a single system call, " \
+    "where supported." )
+
 static const char *const dynamic_pt_list[] = { "theora" };
 static const char *const dynamic_pt_list_text[] = { "Theora Encoded Video" };
 
@@ -125,6 +130,9 @@ vlc_module_begin ()
     add_string ("rtp-dynamic-pt", NULL, RTP_DYNAMIC_PT_TEXT,
                 RTP_DYNAMIC_PT_LONGTEXT, true)
         change_string_list (dynamic_pt_list, dynamic_pt_list_text)
+    add_integer ("rtp-batch", 16, RTP_BATCH_TEXT,
+                 RTP_BATCH_LONGTEXT, true)
+        change_integer_range (1, 1024)
 
     /*add_shortcut ("sctp")*/
     add_shortcut ("dccp", "rtptcp", /* "tcp" is already taken :( */
@@ -264,6 +272,7 @@ static int Open (vlc_object_t *obj)
                         * CLOCK_FREQ;
     p_sys->max_dropout  = var_CreateGetInteger (obj, "rtp-max-dropout");
     p_sys->max_misorder = var_CreateGetInteger (obj, "rtp-max-misorder");
+    p_sys->batch        = var_CreateGetInteger (obj, "rtp-batch");
     p_sys->thread_ready = false;
     p_sys->autodetect   = true;
 
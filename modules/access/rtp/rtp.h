@@ -76,6 +76,7 @@ struct demux_sys_t
     uint16_t      max_dropout; /**< Max packet forward misordering */
     uint16_t      max_misorder; /**< Max packet backward misordering */
     uint8_t       max_src; /**< Max simultaneous RTP sources */
+    unsigned      batch; /**< Max datagrams per receive call */
     bool          thread_ready;
     bool          autodetect; /**< Payload type autodetection pending */
 };
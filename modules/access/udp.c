@@ -58,6 +58,9 @@ static void Close( vlc_object_t * );
 #define BUFFER_TEXT N_("Receive buffer")
 #define BUFFER_LONGTEXT N_("UDP receive buffer size (bytes)" )
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define BATCH_TEXT N_("Receive batch size")
+#define BATCH_LONGTEXT N_("Maximum number of datagrams received with a " \
+    "single system call, where supported." )
 
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
@@ -68,6 +71,8 @@ vlc_module_begin ()
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
     add_integer( "udp-buffer", 0x400000, BUFFER_TEXT, BUFFER_LONGTEXT, true )
     add_integer( "udp-timeout", -1, TIMEOUT_TEXT, NULL, true )
+    add_integer( "udp-batch", 16, BATCH_TEXT, BATCH_LONGTEXT, true )
+        change_integer_range( 1, 1024 )
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -75,6 +80,16 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
+#ifdef HAVE_RECVMMSG
+typedef struct mmsghdr udp_msg_t;
+#else
+typedef struct
+{
+    struct msghdr msg_hdr;
+    unsigned msg_len;
+} udp_msg_t;
+#endif
+
 struct access_sys_t
 {
     int fd;
@@ -85,6 +100,15 @@ struct access_sys_t
     vlc_sem_t semaphore;
     vlc_thread_t thread;
     atomic_bool timeout_reached;
+
+    /* Pre-allocated receive ring, owned by the reading thread */
+    unsigned batch;
+    block_t **ring;
+    struct iovec *iov;
+    udp_msg_t *msgs;
+#ifdef HAVE_RECVMMSG
+    bool mmsg; /* false if the kernel lacks recvmmsg() */
+#endif
 };
 
 /*****************************************************************************
@@ -191,6 +215,32 @@ static int Open( vlc_object_t *p_this )
 
     sys->mtu = 7 * 188;
     sys->fifo_size = var_InheritInteger( p_access, "udp-buffer");
+
+#ifdef HAVE_RECVMMSG
+    sys->batch = var_InheritInteger( p_access, "udp-batch" );
+    sys->mmsg = true;
+#else
+    sys->batch = 1;
+#endif
+    sys->ring = calloc( sys->batch, sizeof( *sys->ring ) );
+    sys->iov = calloc( sys->batch, sizeof( *sys->iov ) );
+    sys->msgs = calloc( sys->batch, sizeof( *sys->msgs ) );
+    if( unlikely( sys->ring == NULL || sys->iov == NULL || sys->msgs == NULL ) )
+    {
+        free( sys->msgs );
+        free( sys->iov );
+        free( sys->ring );
+        block_FifoRelease( sys->fifo );
+        net_Close( sys->fd );
+        goto error;
+    }
+
+    for( unsigned i = 0; i < sys->batch; i++ )
+    {
+        sys->msgs[i].msg_hdr.msg_iov = &sys->iov[i];
+        sys->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
     vlc_sem_init( &sys->semaphore, 0 );
 
     sys->timeout = var_InheritInteger( p_access, "udp-timeout");
@@ -202,6 +252,9 @@ static int Open( vlc_object_t *p_this )
                    VLC_THREAD_PRIORITY_INPUT ) )
     {
         vlc_sem_destroy( &sys->semaphore );
+        free( sys->msgs );
+        free( sys->iov );
+        free( sys->ring );
         block_FifoRelease( sys->fifo );
         net_Close( sys->fd );
 error:
@@ -223,6 +276,12 @@ static void Close( vlc_object_t *p_this )
     vlc_cancel( sys->thread );
     vlc_join( sys->thread, NULL );
     vlc_sem_destroy( &sys->semaphore );
+    for( unsigned i = 0; i < sys->batch; i++ )
+        if( sys->ring[i] != NULL )
+            block_Release( sys->ring[i] );
+    free( sys->msgs );
+    free( sys->iov );
+    free( sys->ring );
     block_FifoRelease( sys->fifo );
     net_Close( sys->fd );
     free( sys );
@@ -280,6 +339,58 @@ static block_t *BlockUDP( access_t *p_access, bool *restrict eof )
     return block;
 }
 
+/*****************************************************************************
+ * QueueUDP: hand a received packet over to BlockUDP()
+ *****************************************************************************/
+static void QueueUDP( access_sys_t *sys, block_t *pkt )
+{
+    vlc_fifo_Lock(sys->fifo);
+    /* Discard old buffers on overflow */
+    while (vlc_fifo_GetBytes(sys->fifo) + pkt->i_buffer > sys->fifo_size)
+    {
+        int canc = vlc_savecancel();
+        block_Release(vlc_fifo_DequeueUnlocked(sys->fifo));
+        vlc_restorecancel(canc);
+    }
+
+    vlc_fifo_QueueUnlocked(sys->fifo, pkt);
+    vlc_fifo_Unlock(sys->fifo);
+    vlc_sem_post(&sys->semaphore);
+}
+
+/*****************************************************************************
+ * RecvUDP: receive up to count datagrams into the ring
+ *****************************************************************************/
+static int RecvUDP( access_t *access, unsigned count )
+{
+    access_sys_t *sys = access->p_sys;
+
+#ifdef HAVE_RECVMMSG
+    if (sys->mmsg)
+    {
+        int n = recvmmsg(sys->fd, sys->msgs, count, MSG_DONTWAIT, NULL);
+        if (n != -1 || errno != ENOSYS)
+            return n;
+
+        msg_Warn(access, "recvmmsg() not supported, "
+                 "receiving one datagram at a time");
+        sys->mmsg = false;
+    }
+#else
+    (void) count;
+#endif
+
+    udp_msg_t *msg = &sys->msgs[0];
+#ifdef __linux__
+    msg->msg_hdr.msg_flags = MSG_TRUNC;
+#endif
+    ssize_t len = recvmsg(sys->fd, &msg->msg_hdr, 0);
+    if (len == -1)
+        return -1;
+    msg->msg_len = len;
+    return 1;
+}
+
 /*****************************************************************************
  * ThreadRead: Pull packets from socket as soon as possible.
  *****************************************************************************/
@@ -290,28 +401,32 @@ static void* ThreadRead( void *data )
 
     for(;;)
     {
-        block_t *pkt = block_Alloc(sys->mtu);
-        if (unlikely(pkt == NULL))
+        unsigned count = 0;
+
+        /* Refill the receive ring */
+        while (count < sys->batch)
+        {
+            block_t *pkt = sys->ring[count];
+            if (pkt == NULL)
+            {
+                pkt = block_Alloc(sys->mtu);
+                if (unlikely(pkt == NULL))
+                    break;
+                sys->ring[count] = pkt;
+            }
+            sys->iov[count].iov_base = pkt->p_buffer;
+            sys->iov[count].iov_len = pkt->i_buffer;
+            count++;
+        }
+
+        if (unlikely(count == 0))
         {   /* OOM - dequeue and discard one packet */
             char dummy;
             recv(sys->fd, &dummy, 1, 0);
             continue;
         }
 
-        struct iovec iov = {
-            .iov_base = pkt->p_buffer,
-            .iov_len = sys->mtu,
-        };
-        struct msghdr msg = {
-            .msg_iov = &iov,
-            .msg_iovlen = 1,
-#ifdef __linux__
-            .msg_flags = MSG_TRUNC,
-#endif
-        };
-        ssize_t len;
-
-        block_cleanup_push(pkt);
+        int n;
         do
         {
             int poll_return=0;
@@ -324,38 +439,42 @@ static void* ThreadRead( void *data )
             {
                 msg_Err( access, "Timeout on receiving, timeout %d seconds", sys->timeout/1000 );
                 atomic_store(&sys->timeout_reached, true);
-                len=0;
+                sys->msgs[0].msg_len = 0;
+                sys->msgs[0].msg_hdr.msg_flags = 0;
+                n = 1;
                 break;
             }
-            len = recvmsg(sys->fd, &msg, 0);
+            n = RecvUDP(access, count);
         }
-        while (len == -1);
-        vlc_cleanup_pop();
+        while (n == -1);
 
-#ifdef MSG_TRUNC
-        if (msg.msg_flags & MSG_TRUNC)
+        for (int i = 0; i < n; i++)
         {
-            msg_Err(access, "%zd bytes packet truncated (MTU was %zu)",
-                    len, sys->mtu);
-            pkt->i_flags |= BLOCK_FLAG_CORRUPTED;
-            sys->mtu = len;
-        }
-        else
+            block_t *pkt = sys->ring[i];
+            size_t len = sys->msgs[i].msg_len;
+
+#ifdef MSG_TRUNC
+            if (sys->msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                msg_Err(access, "%zu bytes packet truncated (MTU was %zu)",
+                        len, sys->mtu);
+                pkt->i_flags |= BLOCK_FLAG_CORRUPTED;
+                sys->mtu = len;
+            }
+            else
 #endif
-            pkt->i_buffer = len;
+                pkt->i_buffer = len;
 
-        vlc_fifo_Lock(sys->fifo);
-        /* Discard old buffers on overflow */
-        while (vlc_fifo_GetBytes(sys->fifo) + len > sys->fifo_size)
-        {
-            int canc = vlc_savecancel();
-            block_Release(vlc_fifo_DequeueUnlocked(sys->fifo));
-            vlc_restorecancel(canc);
+            sys->ring[i] = NULL;
+            QueueUDP(sys, pkt);
         }
 
-        vlc_fifo_QueueUnlocked(sys->fifo, pkt);
-        vlc_fifo_Unlock(sys->fifo);
-        vlc_sem_post(&sys->semaphore);
+        /* Keep unused buffers at the front of the ring */
+        for (unsigned i = n; i < count; i++)
+        {
+            sys->ring[i - n] = sys->ring[i];
+            sys->ring[i] = NULL;
+        }
     }
 
     return NULL;
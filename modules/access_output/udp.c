@@ -50,6 +50,7 @@
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
+#define MAX_BURST_PACKETS 64
 
 /*****************************************************************************
  * Module descriptor
@@ -71,6 +72,12 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BURST_TEXT N_("Burst window (ms)")
+#define BURST_LONGTEXT N_("Packets due within this time window are sent " \
+                          "together with a single system call. Packets " \
+                          "carrying a clock reference are still sent on " \
+                          "time. 0 sends every packet at its own date." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -79,6 +86,9 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer( SOUT_CFG_PREFIX "burst", 0, BURST_TEXT, BURST_LONGTEXT,
+                                 true )
+        change_integer_range( 0, 1000 )
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +102,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "burst",
     NULL
 };
 
@@ -121,6 +132,24 @@ struct sout_access_out_sys_t
     block_fifo_t *p_empty_blocks;
     block_t      *p_buffer;
 
+    /* Packets being sent by the writer thread */
+    mtime_t       i_burst_window;
+    block_t      *pp_burst[MAX_BURST_PACKETS];
+    unsigned      i_burst;
+#ifdef HAVE_SENDMMSG
+    bool          b_mmsg; /* false if the kernel lacks sendmmsg() */
+#endif
+
+    /* Statistics, owned by the writer thread until it is joined */
+    struct
+    {
+        uint64_t  i_packets;
+        uint64_t  i_bursts;
+        unsigned  i_max_burst;
+        uint64_t  i_late;
+        uint64_t  i_dropped;
+    } stats;
+
     vlc_thread_t  thread;
 };
 
@@ -210,9 +239,16 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
-    p_sys->p_empty_blocks = block_FifoNew();
+    p_sys->p_fifo = block_FifoNewSPSC();
+    p_sys->p_empty_blocks = block_FifoNewSPSC();
     p_sys->p_buffer = NULL;
+    p_sys->i_burst_window = INT64_C(1000)
+                          * var_GetInteger( p_access, SOUT_CFG_PREFIX "burst" );
+    p_sys->i_burst = 0;
+#ifdef HAVE_SENDMMSG
+    p_sys->b_mmsg = true;
+#endif
+    memset( &p_sys->stats, 0, sizeof( p_sys->stats ) );
 
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
@@ -242,6 +278,17 @@ static void Close( vlc_object_t * p_this )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
+
+    for( unsigned i = 0; i < p_sys->i_burst; i++ )
+        block_Release( p_sys->pp_burst[i] );
+
+    if( p_sys->stats.i_bursts > 0 )
+        msg_Dbg( p_access, "sent %"PRIu64" packets in %"PRIu64" bursts "
+                 "(max %u), %"PRIu64" late, %"PRIu64" dropped",
+                 p_sys->stats.i_packets, p_sys->stats.i_bursts,
+                 p_sys->stats.i_max_burst, p_sys->stats.i_late,
+                 p_sys->stats.i_dropped );
+
     block_FifoRelease( p_sys->p_fifo );
     block_FifoRelease( p_sys->p_empty_blocks );
 
@@ -369,13 +416,17 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     sout_access_out_sys_t *p_sys = p_access->p_sys;
     block_t *p_buffer;
 
-    while ( block_FifoCount( p_sys->p_empty_blocks ) > MAX_EMPTY_BLOCKS )
+    /* This thread is the only one to dequeue, so the count can only grow
+     * until the next call */
+    size_t i_empty = block_FifoCount( p_sys->p_empty_blocks );
+
+    for( ; i_empty > MAX_EMPTY_BLOCKS; i_empty-- )
     {
         p_buffer = block_FifoGet( p_sys->p_empty_blocks );
         block_Release( p_buffer );
     }
 
-    if( block_FifoCount( p_sys->p_empty_blocks ) == 0 )
+    if( i_empty == 0 )
     {
         p_buffer = block_Alloc( p_sys->i_mtu );
     }
@@ -392,6 +443,91 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+/*****************************************************************************
+ * SendBurst: send the gathered packets, with as few system calls as possible
+ *****************************************************************************/
+static void SendBurst( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    unsigned i_sent = 0;
+
+#ifdef HAVE_SENDMMSG
+    if( p_sys->b_mmsg )
+    {
+        struct iovec iov[MAX_BURST_PACKETS];
+        struct mmsghdr msgs[MAX_BURST_PACKETS];
+
+        memset( msgs, 0, sizeof( msgs[0] ) * p_sys->i_burst );
+        for( unsigned i = 0; i < p_sys->i_burst; i++ )
+        {
+            iov[i].iov_base = p_sys->pp_burst[i]->p_buffer;
+            iov[i].iov_len = p_sys->pp_burst[i]->i_buffer;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        while( i_sent < p_sys->i_burst )
+        {
+            int i_ret = sendmmsg( p_sys->i_handle, &msgs[i_sent],
+                                  p_sys->i_burst - i_sent, 0 );
+            if( i_ret == -1 )
+            {
+                if( errno == ENOSYS )
+                {
+                    msg_Warn( p_access, "sendmmsg() not supported, "
+                              "sending one packet at a time" );
+                    p_sys->b_mmsg = false;
+                    break;
+                }
+                msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+                i_ret = 1; /* skip the failing packet */
+            }
+            i_sent += i_ret;
+        }
+    }
+#endif
+
+    for( ; i_sent < p_sys->i_burst; i_sent++ )
+    {
+        block_t *p_pk = p_sys->pp_burst[i_sent];
+        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+    }
+}
+
+/*****************************************************************************
+ * CheckPacketDate: check the date of a packet against the previous one
+ *****************************************************************************
+ * Returns false if the packet must be dropped.
+ *****************************************************************************/
+static bool CheckPacketDate( sout_access_out_t *p_access, mtime_t i_date,
+                             mtime_t *pi_date_last, unsigned *pi_dropped )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    const mtime_t i_date_last = *pi_date_last;
+
+    *pi_date_last = i_date;
+    if( i_date_last <= 0 )
+        return true;
+
+    if( i_date - i_date_last > 2000000 )
+    {
+        if( !*pi_dropped )
+            msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                     i_date - i_date_last );
+        (*pi_dropped)++;
+        p_sys->stats.i_dropped++;
+        return false;
+    }
+    else if( i_date - i_date_last < -1000 )
+    {
+        if( !*pi_dropped )
+            msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
+                     i_date_last - i_date );
+    }
+    return true;
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -411,38 +547,66 @@ static void* ThreadWrite( void *data )
         mtime_t       i_date, i_sent;
 
         i_date = p_sys->i_caching + p_pk->i_dts;
-        if( i_date_last > 0 )
+        if( !CheckPacketDate( p_access, i_date, &i_date_last,
+                              &i_dropped_packets ) )
         {
-            if( i_date - i_date_last > 2000000 )
-            {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
-                             i_date - i_date_last );
-
-                block_FifoPut( p_sys->p_empty_blocks, p_pk );
+            block_FifoPut( p_sys->p_empty_blocks, p_pk );
+            continue;
+        }
 
-                i_date_last = i_date;
-                i_dropped_packets++;
-                continue;
+        /* Gather the following packets due within the burst window. A
+         * packet carrying a clock reference always ends the burst, and
+         * starts a new one if it is due later than the first packet, so
+         * that it is sent at its own date. So does any packet that the date
+         * checks above would report (hole or packet in the past): it then
+         * starts the next burst. */
+        const mtime_t i_date_first = i_date;
+        size_t i_queued = block_FifoCount( p_sys->p_fifo );
+        bool b_wait = false;
+
+        p_sys->pp_burst[0] = p_pk;
+        p_sys->i_burst = 1;
+        for( ;; )
+        {
+            i_to_send--;
+            if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+            {
+                b_wait = true;
+                i_to_send = i_group;
             }
-            else if( i_date - i_date_last < -1000 )
+
+            if( (p_pk->i_flags & BLOCK_FLAG_CLOCK) ||
+                p_sys->i_burst >= MAX_BURST_PACKETS )
+                break;
+            /* Only count the queue again once the known packets are used */
+            if( i_queued == 0 )
             {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
-                             i_date_last - i_date );
+                i_queued = block_FifoCount( p_sys->p_fifo );
+                if( i_queued == 0 )
+                    break;
             }
-        }
 
-        block_cleanup_push( p_pk );
-        i_to_send--;
-        if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
-        {
-            mwait( i_date );
-            i_to_send = i_group;
+            block_t *p_next = block_FifoShow( p_sys->p_fifo );
+            mtime_t i_date_next = p_sys->i_caching + p_next->i_dts;
+            if( i_date_next < i_date || i_date_next - i_date > 2000000 ||
+                i_date_next - i_date_first > p_sys->i_burst_window ||
+                ((p_next->i_flags & BLOCK_FLAG_CLOCK) &&
+                 i_date_next > i_date_first) )
+                break;
+
+            p_pk = block_FifoGet( p_sys->p_fifo );
+            i_queued--;
+            CheckPacketDate( p_access, i_date_next, &i_date_last,
+                             &i_dropped_packets );
+            p_sys->pp_burst[p_sys->i_burst++] = p_pk;
+            i_date = i_date_next;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
+
+        /* A burst goes out at the date of its first packet, unless grouping
+         * lets it go early */
+        if( b_wait )
+            mwait( i_date_first );
+        SendBurst( p_access );
 
         if( i_dropped_packets )
         {
@@ -450,18 +614,26 @@ static void* ThreadWrite( void *data )
             i_dropped_packets = 0;
         }
 
-#if 1
+        /* The first packet has the earliest date, hence is the latest */
         i_sent = mdate();
-        if ( i_sent > i_date + 20000 )
+        if ( i_sent > i_date_first + 20000 )
         {
             msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
-                     i_sent - i_date );
+                     i_sent - i_date_first );
+            for( unsigned i = 0; i < p_sys->i_burst; i++ )
+                if( i_sent > p_sys->i_caching + p_sys->pp_burst[i]->i_dts
+                             + 20000 )
+                    p_sys->stats.i_late++;
         }
-#endif
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
+        p_sys->stats.i_packets += p_sys->i_burst;
+        p_sys->stats.i_bursts++;
+        if( p_sys->i_burst > p_sys->stats.i_max_burst )
+            p_sys->stats.i_max_burst = p_sys->i_burst;
 
-        i_date_last = i_date;
+        for( unsigned i = 0; i < p_sys->i_burst; i++ )
+            block_FifoPut( p_sys->p_empty_blocks, p_sys->pp_burst[i] );
+        p_sys->i_burst = 0;
     }
     return NULL;
 }
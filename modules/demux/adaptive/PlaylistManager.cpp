@@ -112,7 +112,8 @@ bool PlaylistManager::setupPeriod()
         BaseAdaptationSet *set = *it;
         if(set && streamFactory)
         {
-            SegmentTracker *tracker = new (std::nothrow) SegmentTracker(logic, set);
+            SegmentTracker *tracker = new (std::nothrow) SegmentTracker(logic, set,
+                                        var_InheritInteger(p_demux, "adaptive-prefetch"));
             if(!tracker)
                 continue;
 
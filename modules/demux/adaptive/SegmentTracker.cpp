@@ -75,7 +75,8 @@ SegmentTrackerEvent::SegmentTrackerEvent(const ID &id, mtime_t duration)
     u.segment.id = &id;
 }
 
-SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet)
+SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet,
+                               unsigned prefetch)
 {
     first = true;
     curNumber = next = 0;
@@ -86,6 +87,8 @@ SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSe
     setAdaptationLogic(logic_);
     adaptationSet = adaptSet;
     format = StreamFormat::UNSUPPORTED;
+    prefetchCount = prefetch;
+    prefetchRepresentation = NULL;
 }
 
 SegmentTracker::~SegmentTracker()
@@ -126,6 +129,7 @@ bool SegmentTracker::segmentsListReady() const
 
 void SegmentTracker::reset()
 {
+    flushPrefetchedChunks();
     notify(SegmentTrackerEvent(curRepresentation, NULL));
     curRepresentation = NULL;
     init_sent = false;
@@ -164,6 +168,7 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
 
     if(rep != curRepresentation)
     {
+        flushPrefetchedChunks();
         notify(SegmentTrackerEvent(curRepresentation, rep));
         prevRep = curRepresentation;
         curRepresentation = rep;
@@ -246,7 +251,9 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         initializing = false;
     }
 
-    SegmentChunk *chunk = segment->toChunk(next, rep, connManager);
+    SegmentChunk *chunk = getPrefetchedChunk(rep, next);
+    if(!chunk)
+        chunk = segment->toChunk(next, rep, connManager);
 
     /* Notify new segment length for stats / logic */
     if(chunk)
@@ -273,11 +280,59 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     {
         curNumber = next;
         next++;
+        prefetchChunks(rep, connManager);
     }
 
     return chunk;
 }
 
+SegmentChunk * SegmentTracker::getPrefetchedChunk(BaseRepresentation *rep, uint64_t number)
+{
+    if(!prefetched.empty() && prefetchRepresentation == rep &&
+       prefetched.front().first == number)
+    {
+        SegmentChunk *chunk = prefetched.front().second;
+        prefetched.pop_front();
+        return chunk;
+    }
+    flushPrefetchedChunks();
+    return NULL;
+}
+
+void SegmentTracker::prefetchChunks(BaseRepresentation *rep, AbstractConnectionManager *connManager)
+{
+    uint64_t number = prefetched.empty() ? next : prefetched.back().first + 1;
+
+    prefetchRepresentation = rep;
+    while(prefetched.size() < prefetchCount)
+    {
+        /* Only prefetch contiguous segments. Anything else is handled
+         * when the chunk is actually requested. */
+        uint64_t pos;
+        bool b_gap = false;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                number, &pos, &b_gap);
+        if(!segment || b_gap || pos != number)
+            break;
+
+        SegmentChunk *chunk = segment->toChunk(number, rep, connManager);
+        if(!chunk)
+            break;
+        prefetched.push_back(std::pair<uint64_t, SegmentChunk *>(number, chunk));
+        number++;
+    }
+}
+
+void SegmentTracker::flushPrefetchedChunks()
+{
+    while(!prefetched.empty())
+    {
+        delete prefetched.front().second;
+        prefetched.pop_front();
+    }
+    prefetchRepresentation = NULL;
+}
+
 bool SegmentTracker::setPositionByTime(mtime_t time, bool restarted, bool tryonly)
 {
     uint64_t segnumber;
@@ -303,6 +358,7 @@ void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
         index_sent = false;
         init_sent = false;
     }
+    flushPrefetchedChunks();
     curNumber = next = segnumber;
 }
 
@@ -111,7 +111,8 @@ namespace adaptive
     class SegmentTracker
     {
         public:
-            SegmentTracker(AbstractAdaptationLogic *, BaseAdaptationSet *);
+            SegmentTracker(AbstractAdaptationLogic *, BaseAdaptationSet *,
+                           unsigned = 0);
             ~SegmentTracker();
 
             StreamFormat getCurrentFormat() const;
@@ -130,6 +131,9 @@ namespace adaptive
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            SegmentChunk * getPrefetchedChunk(BaseRepresentation *, uint64_t);
+            void prefetchChunks(BaseRepresentation *, AbstractConnectionManager *);
+            void flushPrefetchedChunks();
             bool first;
             bool initializing;
             bool index_sent;
@@ -141,6 +145,10 @@ namespace adaptive
             BaseAdaptationSet *adaptationSet;
             BaseRepresentation *curRepresentation;
             std::list<SegmentTrackerListenerInterface *> listeners;
+            /* media chunks already started ahead of the next one */
+            unsigned prefetchCount;
+            BaseRepresentation *prefetchRepresentation;
+            std::list<std::pair<uint64_t, SegmentChunk *> > prefetched;
     };
 }
 
@@ -75,6 +75,18 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using http access instead of custom http code")
 
+#define ADAPT_DOWNLOADS_TEXT N_("Parallel downloads")
+#define ADAPT_DOWNLOADS_LONGTEXT N_("Maximum number of segments downloaded at the same time")
+
+#define ADAPT_HOST_DOWNLOADS_TEXT N_("Parallel downloads per host")
+#define ADAPT_HOST_DOWNLOADS_LONGTEXT N_("Maximum number of segments downloaded at the same time from a single host")
+
+#define ADAPT_PREFETCH_TEXT N_("Segments prefetch")
+#define ADAPT_PREFETCH_LONGTEXT N_("Number of segments of each stream to start downloading ahead of the current one")
+
+#define ADAPT_RANGE_TEXT N_("Partial requests size (KiB)")
+#define ADAPT_RANGE_LONGTEXT N_("Request segments by byte ranges of this size, so that playback can start before a whole segment is received. 0 disables partial requests.")
+
 static const int pi_logics[] = {AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
                                 AbstractAdaptationLogic::RateBased,
@@ -102,6 +114,15 @@ vlc_module_begin ()
         add_integer( "adaptive-height", 0, ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, true )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_integer( "adaptive-downloads", 4, ADAPT_DOWNLOADS_TEXT, ADAPT_DOWNLOADS_LONGTEXT, true )
+            change_integer_range( 1, 16 )
+        add_integer( "adaptive-host-downloads", 2, ADAPT_HOST_DOWNLOADS_TEXT,
+                     ADAPT_HOST_DOWNLOADS_LONGTEXT, true )
+            change_integer_range( 1, 16 )
+        add_integer( "adaptive-prefetch", 1, ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT, true )
+            change_integer_range( 0, 8 )
+        add_integer( "adaptive-range-size", 0, ADAPT_RANGE_TEXT, ADAPT_RANGE_LONGTEXT, true )
+            change_integer_range( 0, 65536 )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
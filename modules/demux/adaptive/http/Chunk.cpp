@@ -126,6 +126,10 @@ HTTPChunkSource::HTTPChunkSource(const std::string& url, AbstractConnectionManag
     prepared = false;
     eof = false;
     sourceid = id;
+    rangeSize = manager ? manager->getRangeSize() : 0;
+    rangeOffset = 0;
+    rangeLength = 0;
+    rangeReceived = 0;
     if(!init(url))
         eof = true;
 }
@@ -183,9 +187,21 @@ block_t * HTTPChunkSource::read(size_t readsize)
     }
 
     mtime_t time = mdate();
-    ssize_t ret = connection->read(p_block->p_buffer, readsize);
+    size_t copied = 0;
+    ssize_t ret;
+    /* the connection returns the data as it arrives */
+    do
+    {
+        ret = connection->read(&p_block->p_buffer[copied], readsize - copied);
+        if(ret == 0 && requestNextRange())
+            continue;
+        if(ret <= 0)
+            break;
+        copied += ret;
+        rangeReceived += ret;
+    } while(copied < readsize);
     time = mdate() - time;
-    if(ret < 0)
+    if(ret < 0 && copied == 0)
     {
         block_Release(p_block);
         p_block = NULL;
@@ -193,9 +209,9 @@ block_t * HTTPChunkSource::read(size_t readsize)
     }
     else
     {
-        p_block->i_buffer = (size_t) ret;
+        p_block->i_buffer = copied;
         consumed += p_block->i_buffer;
-        if((size_t)ret < readsize)
+        if(copied < readsize)
             eof = true;
         connManager->updateDownloadRate(sourceid, p_block->i_buffer, time);
     }
@@ -218,6 +234,29 @@ bool HTTPChunkSource::prepare()
             return false;
     }
 
+    if(rangeSize)
+    {
+        /* Request the segment by parts, so that it can be read before the
+         * whole segment is available from the server */
+        const size_t start = (bytesRange.isValid() ? bytesRange.getStartByte() : 0)
+                             + rangeOffset;
+        size_t end = start + rangeSize - 1;
+        if(bytesRange.isValid() && bytesRange.getEndByte() &&
+           end > bytesRange.getEndByte())
+            end = bytesRange.getEndByte();
+        rangeLength = end - start + 1;
+        rangeReceived = 0;
+
+        if( connection->request(params.getPath(), BytesRange(start, end)) != VLC_SUCCESS )
+            return false;
+        if(bytesRange.isValid() && bytesRange.getEndByte())
+            contentLength = bytesRange.getEndByte() - bytesRange.getStartByte() + 1;
+        else
+            contentLength = 0;
+        prepared = true;
+        return true;
+    }
+
     if( connection->request(params.getPath(), bytesRange) != VLC_SUCCESS )
         return false;
     /* Because we don't know Chunk size at start, we need to get size
@@ -228,6 +267,20 @@ bool HTTPChunkSource::prepare()
     return true;
 }
 
+bool HTTPChunkSource::requestNextRange()
+{
+    /* A short or full length reply means there is nothing left */
+    if(!rangeSize || !connection || rangeReceived != rangeLength)
+        return false;
+
+    rangeOffset += rangeLength;
+    if(contentLength && rangeOffset >= contentLength)
+        return false;
+
+    prepared = false;
+    return prepare();
+}
+
 block_t * HTTPChunkSource::readBlock()
 {
     return read(HTTPChunkSource::CHUNK_SIZE);
@@ -290,8 +343,8 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     if(readsize < HTTPChunkSource::CHUNK_SIZE)
         readsize = HTTPChunkSource::CHUNK_SIZE;
 
-    if(contentLength && readsize > contentLength - buffered)
-        readsize = contentLength - buffered;
+    if(contentLength && readsize > contentLength - (buffered + consumed))
+        readsize = contentLength - (buffered + consumed);
 
     vlc_mutex_unlock(&lock);
 
@@ -308,7 +361,11 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         mtime_t time;
     } rate = {0,0};
 
+    /* Partial reads: each block is handed to the demuxer as soon as it is
+     * received, whether the reply is chunked or not */
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
+    if(ret == 0 && requestNextRange())
+        ret = connection->read(p_block->p_buffer, readsize);
     if(ret <= 0)
     {
         block_Release(p_block);
@@ -322,10 +379,11 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     else
     {
         p_block->i_buffer = (size_t) ret;
+        rangeReceived += ret;
         vlc_mutex_lock(&lock);
         buffered += p_block->i_buffer;
         block_ChainLastAppend(&pp_tail, p_block);
-        if((size_t) ret < readsize)
+        if(contentLength && buffered + consumed >= contentLength)
         {
             done = true;
             rate.size = buffered + consumed;
@@ -95,16 +95,21 @@ namespace adaptive
 
             protected:
                 virtual bool      prepare();
+                bool              requestNextRange();
                 AbstractConnection    *connection;
                 AbstractConnectionManager *connManager;
                 size_t              consumed; /* read pointer */
                 bool                prepared;
                 bool                eof;
                 ID                  sourceid;
+                ConnectionParams    params;
+                size_t              rangeSize; /* partial requests size, or 0 */
+                size_t              rangeOffset; /* current partial request */
+                size_t              rangeLength;
+                size_t              rangeReceived;
 
             private:
                 bool init(const std::string &);
-                ConnectionParams    params;
         };
 
         class HTTPChunkBufferedSource : public HTTPChunkSource
@@ -26,36 +26,45 @@
 #include <vlc_threads.h>
 #include <vlc_atomic.h>
 
+#include <algorithm>
+
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Downloader(unsigned threads, unsigned hostdownloads)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&donecond);
+    maxThreads = threads ? threads : 1;
+    maxHostDownloads = hostdownloads ? hostdownloads : 1;
     killed = false;
-    thread_handle_valid = false;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 reinterpret_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(threads.size() < maxThreads)
     {
-        return false;
+        vlc_thread_t thread_handle;
+        if(vlc_clone(&thread_handle, downloaderThread,
+                     reinterpret_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        threads.push_back(thread_handle);
     }
-    thread_handle_valid = true;
-    return true;
+    return !threads.empty();
 }
 
 Downloader::~Downloader()
 {
+    vlc_mutex_lock(&lock);
     killed = true;
-    vlc_cond_signal(&waitcond);
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    vlc_cond_broadcast(&waitcond);
+    vlc_mutex_unlock(&lock);
+    std::vector<vlc_thread_t>::const_iterator it;
+    for(it = threads.begin(); it != threads.end(); ++it)
+        vlc_join(*it, NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&donecond);
 }
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
@@ -69,6 +78,12 @@ void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
     chunks.remove(source);
+    /* Wait for the ongoing read to complete */
+    while(std::find(current.begin(), current.end(), source) != current.end())
+    {
+        canceled.push_back(source);
+        vlc_cond_wait(&donecond, &lock);
+    }
     vlc_mutex_unlock(&lock);
 }
 
@@ -87,31 +102,72 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
-void Downloader::Run()
+bool Downloader::isStreamActive(const HTTPChunkBufferedSource *source) const
+{
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = current.begin(); it != current.end(); ++it)
+        if((*it)->sourceid == source->sourceid)
+            return true;
+    return false;
+}
+
+unsigned Downloader::getHostDownloads(const HTTPChunkBufferedSource *source) const
 {
-    while(1)
+    unsigned count = 0;
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = current.begin(); it != current.end(); ++it)
+        if((*it)->params.getHostname() == source->params.getHostname())
+            count++;
+    return count;
+}
+
+HTTPChunkBufferedSource * Downloader::getNextSource() const
+{
+    HTTPChunkBufferedSource *next = NULL;
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
     {
-        vlc_mutex_lock(&lock);
-        if(killed)
-            break;
+        HTTPChunkBufferedSource *source = *it;
+        if(getHostDownloads(source) >= maxHostDownloads)
+            continue;
+        if(!isStreamActive(source))
+            return source;
+        if(!next)
+            next = source;
+    }
+    return next;
+}
 
-        while(chunks.empty() && !killed)
+void Downloader::Run()
+{
+    vlc_mutex_lock(&lock);
+    while(!killed)
+    {
+        HTTPChunkBufferedSource *source = getNextSource();
+        if(!source)
         {
             vlc_cond_wait(&waitcond, &lock);
+            continue;
         }
 
-        if(killed)
-            break;
+        chunks.remove(source);
+        current.push_back(source);
 
-        if(!chunks.empty())
+        while(!killed &&
+              std::find(canceled.begin(), canceled.end(), source) == canceled.end())
         {
-            HTTPChunkBufferedSource *source = chunks.front();
+            vlc_mutex_unlock(&lock);
             DownloadSource(source);
+            vlc_mutex_lock(&lock);
             if(source->isDone())
-                chunks.pop_front();
+                break;
         }
 
-        vlc_mutex_unlock(&lock);
+        current.remove(source);
+        canceled.remove(source);
+        vlc_cond_broadcast(&donecond);
+        /* a host slot is free again */
+        vlc_cond_broadcast(&waitcond);
     }
     vlc_mutex_unlock(&lock);
 }
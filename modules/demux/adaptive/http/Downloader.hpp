@@ -24,6 +24,7 @@
 
 #include <vlc_common.h>
 #include <list>
+#include <vector>
 
 namespace adaptive
 {
@@ -31,10 +32,14 @@ namespace adaptive
     namespace http
     {
 
+        /* Downloads the scheduled sources with up to maxThreads connections,
+         * and at most maxHostDownloads to the same host. Sources of streams
+         * with no ongoing download are picked first, so that the segments
+         * of one stream do not hold back the other ones. */
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1, unsigned = 1);
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
@@ -44,13 +49,19 @@ namespace adaptive
                 static void * downloaderThread(void *);
                 void Run();
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                HTTPChunkBufferedSource * getNextSource() const;
+                bool isStreamActive(const HTTPChunkBufferedSource *) const;
+                unsigned getHostDownloads(const HTTPChunkBufferedSource *) const;
+                std::vector<vlc_thread_t> threads;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                vlc_mutex_t  processlock;
-                bool         thread_handle_valid;
+                vlc_cond_t   donecond;
+                unsigned     maxThreads;
+                unsigned     maxHostDownloads;
                 bool         killed;
                 std::list<HTTPChunkBufferedSource *> chunks;
+                std::list<HTTPChunkBufferedSource *> current;
+                std::list<HTTPChunkBufferedSource *> canceled;
         };
 
     }
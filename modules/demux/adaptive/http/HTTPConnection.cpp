@@ -66,6 +66,9 @@ HTTPConnection::HTTPConnection(vlc_object_t *p_object_, Socket *socket_, bool pe
     queryOk = false;
     retries = 0;
     connectionClose = !persistent;
+    chunked = false;
+    chunked_eof = false;
+    chunkLength = 0;
 }
 
 HTTPConnection::~HTTPConnection()
@@ -99,12 +102,20 @@ void HTTPConnection::disconnect()
     bytesRead = 0;
     contentLength = 0;
     bytesRange = BytesRange();
+    chunked = false;
+    chunked_eof = false;
+    chunkLength = 0;
     socket->disconnect();
 }
 
 int HTTPConnection::request(const std::string &path, const BytesRange &range)
 {
     queryOk = false;
+    bytesRead = 0;
+    contentLength = 0;
+    chunked = false;
+    chunked_eof = false;
+    chunkLength = 0;
 
     /* Set new path for this query */
     params.setPath(path);
@@ -165,6 +176,9 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
 
     queryOk = false;
 
+    if(chunked)
+        return readChunk(p_buffer, len);
+
     const size_t toRead = (contentLength) ? contentLength - bytesRead : len;
     if (toRead == 0)
         return VLC_SUCCESS;
@@ -172,20 +186,72 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
     if(len > toRead)
         len = toRead;
 
-    ssize_t ret = socket->read(p_object, p_buffer, len);
-    if(ret >= 0)
+    /* Return the data as it arrives, so that it can be demuxed before the
+     * whole response is received */
+    ssize_t ret = socket->read(p_object, p_buffer, len, false);
+    if(ret > 0)
         bytesRead += ret;
 
-    if(ret < 0 || (size_t)ret < len || /* set EOF */
-       contentLength == bytesRead )
+    if(ret <= 0 || /* set EOF */
+       (connectionClose && contentLength == bytesRead) )
+        socket->disconnect();
+
+    return ret;
+}
+
+ssize_t HTTPConnection::readChunk(void *p_buffer, size_t len)
+{
+    if(chunkLength == 0)
+    {
+        if(chunked_eof)
+            return 0;
+
+        std::string line = readLine();
+        if(line.empty())
+        {
+            socket->disconnect();
+            return -1;
+        }
+
+        chunkLength = strtoul(line.c_str(), NULL, 16);
+        if(chunkLength == 0)
+        {
+            /* Last chunk, skip trailers */
+            do
+                line = readLine();
+            while(!line.empty() && line.compare("\r\n"));
+            chunked_eof = true;
+            if(connectionClose)
+                socket->disconnect();
+            return 0;
+        }
+    }
+
+    if(len > chunkLength)
+        len = chunkLength;
+
+    ssize_t ret = socket->read(p_object, p_buffer, len, false);
+    if(ret <= 0)
     {
         socket->disconnect();
         return ret;
     }
 
+    bytesRead += ret;
+    chunkLength -= ret;
+    if(chunkLength == 0)
+        readLine(); /* CRLF after the chunk data */
+
     return ret;
 }
 
+bool HTTPConnection::isResponseComplete() const
+{
+    if(chunked)
+        return chunked_eof;
+    return contentLength == bytesRead;
+}
+
 bool HTTPConnection::send(const std::string &data)
 {
     return send(data.c_str(), data.length());
@@ -245,12 +311,14 @@ void HTTPConnection::setUsed( bool b )
     available = !b;
     if(available)
     {
-        if(!connectionClose && contentLength == bytesRead )
+        if(!connectionClose && isResponseComplete() && connected())
         {
             queryOk = false;
             bytesRead = 0;
             contentLength = 0;
             bytesRange = BytesRange();
+            chunked = false;
+            chunked_eof = false;
         }
         else  /* We can't resend request if we haven't finished reading */
             disconnect();
@@ -272,6 +340,12 @@ void HTTPConnection::onHeader(const std::string &key,
     {
         connectionClose = true;
     }
+    else if (key == "Transfer-Encoding" && value.find("chunked") != std::string::npos)
+    {
+        /* the length is only known at the end */
+        chunked = true;
+        contentLength = 0;
+    }
 }
 
 std::string HTTPConnection::buildRequestHeader(const std::string &path) const
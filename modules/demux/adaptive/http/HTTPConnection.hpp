@@ -86,10 +86,15 @@ namespace adaptive
 
                 int parseReply();
                 std::string readLine();
+                ssize_t readChunk(void *p_buffer, size_t len);
+                bool isResponseComplete() const;
                 char * psz_useragent;
 
                 bool                connectionClose;
                 bool                queryOk;
+                bool                chunked;
+                bool                chunked_eof;
+                size_t              chunkLength; /* left in current chunk */
                 int                 retries;
                 static const int    retryCount = 5;
 
@@ -39,6 +39,7 @@ AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
 {
     p_object = p_object_;
     rateObserver = NULL;
+    rangeSize = 0;
 }
 
 AbstractConnectionManager::~AbstractConnectionManager()
@@ -57,12 +58,21 @@ void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *o
     rateObserver = obs;
 }
 
+size_t AbstractConnectionManager::getRangeSize() const
+{
+    return rangeSize;
+}
+
 HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, ConnectionFactory *factory_)
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
-    downloader->start();
+    downloader = new (std::nothrow) Downloader(
+                        var_InheritInteger(p_object, "adaptive-downloads"),
+                        var_InheritInteger(p_object, "adaptive-host-downloads"));
+    if(downloader)
+        downloader->start();
+    rangeSize = var_InheritInteger(p_object, "adaptive-range-size") * 1024;
     if(!factory_)
     {
         if(var_InheritBool(p_object, "adaptive-use-access"))
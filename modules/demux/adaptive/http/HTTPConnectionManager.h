@@ -53,9 +53,11 @@ namespace adaptive
 
                 virtual void updateDownloadRate(const ID &, size_t, mtime_t); /* impl */
                 void setDownloadRateObserver(IDownloadRateObserver *);
+                size_t getRangeSize() const;
 
             protected:
                 vlc_object_t                                       *p_object;
+                size_t                                              rangeSize;
 
             private:
                 IDownloadRateObserver                              *rateObserver;
@@ -24,6 +24,7 @@
 #include "Sockets.hpp"
 
 #include <vlc_network.h>
+#include <vlc_interrupt.h>
 #include <cerrno>
 
 using namespace adaptive::http;
@@ -74,9 +75,18 @@ void Socket::disconnect()
     }
 }
 
-ssize_t Socket::read(vlc_object_t *p_object, void *p_buffer, size_t len)
+ssize_t Socket::read(vlc_object_t *p_object, void *p_buffer, size_t len,
+                     bool waitall)
 {
-    return net_Read(p_object, netfd, p_buffer, len);
+    if(waitall)
+        return net_Read(p_object, netfd, p_buffer, len);
+
+    /* return as soon as some data is available */
+    ssize_t ret;
+    do
+        ret = vlc_recv_i11e(netfd, p_buffer, len, 0);
+    while(ret < 0 && (errno == EINTR || errno == EAGAIN) && !vlc_killed());
+    return ret;
 }
 
 std::string Socket::readline(vlc_object_t *p_object)
@@ -139,9 +149,10 @@ bool TLSSocket::connected() const
     return Socket::connected() && tls;
 }
 
-ssize_t TLSSocket::read(vlc_object_t *, void *p_buffer, size_t len)
+ssize_t TLSSocket::read(vlc_object_t *, void *p_buffer, size_t len,
+                        bool waitall)
 {
-    return vlc_tls_Read(tls, p_buffer, len, true);
+    return vlc_tls_Read(tls, p_buffer, len, waitall);
 }
 
 std::string TLSSocket::readline(vlc_object_t *)
@@ -36,7 +36,8 @@ namespace adaptive
                 virtual bool    connect     (vlc_object_t *, const std::string&, int port = 80);
                 virtual bool    connected   () const;
                 virtual bool    send        (vlc_object_t *, const void *buf, size_t size);
-                virtual ssize_t read        (vlc_object_t *, void *p_buffer, size_t len);
+                virtual ssize_t read        (vlc_object_t *, void *p_buffer, size_t len,
+                                             bool waitall = true);
                 virtual std::string readline(vlc_object_t *);
                 virtual void    disconnect  ();
                 int     getType() const;
@@ -56,7 +57,8 @@ namespace adaptive
                 virtual bool    connect     (vlc_object_t *, const std::string&, int port = 443);
                 virtual bool    connected   () const;
                 virtual bool    send        (vlc_object_t *, const void *buf, size_t size);
-                virtual ssize_t read        (vlc_object_t *, void *p_buffer, size_t len);
+                virtual ssize_t read        (vlc_object_t *, void *p_buffer, size_t len,
+                                             bool waitall = true);
                 virtual std::string readline(vlc_object_t *);
                 virtual void    disconnect  ();
                 static const int TLS = REGULAR + 1;
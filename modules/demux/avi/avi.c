@@ -45,6 +45,7 @@
 
 #include "libavi.h"
 #include "../rawdv.h"
+#include "../seekindex.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -227,6 +228,8 @@ static int AVI_PacketSearch   ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
 static void AVI_IndexCreate  ( demux_t * );
+static bool AVI_IndexCacheLoad( demux_t * );
+static void AVI_IndexCacheSave( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -2598,6 +2601,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     mtime_t i_dialog_update;
     vlc_dialog_id *p_dialog_id = NULL;
+    bool b_cache = true; /* save the created index */
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
@@ -2611,6 +2615,13 @@ static void AVI_IndexCreate( demux_t *p_demux )
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
         avi_index_Init( &p_sys->track[i_stream]->idx );
 
+    /* The index may have been built by a previous run */
+    if( AVI_IndexCacheLoad( p_demux ) )
+    {
+        b_cache = false;
+        goto print_stat;
+    }
+
     i_movi_end = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
                         stream_Size( p_demux->s ) );
 
@@ -2636,7 +2647,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         if( p_dialog_id != NULL && mdate() - i_dialog_update > 100000 )
         {
             if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
+            {
+                b_cache = false;
                 break;
+            }
 
             double f_current = vlc_stream_Tell( p_demux->s );
             double f_size    = stream_Size( p_demux->s );
@@ -2676,7 +2690,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
                     msg_Dbg( p_demux, "looking for new RIFF chunk" );
                     if( vlc_stream_Seek( p_demux->s,
                                          p_sysx->i_chunk_pos + 24 ) )
+                    {
+                        b_cache = false;
                         goto print_stat;
+                    }
                     break;
                 }
                 goto print_stat;
@@ -2694,6 +2711,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
                 if( AVI_PacketSearch( p_demux ) )
                 {
                     msg_Warn( p_demux, "lost sync, abord index creation" );
+                    b_cache = false;
                     goto print_stat;
                 }
             }
@@ -2707,6 +2725,9 @@ static void AVI_IndexCreate( demux_t *p_demux )
     }
 
 print_stat:
+    if( b_cache )
+        AVI_IndexCacheSave( p_demux );
+
     if( p_dialog_id != NULL )
         vlc_dialog_release( p_demux, p_dialog_id );
 
@@ -2717,6 +2738,65 @@ print_stat:
     }
 }
 
+/* Cache of the index created from LIST-movi */
+static bool AVI_IndexCacheLoad( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_count;
+
+    demux_index_entry_t *p_entries =
+        demux_IndexCacheLoad( p_demux, "avi", &i_count );
+    if( !p_entries )
+        return false;
+
+    for( size_t i = 0; i < i_count; i++ )
+    {
+        if( p_entries[i].i_track >= p_sys->i_track )
+            continue;
+
+        avi_entry_t index;
+        index.i_id      = p_entries[i].i_type;
+        index.i_flags   = p_entries[i].i_flags;
+        index.i_pos     = p_entries[i].i_pos;
+        index.i_length  = p_entries[i].i_length;
+        avi_index_Append( &p_sys->track[p_entries[i].i_track]->idx,
+                          &p_sys->i_movi_lastchunk_pos, &index );
+    }
+    free( p_entries );
+    return true;
+}
+
+static void AVI_IndexCacheSave( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_count = 0;
+
+    for( unsigned i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+        i_count += p_sys->track[i_stream]->idx.i_size;
+
+    demux_index_entry_t *p_entries = calloc( i_count, sizeof( *p_entries ) );
+    if( !p_entries )
+        return;
+
+    i_count = 0;
+    for( unsigned i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i_stream]->idx;
+        for( unsigned i = 0; i < p_index->i_size; i++ )
+        {
+            demux_index_entry_t *p_entry = &p_entries[i_count++];
+            p_entry->i_track  = i_stream;
+            p_entry->i_type   = p_index->p_entry[i].i_id;
+            p_entry->i_flags  = p_index->p_entry[i].i_flags;
+            p_entry->i_pos    = p_index->p_entry[i].i_pos;
+            p_entry->i_length = p_index->p_entry[i].i_length;
+        }
+    }
+
+    demux_IndexCacheSave( p_demux, "avi", p_entries, i_count );
+    free( p_entries );
+}
+
 /* */
 static void AVI_MetaLoad( demux_t *p_demux,
                           avi_chunk_list_t *p_riff, avi_chunk_avih_t *p_avih )
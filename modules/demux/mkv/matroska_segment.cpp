@@ -28,6 +28,7 @@
 #include "util.hpp"
 #include "Ebml_parser.hpp"
 #include "Ebml_dispatcher.hpp"
+#include "../seekindex.h"
 
 #include <new>
 
@@ -60,11 +61,15 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,ep(NULL)
     ,b_preloaded(false)
     ,b_ref_external_segments(false)
+    ,b_index_cache(false)
+    ,i_index_cache_count(0)
 {
 }
 
 matroska_segment_c::~matroska_segment_c()
 {
+    SaveIndexCache();
+
     for( tracks_map_t::iterator it = tracks.begin(); it != tracks.end(); ++it)
     {
         tracks_map_t::mapped_type& track = it->second;
@@ -686,6 +691,7 @@ bool matroska_segment_c::Preload( )
 
     b_preloaded = true;
 
+    LoadIndexCache();
     EnsureDuration();
 
     return true;
@@ -1066,6 +1072,124 @@ void matroska_segment_c::EnsureDuration()
     es.I_O().setFilePointer( i_current_position, seek_beginning );
 }
 
+/*****************************************************************************
+ * Index cache: segments without Cues are indexed while seeking and playing,
+ * keep that index for the next time the same file is opened
+ *****************************************************************************/
+static const vlc_fourcc_t INDEX_SEEKPOINT = VLC_FOURCC('s','e','e','k');
+static const vlc_fourcc_t INDEX_CLUSTER   = VLC_FOURCC('c','l','s','t');
+static const vlc_fourcc_t INDEX_RANGE     = VLC_FOURCC('r','n','g','e');
+static const vlc_fourcc_t INDEX_DURATION  = VLC_FOURCC('d','u','r','a');
+
+void matroska_segment_c::LoadIndexCache()
+{
+    /* only the segments of the demuxed file itself */
+    b_index_cache = !b_cues && segment != NULL && !sys.streams.empty() &&
+                    sys.streams.front()->p_estream == &es;
+    if( !b_index_cache )
+        return;
+
+    char psz_key[32];
+    snprintf( psz_key, sizeof( psz_key ), "mkv-%" PRIu64,
+              static_cast<uint64_t>( segment->GetElementPosition() ) );
+
+    size_t i_count;
+    demux_index_entry_t *p_entries = demux_IndexCacheLoad( &sys.demuxer, psz_key, &i_count );
+    if( p_entries == NULL )
+        return;
+
+    for( size_t i = 0; i < i_count; i++ )
+    {
+        const demux_index_entry_t & entry = p_entries[i];
+
+        if( entry.i_type == INDEX_SEEKPOINT )
+        {
+            _seeker.add_seekpoint( entry.i_track, static_cast<int32_t>( entry.i_flags ),
+                                   entry.i_pos, entry.i_time );
+        }
+        else if( entry.i_type == INDEX_CLUSTER )
+        {
+            if( !std::binary_search( _seeker._cluster_positions.begin(),
+                                     _seeker._cluster_positions.end(), entry.i_pos ) )
+                _seeker.add_cluster_position( entry.i_pos );
+        }
+        else if( entry.i_type == INDEX_RANGE )
+        {
+            _seeker.mark_range_as_searched(
+                SegmentSeeker::Range( entry.i_pos, entry.i_pos + entry.i_length ) );
+        }
+        else if( entry.i_type == INDEX_DURATION && i_duration <= 0 )
+        {
+            i_duration = entry.i_time;
+        }
+    }
+
+    i_index_cache_count = i_count;
+    free( p_entries );
+}
+
+void matroska_segment_c::SaveIndexCache()
+{
+    if( !b_index_cache )
+        return;
+
+    std::vector<demux_index_entry_t> entries;
+    demux_index_entry_t entry;
+
+    memset( &entry, 0, sizeof( entry ) );
+    entry.i_type = INDEX_SEEKPOINT;
+    for( SegmentSeeker::tracks_seekpoints_t::const_iterator it = _seeker._tracks_seekpoints.begin();
+         it != _seeker._tracks_seekpoints.end(); ++it )
+    {
+        entry.i_track = it->first;
+        for( SegmentSeeker::seekpoints_t::const_iterator sp = it->second.begin();
+             sp != it->second.end(); ++sp )
+        {
+            entry.i_flags = static_cast<uint32_t>( sp->trust_level );
+            entry.i_pos   = sp->fpos;
+            entry.i_time  = sp->pts;
+            entries.push_back( entry );
+        }
+    }
+
+    memset( &entry, 0, sizeof( entry ) );
+    entry.i_type = INDEX_CLUSTER;
+    for( SegmentSeeker::cluster_positions_t::const_iterator it = _seeker._cluster_positions.begin();
+         it != _seeker._cluster_positions.end(); ++it )
+    {
+        entry.i_pos = *it;
+        entries.push_back( entry );
+    }
+
+    memset( &entry, 0, sizeof( entry ) );
+    entry.i_type = INDEX_RANGE;
+    for( SegmentSeeker::ranges_t::const_iterator it = _seeker._ranges_searched.begin();
+         it != _seeker._ranges_searched.end(); ++it )
+    {
+        entry.i_pos    = it->start;
+        entry.i_length = it->end - it->start;
+        entries.push_back( entry );
+    }
+
+    if( i_duration > 0 )
+    {
+        memset( &entry, 0, sizeof( entry ) );
+        entry.i_type = INDEX_DURATION;
+        entry.i_time = i_duration;
+        entries.push_back( entry );
+    }
+
+    /* nothing learnt since the index was loaded */
+    if( entries.size() <= i_index_cache_count )
+        return;
+
+    char psz_key[32];
+    snprintf( psz_key, sizeof( psz_key ), "mkv-%" PRIu64,
+              static_cast<uint64_t>( segment->GetElementPosition() ) );
+
+    demux_IndexCacheSave( &sys.demuxer, psz_key, &entries[0], entries.size() );
+}
+
 bool matroska_segment_c::ESCreate()
 {
     /* add all es */
@@ -133,6 +133,8 @@ public:
     EbmlParser                     *ep;
     bool                           b_preloaded;
     bool                           b_ref_external_segments;
+    bool                           b_index_cache;
+    size_t                         i_index_cache_count;
 
     bool Preload();
     bool PreloadFamily( const matroska_segment_c & segment );
@@ -170,6 +172,8 @@ private:
     int32_t TrackInit( mkv_track_t * p_tk );
     void ComputeTrackPriority();
     void EnsureDuration();
+    void LoadIndexCache();
+    void SaveIndexCache();
 
     SegmentSeeker _seeker;
 
@@ -36,6 +36,7 @@
 #include <assert.h>
 #include <limits.h>
 #include "../codec/cc.h"
+#include "../seekindex.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -86,6 +87,10 @@ struct demux_sys_t
 
     mp4_fragments_t fragments;
 
+    /* moof positions from the index cache, when fragments are not probed */
+    demux_index_entry_t *p_moof_index;
+    size_t          i_moof_index;
+
     struct
     {
         mp4_fragment_t *p_fragment;
@@ -137,9 +142,13 @@ static void MP4_GetDefaultSizeAndDuration( demux_t *p_demux,
 static bool AddFragment( demux_t *p_demux, MP4_Box_t *p_moox );
 static int  ProbeFragments( demux_t *p_demux, bool b_force );
 static int  ProbeIndex( demux_t *p_demux );
+static bool LeafIndexCacheLoad( demux_t *p_demux );
+static void LeafIndexCacheSave( demux_t *p_demux );
 
 static int LeafIndexGetMoofPosByTime( demux_t *p_demux, const mtime_t i_target_time,
                                       uint64_t *pi_pos, mtime_t *pi_mooftime );
+static int LeafIndexCacheGetMoofPosByTime( demux_t *p_demux, const mtime_t i_target_time,
+                                           uint64_t *pi_pos, mtime_t *pi_mooftime );
 static int LeafGetTrackAndChunkByMOOVPos( demux_t *p_demux, uint64_t *pi_pos,
                                       mp4_track_t **pp_tk, unsigned int *pi_chunk );
 static int LeafMapTrafTrunContextes( demux_t *p_demux, MP4_Box_t *p_moof );
@@ -212,6 +221,18 @@ static es_out_id_t * MP4_AddTrackES( es_out_t *out, mp4_track_t *p_track )
     return p_es;
 }
 
+/* Sample count of a dts/pts run of a chunk: the first run can start within
+ * a stts/ctts entry shared with the previous chunk */
+static inline uint32_t MP4_ChunkRunDTS( const mp4_chunk_t *ck, uint32_t i_index )
+{
+    return ck->p_sample_count_dts[i_index] - ( i_index ? 0 : ck->i_skip_dts );
+}
+
+static inline uint32_t MP4_ChunkRunPTS( const mp4_chunk_t *ck, uint32_t i_index )
+{
+    return ck->p_sample_count_pts[i_index] - ( i_index ? 0 : ck->i_skip_pts );
+}
+
 /* Return time in microsecond of a track */
 static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 {
@@ -228,16 +249,16 @@ static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 
     while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
+        uint32_t i_run = MP4_ChunkRunDTS( p_chunk, i_index );
+        if( i_sample > i_run )
         {
-            i_dts += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
+            i_dts += (int64_t) i_run * p_chunk->p_sample_delta_dts[i_index];
+            i_sample -= i_run;
             i_index++;
         }
         else
         {
-            i_dts += i_sample * p_chunk->p_sample_delta_dts[i_index];
+            i_dts += (int64_t) i_sample * p_chunk->p_sample_delta_dts[i_index];
             break;
         }
     }
@@ -284,14 +305,15 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track,
 
     for( i_index = 0; i_index < ck->i_entries_pts ; i_index++ )
     {
-        if( i_sample < ck->p_sample_count_pts[i_index] )
+        uint32_t i_run = MP4_ChunkRunPTS( ck, i_index );
+        if( i_sample < i_run )
         {
             *pi_delta = ck->p_sample_offset_pts[i_index] * CLOCK_FREQ /
                         (int64_t)p_track->i_timescale;
             return true;
         }
 
-        i_sample -= ck->p_sample_count_pts[i_index];
+        i_sample -= i_run;
     }
     return false;
 }
@@ -586,12 +608,16 @@ static int Open( vlc_object_t * p_this )
     {
         if ( p_sys->b_seekable )
         {
+            /* Fragments found by a previous probing spare reading the whole file */
+            LeafIndexCacheLoad( p_demux );
+
             /* Probe remaining to check if there's really fragments
                or if that file is just ready to append fragments */
             ProbeFragments( p_demux, false );
             p_sys->b_fragmented = !!MP4_BoxCount( p_sys->p_root, "/moof" );
 
-            if ( p_sys->b_fragmented && !p_sys->i_overall_duration )
+            if ( p_sys->b_fragmented && !p_sys->i_overall_duration &&
+                 !p_sys->p_moof_index )
                 ProbeFragments( p_demux, true );
 
             MP4_Box_t *p_mdat = MP4_BoxGet( p_sys->p_root, "mdat" );
@@ -823,6 +849,8 @@ static int Open( vlc_object_t * p_this )
         MP4_Box_t *p_mehd = MP4_BoxGet( p_demux->p_sys->p_root, "moov/mvex/mehd");
         if ( p_mehd && p_mehd->data.p_mehd )
             p_sys->i_overall_duration = p_mehd->data.p_mehd->i_fragment_duration;
+        else if ( p_sys->p_moof_index )
+            p_sys->i_overall_duration = p_sys->p_moof_index[p_sys->i_moof_index].i_time;
         else
         {
             for( i = 0; i < p_sys->i_tracks; i++ )
@@ -830,6 +858,8 @@ static int Open( vlc_object_t * p_this )
                 mtime_t i_duration = GetTrackTotalDuration( &p_sys->fragments, p_sys->track[i].i_track_ID );
                 p_sys->i_overall_duration = __MAX( p_sys->i_overall_duration, (uint64_t)i_duration );
             }
+            if ( p_sys->b_fragmented && p_sys->b_fragments_probed )
+                LeafIndexCacheSave( p_demux );
         }
     }
 
@@ -1338,7 +1368,8 @@ static int LeafSeekToTime( demux_t *p_demux, mtime_t i_nztime )
     {
         mtime_t i_mooftime;
         msg_Dbg( p_demux, "seek can't find matching fragment for %"PRId64", trying index", i_nztime );
-        if ( LeafIndexGetMoofPosByTime( p_demux, i_nztime, &i64, &i_mooftime ) == VLC_SUCCESS )
+        if ( LeafIndexGetMoofPosByTime( p_demux, i_nztime, &i64, &i_mooftime ) == VLC_SUCCESS ||
+             LeafIndexCacheGetMoofPosByTime( p_demux, i_nztime, &i64, &i_mooftime ) == VLC_SUCCESS )
         {
             msg_Dbg( p_demux, "seek trying to go to unknown but indexed fragment at %"PRId64, i64 );
             if( vlc_stream_Seek( p_demux->s, i64 ) )
@@ -1785,6 +1816,7 @@ static void Close ( vlc_object_t * p_this )
         vlc_input_title_Delete( p_sys->p_title );
 
     MP4_Fragments_Clean( &p_sys->fragments );
+    free( p_sys->p_moof_index );
 
     free( p_sys );
 }
@@ -1992,9 +2024,11 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
 
         ck->i_first_dts = 0;
         ck->i_entries_dts = 0;
+        ck->i_skip_dts = 0;
         ck->p_sample_count_dts = NULL;
         ck->p_sample_delta_dts = NULL;
         ck->i_entries_pts = 0;
+        ck->i_skip_pts = 0;
         ck->p_sample_count_pts = NULL;
         ck->p_sample_offset_pts = NULL;
     }
@@ -2048,52 +2082,36 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
-static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
-                              const uint32_t i_index,
-                              uint32_t i_index_samples_left,
-                              uint32_t i_sample_count,
-                              const uint32_t *pi_index_sample_count,
-                              const uint32_t i_table_count )
+/* Maps the samples of a chunk onto a stts/ctts run table, from the entry
+ * *pi_index of which *pi_skip samples belong to the previous chunks.
+ * The table is not expanded: chunks only keep where their window starts */
+static void xTTS_MapChunk( demux_t *p_demux, uint32_t *pi_entry /* out */,
+                           uint32_t *pi_index, uint32_t *pi_skip,
+                           uint32_t i_sample_count,
+                           const uint32_t *pi_index_sample_count,
+                           const uint32_t i_table_count )
 {
-    uint32_t i_array_offset;
+    *pi_entry = 0;
     while( i_sample_count > 0 )
     {
-        if ( likely((UINT32_MAX - i_index) >= *pi_entry) )
-            i_array_offset = i_index + *pi_entry;
-        else
-            return VLC_EGENERIC;
-
-        if ( i_array_offset >= i_table_count )
+        if ( *pi_index >= i_table_count )
         {
-            msg_Err( p_demux, "invalid index counting total samples %u %u", i_array_offset,  i_table_count );
-            return VLC_ENOVAR;
+            msg_Err( p_demux, "invalid index counting total samples %u %u", *pi_index,  i_table_count );
+            return;
         }
 
-        if ( i_index_samples_left )
-        {
-            if ( i_index_samples_left > i_sample_count )
-            {
-                i_index_samples_left -= i_sample_count;
-                i_sample_count = 0;
-                *pi_entry +=1; /* No samples left, go copy */
-                break;
-            }
-            else
-            {
-                i_sample_count -= i_index_samples_left;
-                i_index_samples_left = 0;
-                *pi_entry += 1;
-                continue;
-            }
-        }
-        else
+        uint32_t i_run = pi_index_sample_count[*pi_index] - *pi_skip;
+        *pi_entry += 1;
+        if ( i_run > i_sample_count )
         {
-            i_sample_count -= __MIN( i_sample_count, pi_index_sample_count[i_array_offset] );
-            *pi_entry += 1;
+            /* next chunk continues within the same entry */
+            *pi_skip += i_sample_count;
+            return;
         }
+        i_sample_count -= i_run;
+        *pi_skip = 0;
+        *pi_index += 1;
     }
-
-    return VLC_SUCCESS;
 }
 
 static int TrackCreateSamplesIndex( demux_t *p_demux,
@@ -2128,18 +2146,9 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     }
     else
     {
-        /* 2: each sample can have a different size */
+        /* 2: each sample can have a different size, use the stsz table */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
     }
 
     if ( p_demux_track->i_chunk_count )
@@ -2172,12 +2181,9 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
     /* Use stts table to create a sample number -> dts table.
      * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
+     *  the box! so each chunk only points to the part of the table it uses
+     *  (problem with raw stream where a sample is sometime just
+     *  channels*bits_per_sample/8, and with long recordings) */
 
     mtime_t i_next_dts = 0;
     /* Find stts
@@ -2195,96 +2201,36 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-        /* Create sample -> dts table per chunk */
+        /* Map each chunk on the sample -> dts table */
         uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        uint32_t i_skip = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
 
             /* save first dts */
             ck->i_first_dts = i_next_dts;
             ck->i_last_dts  = i_next_dts;
 
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            ck->i_entries_dts = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_dts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            ck->p_sample_delta_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
+            if( i_index < stts->i_entry_count )
             {
-                free( ck->p_sample_count_dts );
-                free( ck->p_sample_delta_dts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_dts );
-                ck->i_entries_dts = 0;
-                return VLC_ENOMEM;
+                ck->p_sample_count_dts = &stts->pi_sample_count[i_index];
+                ck->p_sample_delta_dts = &stts->pi_sample_delta[i_index];
+                ck->i_skip_dts = i_skip;
             }
+            xTTS_MapChunk( p_demux, &ck->i_entries_dts, &i_index, &i_skip,
+                           ck->i_sample_count,
+                           stts->pi_sample_count, stts->i_entry_count );
 
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
+            /* compute the dts of the next chunk */
+            uint32_t i_sample_count = ck->i_sample_count;
             for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
             {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        if ( i_sample_count ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        if ( i_current_index_samples_left ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        if ( i_sample_count ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        if ( stts->pi_sample_count[i_index] ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
+                uint32_t i_run = __MIN( MP4_ChunkRunDTS( ck, i ), i_sample_count );
+                if ( i_run ) ck->i_last_dts = i_next_dts;
+                i_next_dts += (int64_t) i_run * ck->p_sample_delta_dts[i];
+                i_sample_count -= i_run;
             }
         }
     }
@@ -2300,85 +2246,23 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "CTTS table of %"PRIu32" entries", ctts->i_entry_count );
 
-        /* Create pts-dts table per chunk */
+        /* Map each chunk on the pts-dts table */
         uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        uint32_t i_skip = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            ck->i_entries_pts = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_pts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( ck->i_entries_pts, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( ck->i_entries_pts, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-            {
-                free( ck->p_sample_count_pts );
-                free( ck->p_sample_offset_pts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_pts );
-                ck->i_entries_pts = 0;
-                return VLC_ENOMEM;
-            }
 
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
+            if( i_index < ctts->i_entry_count )
             {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-
+                ck->p_sample_count_pts = &ctts->pi_sample_count[i_index];
+                ck->p_sample_offset_pts = &ctts->pi_sample_offset[i_index];
+                ck->i_skip_pts = i_skip;
             }
+            xTTS_MapChunk( p_demux, &ck->i_entries_pts, &i_index, &i_skip,
+                           ck->i_sample_count,
+                           ctts->pi_sample_count, ctts->i_entry_count );
         }
     }
 
@@ -2550,17 +2434,22 @@ static int TrackGetNearestSeekPoint( demux_t *p_demux, mp4_track_t *p_track,
         const MP4_Box_data_stss_t *p_stss_data = BOXDATA(p_stss);
         msg_Dbg( p_demux, "track[Id 0x%x] using Sync Sample Box (stss)",
                  p_track->i_track_ID );
-        for( unsigned i_index = 0; i_index < p_stss_data->i_entry_count; i_index++ )
+        if( p_stss_data->i_entry_count > 0 )
         {
-            if( i_index >= p_stss_data->i_entry_count - 1 ||
-                i_sample < p_stss_data->i_sample_number[i_index+1] )
+            /* last sync sample before i_sample (or the first one) */
+            uint32_t i_low = 0, i_high = p_stss_data->i_entry_count;
+            while( i_high - i_low > 1 )
             {
-                *pi_sync_sample = p_stss_data->i_sample_number[i_index];
-                msg_Dbg( p_demux, "stss gives %d --> %" PRIu32 " (sample number)",
-                         i_sample, *pi_sync_sample );
-                i_ret = VLC_SUCCESS;
-                break;
+                uint32_t i_mid = i_low + ( i_high - i_low ) / 2;
+                if( i_sample >= p_stss_data->i_sample_number[i_mid] )
+                    i_low = i_mid;
+                else
+                    i_high = i_mid;
             }
+            *pi_sync_sample = p_stss_data->i_sample_number[i_low];
+            msg_Dbg( p_demux, "stss gives %d --> %" PRIu32 " (sample number)",
+                     i_sample, *pi_sync_sample );
+            i_ret = VLC_SUCCESS;
         }
     }
 
@@ -2618,7 +2507,6 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     uint64_t     i_dts;
     unsigned int i_sample;
     unsigned int i_chunk;
-    int          i_index;
 
     /* FIXME see if it's needed to check p_track->i_chunk_count */
     if( p_track->i_chunk_count == 0 )
@@ -2662,49 +2550,40 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = i_start * p_track->i_timescale / CLOCK_FREQ;
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
     /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
+    /* last chunk starting before i_start, chunks are in dts order */
+    unsigned int i_low = 0, i_high = p_track->i_chunk_count;
+    while( i_high - i_low > 1 )
     {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
-
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
+        unsigned int i_mid = i_low + ( i_high - i_low ) / 2;
+        if( (uint64_t)i_start >= p_track->chunk[i_mid].i_first_dts )
+            i_low = i_mid;
+        else
+            i_high = i_mid;
     }
+    i_chunk = i_low;
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
+    const mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    uint32_t i_sample_count = ck->i_sample_count;
+    i_sample = ck->i_sample_first;
+    i_dts    = ck->i_first_dts;
+    for( uint32_t i_index = 0;
+         i_index < ck->i_entries_dts && i_sample_count > 0; i_index++ )
     {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
-        {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+        uint32_t i_run = __MIN( MP4_ChunkRunDTS( ck, i_index ), i_sample_count );
 
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
-            i_index++;
+        if( i_dts + (uint64_t)i_run * ck->p_sample_delta_dts[i_index] < (uint64_t)i_start )
+        {
+            i_dts          += (uint64_t)i_run * ck->p_sample_delta_dts[i_index];
+            i_sample       += i_run;
+            i_sample_count -= i_run;
         }
         else
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
-            {
+            if( ck->p_sample_delta_dts[i_index] <= 0 )
                 break;
-            }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+            i_sample += ( i_start - i_dts ) / ck->p_sample_delta_dts[i_index];
             break;
         }
     }
@@ -3162,11 +3041,7 @@ static void MP4_TrackDestroy( demux_t *p_demux, mp4_track_t *p_track )
     if( p_track->p_es )
         es_out_Del( p_demux->out, p_track->p_es );
 
-    if( p_track->chunk )
-    {
-        for( unsigned int i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-            DestroyChunk( &p_track->chunk[i_chunk] );
-    }
+    /* moov chunks only point to the sample tables */
     free( p_track->chunk );
 
     if( p_track->cchunk )
@@ -3176,9 +3051,6 @@ static void MP4_TrackDestroy( demux_t *p_demux, mp4_track_t *p_track )
         free( p_track->cchunk );
     }
 
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
-
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
 }
@@ -3744,7 +3616,7 @@ static int MP4_frg_GetChunk( demux_t *p_demux, MP4_Box_t *p_chunk, unsigned *i_t
                                    &default_size, &default_duration );
 
     ret->p_sample_count_dts = calloc( ret->i_sample_count, sizeof( uint32_t ) );
-    ret->p_sample_delta_dts = calloc( ret->i_sample_count, sizeof( uint32_t ) );
+    ret->p_sample_delta_dts = calloc( ret->i_sample_count, sizeof( int32_t ) );
 
     if( !ret->p_sample_count_dts || !ret->p_sample_delta_dts )
     {
@@ -4366,7 +4238,7 @@ static int ProbeFragments( demux_t *p_demux, bool b_force )
 
     assert( p_sys->p_root );
 
-    if ( p_sys->b_fastseekable || b_force )
+    if ( ( p_sys->b_fastseekable && !p_sys->p_moof_index ) || b_force )
     {
         MP4_ReadBoxContainerChildren( p_demux->s, p_sys->p_root, NULL ); /* Get the rest of the file */
         p_sys->b_fragments_probed = true;
@@ -4402,6 +4274,90 @@ static int ProbeFragments( demux_t *p_demux, bool b_force )
     return VLC_SUCCESS;
 }
 
+/* Fragments probing reads the whole file when there's no overall duration,
+ * so keep the results: the duration and the moof positions for seeking.
+ * The duration entry is stored last, after the moof ones */
+static bool LeafIndexCacheLoad( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_count;
+
+    /* not set yet, the moov fragment is added while probing */
+    MP4_Box_t *p_mvhd = MP4_BoxGet( p_sys->p_root, "/moov/mvhd" );
+    if ( !p_mvhd || !BOXDATA(p_mvhd) || !BOXDATA(p_mvhd)->i_timescale ||
+         MP4_BoxGet( p_sys->p_root, "/moov/mvex/mehd" ) )
+        return false;
+
+    demux_index_entry_t *p_entries = demux_IndexCacheLoad( p_demux, "mp4", &i_count );
+    if ( !p_entries )
+        return false;
+
+    /* the duration is stored last */
+    if ( p_entries[i_count - 1].i_type != ATOM_mehd ||
+         p_entries[i_count - 1].i_length != BOXDATA(p_mvhd)->i_timescale )
+    {
+        free( p_entries );
+        return false;
+    }
+
+    p_sys->p_moof_index = p_entries;
+    p_sys->i_moof_index = i_count - 1;
+    return true;
+}
+
+static void LeafIndexCacheSave( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mp4_fragment_t *p_moov = MP4_Fragment_Moov( &p_sys->fragments );
+    size_t i_count = 1;
+
+    if ( !p_sys->i_overall_duration || !p_sys->i_timescale )
+        return;
+
+    /* fragments times are those of the first track of the first moof */
+    unsigned i_track_ID = 0;
+    for ( mp4_fragment_t *p_fragment = p_moov->p_next; p_fragment;
+          p_fragment = p_fragment->p_next )
+    {
+        if ( !i_track_ID && p_fragment->i_durations )
+            i_track_ID = p_fragment->p_durations[0].i_track_ID;
+        i_count++;
+    }
+
+    demux_index_entry_t *p_entries = calloc( i_count, sizeof( *p_entries ) );
+    if ( !p_entries )
+        return;
+
+    stime_t i_time = 0;
+    size_t i_entry = 0;
+    for ( mp4_fragment_t *p_fragment = p_moov; p_fragment;
+          p_fragment = p_fragment->p_next )
+    {
+        if ( p_fragment != p_moov && p_fragment->p_moox )
+        {
+            p_entries[i_entry].i_type = ATOM_moof;
+            p_entries[i_entry].i_pos  = p_fragment->p_moox->i_pos;
+            p_entries[i_entry].i_time = i_time;
+            i_entry++;
+        }
+
+        if ( p_fragment == p_moov && !p_fragment->i_chunk_range_max_offset )
+            continue;
+        for ( unsigned i = 0; i < p_fragment->i_durations; i++ )
+        {
+            if ( p_fragment->p_durations[i].i_track_ID == i_track_ID )
+                i_time += p_fragment->p_durations[i].i_duration;
+        }
+    }
+
+    p_entries[i_entry].i_type   = ATOM_mehd;
+    p_entries[i_entry].i_time   = p_sys->i_overall_duration;
+    p_entries[i_entry].i_length = p_sys->i_timescale;
+
+    demux_IndexCacheSave( p_demux, "mp4", p_entries, i_entry + 1 );
+    free( p_entries );
+}
+
 static int LeafParseTRUN( demux_t *p_demux, mp4_track_t *p_track,
                       const uint32_t i_defaultduration, const uint32_t i_defaultsize,
                       const MP4_Box_data_trun_t *p_trun, uint32_t * const pi_mdatlen )
@@ -4590,18 +4546,18 @@ static inline mtime_t LeafGetMOOVTimeInChunk( const mp4_chunk_t *p_chunk, uint32
     mtime_t i_time = 0;
     uint32_t i_index = 0;
 
-    while( i_sample > 0 )
+    while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
+        uint32_t i_run = MP4_ChunkRunDTS( p_chunk, i_index );
+        if( i_sample > i_run )
         {
-            i_time += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
+            i_time += (int64_t) i_run * p_chunk->p_sample_delta_dts[i_index];
+            i_sample -= i_run;
             i_index++;
         }
         else
         {
-            i_time += i_sample * p_chunk->p_sample_delta_dts[i_index];
+            i_time += (int64_t) i_sample * p_chunk->p_sample_delta_dts[i_index];
             break;
         }
     }
@@ -4894,6 +4850,35 @@ static int LeafIndexGetMoofPosByTime( demux_t *p_demux, const mtime_t i_target_t
     return VLC_EGENERIC;
 }
 
+static int LeafIndexCacheGetMoofPosByTime( demux_t *p_demux, const mtime_t i_target_time,
+                                           uint64_t *pi_pos, mtime_t *pi_mooftime )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const demux_index_entry_t *p_found = NULL;
+
+    /* last moof starting before the target */
+    size_t i_low = 0, i_high = p_sys->i_moof_index;
+    while ( i_low < i_high )
+    {
+        size_t i_mid = i_low + ( i_high - i_low ) / 2;
+        const demux_index_entry_t *p_entry = &p_sys->p_moof_index[i_mid];
+        if ( CLOCK_FREQ * p_entry->i_time / p_sys->i_timescale <= i_target_time )
+        {
+            p_found = p_entry;
+            i_low = i_mid + 1;
+        }
+        else
+            i_high = i_mid;
+    }
+
+    if ( !p_found )
+        return VLC_EGENERIC;
+
+    *pi_pos = p_found->i_pos;
+    *pi_mooftime = CLOCK_FREQ * p_found->i_time / p_sys->i_timescale;
+    return VLC_SUCCESS;
+}
+
 static void MP4_GetDefaultSizeAndDuration( demux_t *p_demux,
                                            const MP4_Box_data_tfhd_t *p_tfhd_data,
                                            uint32_t *pi_default_size,
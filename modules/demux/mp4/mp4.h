@@ -46,11 +46,16 @@ typedef struct
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_last_dts;    /* DTS of the last sample */
 
+    /* When not fragmented, these point into the stts/ctts tables, starting
+       at the first entry used by this chunk, of which i_skip_* samples
+       belong to the previous chunks */
     uint32_t     i_entries_dts;
+    uint32_t     i_skip_dts;
     uint32_t     *p_sample_count_dts;
-    uint32_t     *p_sample_delta_dts;   /* dts delta */
+    int32_t      *p_sample_delta_dts;   /* dts delta */
 
     uint32_t     i_entries_pts;
+    uint32_t     i_skip_pts;
     uint32_t     *p_sample_count_pts;
     int32_t      *p_sample_offset_pts;  /* pts-dts */
 
@@ -113,8 +118,7 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-                                    too much time to do sumations each time*/
+    const uint32_t   *p_sample_size; /* stsz table */
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
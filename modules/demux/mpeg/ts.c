@@ -177,7 +177,12 @@ static bool ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt );
 static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk, size_t, bool );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, mtime_t i_pcr );
 
-static block_t* ReadTSPacket( demux_t *p_demux );
+static block_t* ReadTSPacket( demux_t *p_demux, block_t *p_pkt );
+static int64_t TSStreamTell( demux_t *p_demux );
+static int TSStreamSeek( demux_t *p_demux, uint64_t i_pos );
+static void FlushTSBatch( demux_sys_t * );
+static bool RewindTSBatch( demux_t * );
+static void InsertTSDescrambler( demux_t * );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, int64_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, mtime_t );
@@ -374,6 +379,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->vdr = vdr;
 
     p_sys->arib.b25stream = NULL;
+    p_sys->arib.b_b25pending = false;
     p_sys->stream = p_demux->s;
 
     p_sys->b_broken_charset = false;
@@ -383,6 +389,14 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    p_sys->batch.i_size = p_sys->i_ts_read * i_packet_size;
+    p_sys->batch.p_buffer = malloc( p_sys->batch.i_size );
+    if( !p_sys->batch.p_buffer )
+    {
+        vlc_mutex_destroy( &p_sys->csa_lock );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
@@ -395,6 +409,7 @@ static int Open( vlc_object_t *p_this )
     if ( !PIDSetup( p_demux, TYPE_PAT, patpid, NULL ) )
     {
         vlc_mutex_destroy( &p_sys->csa_lock );
+        free( p_sys->batch.p_buffer );
         free( p_sys );
         return VLC_ENOMEM;
     }
@@ -402,6 +417,7 @@ static int Open( vlc_object_t *p_this )
     {
         PIDRelease( p_demux, patpid );
         vlc_mutex_destroy( &p_sys->csa_lock );
+        free( p_sys->batch.p_buffer );
         free( p_sys );
         return VLC_EGENERIC;
     }
@@ -557,6 +573,7 @@ static void Close( vlc_object_t *p_this )
     /* Release all non default pids */
     ts_pid_list_Release( p_demux, &p_sys->pids );
 
+    free( p_sys->batch.p_buffer );
     free( p_sys );
 }
 
@@ -601,15 +618,20 @@ static int Demux( demux_t *p_demux )
     for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
     {
         bool         b_frame = false;
+        block_t      pkt; /* view into the read batch, never released */
         block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+
+        if( p_sys->arib.b_b25pending && RewindTSBatch( p_demux ) )
+            InsertTSDescrambler( p_demux );
+
+        if( !(p_pkt = ReadTSPacket( p_demux, &pkt )) )
         {
             return VLC_DEMUXER_EOF;
         }
 
-        if( p_sys->b_start_record )
+        /* Enable recording once synchronized, from the next packet on */
+        if( p_sys->b_start_record && RewindTSBatch( p_demux ) )
         {
-            /* Enable recording once synchronized */
             vlc_stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE, true,
                                 "ts" );
             p_sys->b_start_record = false;
@@ -639,10 +661,7 @@ static int Demux( demux_t *p_demux )
             PCRHandle( p_demux, p_pid, i_pcr );
 
         if ( SCRAMBLED(*p_pid) && !p_demux->p_sys->csa && p_sys->b_valid_scrambling )
-        {
-            block_Release( p_pkt );
             continue;
-        }
 
         /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
         if( !SEEN( GetPID( p_sys, 0 ) ) &&
@@ -659,7 +678,6 @@ static int Demux( demux_t *p_demux )
         case TYPE_PAT:
         case TYPE_PMT:
             ts_psi_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
             break;
 
         case TYPE_PES:
@@ -675,27 +693,26 @@ static int Demux( demux_t *p_demux )
             if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
             {
                 /* That packet is for an unselected ES, don't waste time/memory gathering its data */
-                block_Release( p_pkt );
                 continue;
             }
 
-            b_frame = ProcessTSPacket( p_demux, p_pid, p_pkt );
+            /* Only PES payload outlives the batch, so copy it out */
+            p_pkt = block_Duplicate( p_pkt );
+            if( likely(p_pkt) )
+                b_frame = ProcessTSPacket( p_demux, p_pid, p_pkt );
             break;
 
         case TYPE_SI:
             ts_si_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
             break;
 
         case TYPE_PSIP:
             ts_psip_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
             break;
 
         case TYPE_CAT:
         default:
             /* We have to handle PCR if present */
-            block_Release( p_pkt );
             break;
         }
 
@@ -880,7 +897,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            int64_t offset = vlc_stream_Tell( p_sys->stream );
+            int64_t offset = TSStreamTell( p_demux );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -926,7 +943,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         i64 = stream_Size( p_sys->stream );
         if( i64 > 0 &&
-            vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+            TSStreamSeek( p_demux, (int64_t)(i64 * f) ) == VLC_SUCCESS )
         {
             ReadyQueuesPostSeek( p_demux );
             return VLC_SUCCESS;
@@ -1057,9 +1074,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 
     case DEMUX_SET_TITLE:
+        FlushTSBatch( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_TITLE, args );
 
     case DEMUX_SET_SEEKPOINT:
+        FlushTSBatch( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_SEEKPOINT,
                                      args );
 
@@ -1582,14 +1601,115 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid )
     ParsePES( p_demux, pid, p_datachain );
 }
 
-static block_t* ReadTSPacket( demux_t *p_demux )
+/* Refills the packet batch with a single stream read, keeping any unread
+ * bytes at the front. Only waits for the data already available, so that
+ * live sources are not delayed until the whole batch is filled.
+ * While the stream is to be changed (recording, descrambler), reads stop at
+ * the next packet boundary instead, so that the batch can be consumed and
+ * the change made between two packets of the stream.
+ * Returns false on EOF or read error. */
+static bool ReadTSBatch( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    size_t i_left = p_sys->batch.i_data - p_sys->batch.i_offset;
+    if( i_left > 0 && p_sys->batch.i_offset > 0 )
+        memmove( p_sys->batch.p_buffer,
+                 &p_sys->batch.p_buffer[p_sys->batch.i_offset], i_left );
+    p_sys->batch.i_offset = 0;
+    p_sys->batch.i_data = i_left;
+
+    ssize_t i_read;
+    if( p_sys->b_start_record || p_sys->arib.b_b25pending )
+        i_read = vlc_stream_Read( p_sys->stream,
+                                  &p_sys->batch.p_buffer[i_left],
+                                  p_sys->i_packet_size -
+                                  i_left % p_sys->i_packet_size );
+    else
+        i_read = vlc_stream_ReadPartial( p_sys->stream,
+                                         &p_sys->batch.p_buffer[i_left],
+                                         p_sys->batch.i_size - i_left );
+    if( i_read <= 0 )
+        return false;
+    p_sys->batch.i_data += i_read;
+    return true;
+}
+
+static void FlushTSBatch( demux_sys_t *p_sys )
+{
+    p_sys->batch.i_data = 0;
+    p_sys->batch.i_offset = 0;
+}
+
+/* Logical position of the next packet, accounting for buffered bytes */
+static int64_t TSStreamTell( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
+    return vlc_stream_Tell( p_sys->stream ) -
+           (p_sys->batch.i_data - p_sys->batch.i_offset);
+}
 
-    block_t     *p_pkt;
+static int TSStreamSeek( demux_t *p_demux, uint64_t i_pos )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    FlushTSBatch( p_sys );
+    return vlc_stream_Seek( p_sys->stream, i_pos );
+}
+
+/* Leaves the stream at the next packet to demux, with no packets read ahead:
+ * the unread packets of the batch are dropped, and read again after seeking
+ * back. Returns false if they remain, as the stream cannot seek. */
+static bool RewindTSBatch( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->batch.i_offset == p_sys->batch.i_data )
+        return true;
+    if( !p_sys->b_canseek ||
+        vlc_stream_Seek( p_sys->stream, TSStreamTell( p_demux ) ) )
+        return false;
+    FlushTSBatch( p_sys );
+    return true;
+}
+
+static void InsertTSDescrambler( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    p_sys->arib.b25stream = vlc_stream_FilterNew( p_demux->s, "aribcam" );
+    p_sys->stream = ( p_sys->arib.b25stream ) ? p_sys->arib.b25stream : p_demux->s;
+    p_sys->arib.b_b25pending = false;
+}
+
+/* Inserts the ARIB descrambler before the packets not demuxed yet. If the
+ * packets read ahead cannot be read again, they are demuxed first. */
+void SetTSDescrambler( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( RewindTSBatch( p_demux ) )
+        InsertTSDescrambler( p_demux );
+    else
+        p_sys->arib.b_b25pending = true;
+}
+
+/* Returns the next packet as a view into the read batch, initialized in
+ * p_pkt. The view is only valid until the next call and must not be released:
+ * use block_Duplicate() to keep its content. */
+static block_t* ReadTSPacket( demux_t *p_demux, block_t *p_pkt )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_packet_size = p_sys->i_packet_size;
+    const size_t i_header_size = p_sys->i_packet_header_size;
 
     /* Get a new TS packet */
-    if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
+    while( p_sys->batch.i_data - p_sys->batch.i_offset < i_packet_size )
+    {
+        if( !ReadTSBatch( p_demux ) )
+            break;
+    }
+
+    if( p_sys->batch.i_data - p_sys->batch.i_offset < TS_HEADER_SIZE + i_header_size )
     {
         int64_t size = stream_Size( p_sys->stream );
         if( size >= 0 && (uint64_t)size == vlc_stream_Tell( p_sys->stream ) )
@@ -1599,62 +1719,61 @@ static block_t* ReadTSPacket( demux_t *p_demux )
         return NULL;
     }
 
-    if( p_pkt->i_buffer < TS_HEADER_SIZE + p_sys->i_packet_header_size )
-    {
-        block_Release( p_pkt );
-        return NULL;
-    }
-
-    /* Skip header (BluRay streams).
-     * re-sync logic would do this (by adjusting packet start), but this would result in losing first and last ts packets.
-     * First packet is usually PAT, and losing it means losing whole first GOP. This is fatal with still-image based menus.
-     */
-    p_pkt->p_buffer += p_sys->i_packet_header_size;
-    p_pkt->i_buffer -= p_sys->i_packet_header_size;
-
     /* Check sync byte and re-sync if needed */
-    if( p_pkt->p_buffer[0] != 0x47 )
+    if( p_sys->batch.p_buffer[p_sys->batch.i_offset + i_header_size] != 0x47 )
     {
         msg_Warn( p_demux, "lost synchro" );
-        block_Release( p_pkt );
         for( ;; )
         {
-            const uint8_t *p_peek;
-            int i_peek = 0;
-            unsigned i_skip = 0;
+            /* Look for 2 consecutive sync bytes in what is left of the batch */
+            const uint8_t *p_peek = &p_sys->batch.p_buffer[p_sys->batch.i_offset];
+            size_t i_peek = p_sys->batch.i_data - p_sys->batch.i_offset;
+            size_t i_skip = 0;
 
-            i_peek = vlc_stream_Peek( p_sys->stream, &p_peek,
-                    p_sys->i_packet_size * 10 );
-            if( i_peek < 0 || (unsigned)i_peek < p_sys->i_packet_size + 1 )
+            if( i_peek < i_packet_size + i_header_size + 1 )
             {
-                msg_Dbg( p_demux, "eof ?" );
-                return NULL;
+                if( !ReadTSBatch( p_demux ) )
+                {
+                    msg_Dbg( p_demux, "eof ?" );
+                    return NULL;
+                }
+                continue;
             }
 
-            while( i_skip < i_peek - p_sys->i_packet_size )
+            while( i_skip + i_header_size + i_packet_size < i_peek )
             {
-                if( p_peek[i_skip + p_sys->i_packet_header_size] == 0x47 &&
-                        p_peek[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
+                if( p_peek[i_skip + i_header_size] == 0x47 &&
+                        p_peek[i_skip + i_header_size + i_packet_size] == 0x47 )
                 {
                     break;
                 }
                 i_skip++;
             }
-            msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
-            if (vlc_stream_Read( p_sys->stream, NULL, i_skip ) != i_skip)
-                return NULL;
+            msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skip );
+            p_sys->batch.i_offset += i_skip;
 
-            if( i_skip < i_peek - p_sys->i_packet_size )
-            {
+            if( i_skip + i_header_size + i_packet_size < i_peek )
                 break;
+
+            /* Not found: keep the tail, which may hold a sync start */
+            if( !ReadTSBatch( p_demux ) )
+            {
+                msg_Dbg( p_demux, "eof ?" );
+                return NULL;
             }
         }
-        if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
-        {
-            msg_Dbg( p_demux, "eof ?" );
-            return NULL;
-        }
     }
+
+    size_t i_size = __MIN( i_packet_size,
+                           p_sys->batch.i_data - p_sys->batch.i_offset );
+    uint8_t *p_data = &p_sys->batch.p_buffer[p_sys->batch.i_offset];
+    p_sys->batch.i_offset += i_size;
+
+    /* Skip header (BluRay streams).
+     * re-sync logic would do this (by adjusting packet start), but this would result in losing first and last ts packets.
+     * First packet is usually PAT, and losing it means losing whole first GOP. This is fatal with still-image based menus.
+     */
+    block_Init( p_pkt, p_data + i_header_size, i_size - i_header_size );
     return p_pkt;
 }
 
@@ -1776,12 +1895,12 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
-        return vlc_stream_Seek( p_sys->stream, 0 );
+        return TSStreamSeek( p_demux, 0 );
 
     if( !p_sys->b_canfastseek )
         return VLC_EGENERIC;
 
-    int64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    int64_t i_initial_pos = TSStreamTell( p_demux );
 
     /* Find the time position by using binary search algorithm. */
     int64_t i_head_pos = 0;
@@ -1797,21 +1916,22 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
         int64_t i_div = i_splitpos % p_sys->i_packet_size;
         i_splitpos -= i_div;
 
-        if ( vlc_stream_Seek( p_sys->stream, i_splitpos ) != VLC_SUCCESS )
+        if ( TSStreamSeek( p_demux, i_splitpos ) != VLC_SUCCESS )
             break;
 
         int64_t i_pos = i_splitpos;
         while( i_pos > -1 && i_pos < i_tail_pos )
         {
             int64_t i_pcr = -1;
-            block_t *p_pkt = ReadTSPacket( p_demux );
+            block_t pkt;
+            block_t *p_pkt = ReadTSPacket( p_demux, &pkt );
             if( !p_pkt )
             {
                 i_head_pos = i_tail_pos;
                 break;
             }
             else
-                i_pos = vlc_stream_Tell( p_sys->stream );
+                i_pos = TSStreamTell( p_demux );
 
             int i_pid = PIDGet( p_pkt );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
@@ -1844,7 +1964,6 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
                     }
                 }
             }
-            block_Release( p_pkt );
 
             if( i_pcr != -1 )
             {
@@ -1866,7 +1985,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
     if( !b_found )
     {
         msg_Dbg( p_demux, "Seek():cannot find a time position." );
-        vlc_stream_Seek( p_sys->stream, i_initial_pos );
+        TSStreamSeek( p_demux, i_initial_pos );
         return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
@@ -1878,13 +1997,14 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
 {
     demux_sys_t *p_sys = p_demux->p_sys;
     int i_count = 0;
+    block_t pkt;
     block_t *p_pkt = NULL;
 
     for( ;; )
     {
         *pi_pcr = -1;
 
-        if( i_count++ > PROBE_CHUNK_COUNT || !( p_pkt = ReadTSPacket( p_demux ) ) )
+        if( i_count++ > PROBE_CHUNK_COUNT || !( p_pkt = ReadTSPacket( p_demux, &pkt ) ) )
         {
             break;
         }
@@ -1959,8 +2079,6 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
                 }
             }
         }
-
-        block_Release( p_pkt );
     }
 
     return i_count;
@@ -1969,7 +2087,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
 int ProbeStart( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const int64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const int64_t i_initial_pos = TSStreamTell( p_demux );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = 0;
@@ -1982,7 +2100,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_pos = p_sys->i_packet_size * i_probe_count;
         i_pos = __MIN( i_pos, i_stream_size );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TSStreamSeek( p_demux, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, false, &i_pcr, &b_found );
@@ -1991,7 +2109,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_probe_count += PROBE_CHUNK_COUNT;
     } while( i_pos > 0 && (i_pcr == -1 || !b_found) && i_probe_count < (2 * PROBE_CHUNK_COUNT) );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TSStreamSeek( p_demux, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2000,7 +2118,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
 int ProbeEnd( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const int64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const int64_t i_initial_pos = TSStreamTell( p_demux );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = PROBE_CHUNK_COUNT;
@@ -2013,7 +2131,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_pos = i_stream_size - (p_sys->i_packet_size * i_probe_count);
         i_pos = __MAX( i_pos, 0 );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TSStreamSeek( p_demux, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, true, &i_pcr, &b_found );
@@ -2022,7 +2140,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_probe_count += PROBE_CHUNK_COUNT;
     } while( i_pos > 0 && (i_pcr == -1 || !b_found) && i_probe_count < (6 * PROBE_CHUNK_COUNT) );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TSStreamSeek( p_demux, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
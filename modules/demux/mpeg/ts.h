@@ -60,6 +60,15 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* Batch of raw packets read with a single stream call */
+    struct
+    {
+        uint8_t    *p_buffer; /* i_ts_read packets */
+        size_t      i_size;
+        size_t      i_data;   /* valid bytes in p_buffer */
+        size_t      i_offset; /* start of next unread packet */
+    } batch;
+
     bool        b_force_seek_per_percent;
 
     ts_standards_e standard;
@@ -70,6 +79,7 @@ struct demux_sys_t
         arib_instance_t *p_instance;
 #endif
         stream_t     *b25stream;
+        bool          b_b25pending; /* insert b25stream once the batch is read */
     } arib;
 
     /* All pid */
@@ -126,6 +136,8 @@ struct demux_sys_t
 
 void TsChangeStandard( demux_sys_t *, ts_standards_e );
 
+void SetTSDescrambler( demux_t * );
+
 bool ProgramIsSelected( demux_sys_t *, uint16_t i_pgrm );
 
 void UpdatePESFilters( demux_t *p_demux, bool b_all );
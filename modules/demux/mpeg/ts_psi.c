@@ -1659,10 +1659,7 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
             {
                 en50221_capmt_Delete( p_en );
                 if ( p_sys->standard == TS_STANDARD_ARIB && !p_sys->arib.b25stream )
-                {
-                    p_sys->arib.b25stream = vlc_stream_FilterNew( p_demux->s, "aribcam" );
-                    p_sys->stream = ( p_sys->arib.b25stream ) ? p_sys->arib.b25stream : p_demux->s;
-                }
+                    SetTSDescrambler( p_demux );
             }
         }
     }
@@ -0,0 +1,223 @@
+/*****************************************************************************
+ * seekindex.c: persistent seek index cache for demuxers
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_configuration.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+#include "seekindex.h"
+
+/* The index files are only read back by the host that wrote them,
+ * so the entries are stored in native byte order */
+#define INDEX_MAGIC     "VLCIDX01"
+#define INDEX_MAX_COUNT (UINT32_C(1) << 26)
+
+typedef struct
+{
+    char     magic[8];
+    uint32_t i_entry_size;
+    uint32_t i_count;
+    uint64_t i_file_size;
+    int64_t  i_file_mtime;
+} index_header_t;
+
+static char *IndexCacheDir( void )
+{
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    char *psz_dir;
+
+    if( psz_cachedir == NULL )
+        return NULL;
+    if( asprintf( &psz_dir, "%s" DIR_SEP "index", psz_cachedir ) == -1 )
+        psz_dir = NULL;
+    free( psz_cachedir );
+    return psz_dir;
+}
+
+static void IndexCacheCreateDir( char *psz_dir )
+{
+    /* create the parent directories as well */
+    for( char *psz = strchr( psz_dir + 1, DIR_SEP_CHAR ); psz != NULL;
+         psz = strchr( psz + 1, DIR_SEP_CHAR ) )
+    {
+        *psz = '\0';
+        vlc_mkdir( psz_dir, 0700 );
+        *psz = DIR_SEP_CHAR;
+    }
+    vlc_mkdir( psz_dir, 0700 );
+}
+
+/* Returns the index file path, and the header matching the current file */
+static char *IndexCachePath( demux_t *p_demux, const char *psz_key,
+                             index_header_t *p_hdr )
+{
+    struct stat st;
+
+    if( p_demux->psz_file == NULL ||
+        !var_InheritBool( p_demux, "demux-index-cache" ) ||
+        vlc_stat( p_demux->psz_file, &st ) )
+        return NULL;
+
+    memset( p_hdr, 0, sizeof( *p_hdr ) );
+    memcpy( p_hdr->magic, INDEX_MAGIC, sizeof( p_hdr->magic ) );
+    p_hdr->i_entry_size = sizeof( demux_index_entry_t );
+    p_hdr->i_file_size = st.st_size;
+    p_hdr->i_file_mtime = st.st_mtime;
+
+    /* Index files are named after the file path and the key */
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, p_demux->psz_file, strlen( p_demux->psz_file ) + 1 );
+    AddMD5( &md5, psz_key, strlen( psz_key ) );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    char *psz_dir = IndexCacheDir();
+    char *psz_path;
+
+    if( psz_hash == NULL || psz_dir == NULL ||
+        asprintf( &psz_path, "%s" DIR_SEP "%s", psz_dir, psz_hash ) == -1 )
+        psz_path = NULL;
+    free( psz_dir );
+    free( psz_hash );
+    return psz_path;
+}
+
+demux_index_entry_t *demux_IndexCacheLoad( demux_t *p_demux,
+                                           const char *psz_key,
+                                           size_t *pi_count )
+{
+    index_header_t hdr, cached;
+    demux_index_entry_t *p_entries = NULL;
+
+    *pi_count = 0;
+
+    char *psz_path = IndexCachePath( p_demux, psz_key, &hdr );
+    if( psz_path == NULL )
+        return NULL;
+
+    FILE *file = vlc_fopen( psz_path, "rb" );
+    if( file == NULL )
+        goto end;
+
+    if( fread( &cached, sizeof( cached ), 1, file ) != 1 ||
+        memcmp( cached.magic, hdr.magic, sizeof( hdr.magic ) ) ||
+        cached.i_entry_size != hdr.i_entry_size ||
+        cached.i_file_size != hdr.i_file_size ||
+        cached.i_file_mtime != hdr.i_file_mtime ||
+        cached.i_count == 0 || cached.i_count > INDEX_MAX_COUNT )
+    {
+        msg_Dbg( p_demux, "no valid %s index in cache", psz_key );
+        goto end;
+    }
+
+    p_entries = malloc( cached.i_count * sizeof( *p_entries ) );
+    if( p_entries == NULL )
+        goto end;
+
+    if( fread( p_entries, sizeof( *p_entries ), cached.i_count, file )
+            != cached.i_count )
+    {
+        free( p_entries );
+        p_entries = NULL;
+        goto end;
+    }
+
+    *pi_count = cached.i_count;
+    msg_Dbg( p_demux, "loaded %"PRIu32" %s index entries from cache",
+             cached.i_count, psz_key );
+
+end:
+    if( file != NULL )
+        fclose( file );
+    free( psz_path );
+    return p_entries;
+}
+
+int demux_IndexCacheSave( demux_t *p_demux, const char *psz_key,
+                          const demux_index_entry_t *p_entries,
+                          size_t i_count )
+{
+    index_header_t hdr;
+
+    if( i_count == 0 || i_count > INDEX_MAX_COUNT )
+        return VLC_EGENERIC;
+
+    char *psz_path = IndexCachePath( p_demux, psz_key, &hdr );
+    if( psz_path == NULL )
+        return VLC_EGENERIC;
+
+    char *psz_dir = IndexCacheDir();
+    char *psz_tmp;
+    int i_ret = VLC_EGENERIC;
+
+    if( psz_dir == NULL || asprintf( &psz_tmp, "%s.tmp", psz_path ) == -1 )
+    {
+        free( psz_dir );
+        free( psz_path );
+        return VLC_ENOMEM;
+    }
+
+    IndexCacheCreateDir( psz_dir );
+    free( psz_dir );
+
+    /* Write to a temporary file, so that concurrent instances never read a
+     * partial index */
+    FILE *file = vlc_fopen( psz_tmp, "wb" );
+    if( file == NULL )
+    {
+        msg_Dbg( p_demux, "cannot create %s: %s", psz_tmp, vlc_strerror_c(errno) );
+        goto end;
+    }
+
+    hdr.i_count = i_count;
+    if( fwrite( &hdr, sizeof( hdr ), 1, file ) != 1 ||
+        fwrite( p_entries, sizeof( *p_entries ), i_count, file ) != i_count )
+    {
+        fclose( file );
+        vlc_unlink( psz_tmp );
+        goto end;
+    }
+
+    if( fclose( file ) || vlc_rename( psz_tmp, psz_path ) )
+    {
+        vlc_unlink( psz_tmp );
+        goto end;
+    }
+
+    msg_Dbg( p_demux, "saved %zu %s index entries to cache", i_count, psz_key );
+    i_ret = VLC_SUCCESS;
+
+end:
+    free( psz_tmp );
+    free( psz_path );
+    return i_ret;
+}
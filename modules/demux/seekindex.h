@@ -0,0 +1,69 @@
+/*****************************************************************************
+ * seekindex.h: persistent seek index cache for demuxers
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_DEMUX_SEEKINDEX_H
+#define VLC_DEMUX_SEEKINDEX_H
+
+#include <vlc_demux.h>
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/**
+ * Index entry, the meaning of each field is up to the demuxer, which can
+ * use i_type to store different kinds of entries.
+ */
+typedef struct
+{
+    int64_t      i_time;
+    uint64_t     i_pos;
+    uint64_t     i_length;
+    uint32_t     i_track;
+    uint32_t     i_flags;
+    vlc_fourcc_t i_type;
+    uint32_t     i_reserved;
+} demux_index_entry_t;
+
+/**
+ * Loads the index entries previously saved for the file being demuxed.
+ *
+ * The index is only used if the demux-index-cache option is set, if the
+ * input is a local file and if that file has not been modified since.
+ *
+ * \param psz_key identifies the index within the file (demuxer name...)
+ * \param pi_count number of returned entries
+ * \return entries to be freed by the caller, or NULL
+ */
+demux_index_entry_t *demux_IndexCacheLoad( demux_t *, const char *psz_key,
+                                           size_t *pi_count );
+
+/**
+ * Saves the index entries of the file being demuxed, replacing any
+ * previous index stored with the same key.
+ */
+int demux_IndexCacheSave( demux_t *, const char *psz_key,
+                          const demux_index_entry_t *, size_t i_count );
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
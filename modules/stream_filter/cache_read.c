@@ -483,6 +483,8 @@ static int AStreamControl(stream_t *s, int i_query, va_list args)
         case STREAM_GET_META:
         case STREAM_GET_CONTENT_TYPE:
         case STREAM_GET_SIGNAL:
+        case STREAM_GET_VALIDATOR:
+        case STREAM_GET_READ_STATS:
         case STREAM_SET_PAUSE_STATE:
         case STREAM_SET_PRIVATE_ID_STATE:
         case STREAM_SET_PRIVATE_ID_CA:
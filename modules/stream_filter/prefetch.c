@@ -61,8 +61,45 @@ struct stream_sys_t
     char        *buffer;
     size_t       read_size;
     size_t       seek_threshold;
+
+    /* Adaptive sizing: the configured values are the limits */
+    size_t       buffer_max;
+    size_t       seek_min;
+    uint64_t     source_size;
+
+    struct
+    {
+        mtime_t  since; /**< start of the current measurement period */
+        uint64_t consumed; /**< bytes read by the consumer in the period */
+        uint64_t consume_rate; /**< consumption rate (bytes/s) */
+        uint64_t source_rate; /**< source throughput while reading (bytes/s) */
+        mtime_t  latency; /**< delay before the first byte after a seek */
+        bool     after_seek;
+        unsigned seeks;
+        unsigned resizes;
+        bool     publish; /**< whether the variables are out of date */
+    } stats;
 };
 
+/* Minimum size of a single background read */
+#define READ_MIN 4096
+/* Maximum size of a single background read */
+#define READ_MAX (4 << 20)
+/* Duration a single background read should take at the measured throughput */
+#define READ_DURATION (CLOCK_FREQ / 20)
+/* Minimum buffer size */
+#define BUFFER_MIN (64 << 10)
+/* Duration of consumption the buffer should hold */
+#define BUFFER_DURATION (4 * CLOCK_FREQ)
+/* Measurement period for the consumption rate */
+#define STATS_PERIOD CLOCK_FREQ
+
+/* Exponentially weighted moving average, the new sample weighing 1/8 */
+static uint64_t Smooth(uint64_t average, uint64_t sample)
+{
+    return average ? (average * 7 + sample) / 8 : sample;
+}
+
 static void ThreadRead(stream_t *stream, size_t length)
 {
     stream_sys_t *sys = stream->p_sys;
@@ -79,7 +116,9 @@ static void ThreadRead(stream_t *stream, size_t length)
     assert(length > 0);
 
     char *p = sys->buffer + offset;
+    mtime_t start = mdate();
     ssize_t val = vlc_stream_ReadPartial(stream->p_source, p, length);
+    mtime_t duration = mdate() - start;
 
     if (val == 0)
         msg_Dbg(stream, "end of stream");
@@ -92,6 +131,41 @@ static void ThreadRead(stream_t *stream, size_t length)
 
     if (val == 0)
         sys->eof = true;
+    else if (sys->stats.after_seek)
+    {   /* The first read after a seek mostly measures the source latency */
+        sys->stats.latency = Smooth(sys->stats.latency, duration);
+        sys->stats.after_seek = false;
+    }
+    else
+    {
+        if (duration <= 0)
+            duration = 1;
+        sys->stats.source_rate = Smooth(sys->stats.source_rate,
+                                        val * CLOCK_FREQ / duration);
+
+        /* Size the next reads so that they complete in about READ_DURATION
+         * at the measured throughput: large reads for fast sources, short
+         * reads (hence low latency) for slow ones. */
+        uint64_t read_size = sys->stats.source_rate * READ_DURATION
+                             / CLOCK_FREQ;
+        if (read_size < READ_MIN)
+            read_size = READ_MIN;
+        if (read_size > READ_MAX)
+            read_size = READ_MAX;
+        if (read_size > sys->buffer_size)
+            read_size = sys->buffer_size;
+        sys->read_size = read_size;
+
+        /* Forward seeking costs about one latency period, during which the
+         * source could as well have delivered that many bytes. */
+        uint64_t threshold = sys->stats.source_rate * sys->stats.latency
+                             / CLOCK_FREQ;
+        if (threshold < sys->seek_min)
+            threshold = sys->seek_min;
+        if (threshold > SIZE_MAX)
+            threshold = SIZE_MAX;
+        sys->seek_threshold = threshold;
+    }
 
     assert((size_t)val <= length);
     sys->buffer_length += val;
@@ -119,9 +193,109 @@ static int ThreadSeek(stream_t *stream, uint64_t seek_offset)
     sys->buffer_offset = seek_offset;
     sys->buffer_length = 0;
     sys->eof = false;
+    sys->stats.after_seek = true;
+    sys->stats.seeks++;
     return 0;
 }
 
+/**
+ * Reallocates the circular buffer, preserving its content.
+ * Historical data is discarded first if the buffer shrinks.
+ */
+static void ThreadResize(stream_t *stream, size_t size)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    if (sys->buffer_length > size)
+    {
+        uint64_t history = 0;
+
+        if (sys->stream_offset > sys->buffer_offset)
+            history = sys->stream_offset - sys->buffer_offset;
+        if (history > sys->buffer_length)
+            history = sys->buffer_length;
+        if (sys->buffer_length - history > size)
+            return; /* Never discard unread data */
+
+        size_t discard = sys->buffer_length - size;
+        sys->buffer_offset += discard;
+        sys->buffer_length -= discard;
+    }
+
+    char *buffer = malloc(size);
+    if (unlikely(buffer == NULL))
+        return;
+
+    /* Both buffers are indexed by the stream offset modulo their size */
+    uint64_t offset = sys->buffer_offset;
+    size_t length = sys->buffer_length;
+
+    while (length > 0)
+    {
+        size_t from = offset % sys->buffer_size;
+        size_t to = offset % size;
+        size_t copy = length;
+
+        if (copy > sys->buffer_size - from)
+            copy = sys->buffer_size - from;
+        if (copy > size - to)
+            copy = size - to;
+
+        memcpy(buffer + to, sys->buffer + from, copy);
+        offset += copy;
+        length -= copy;
+    }
+
+    free(sys->buffer);
+    sys->buffer = buffer;
+    sys->buffer_size = size;
+    if (sys->read_size > size)
+        sys->read_size = size;
+    sys->stats.resizes++;
+}
+
+/**
+ * Updates the consumption rate and adjusts the buffer size accordingly.
+ */
+static void ThreadStats(stream_t *stream)
+{
+    stream_sys_t *sys = stream->p_sys;
+    mtime_t now = mdate();
+    mtime_t period = now - sys->stats.since;
+
+    if (period < STATS_PERIOD)
+        return;
+
+    sys->stats.consume_rate = Smooth(sys->stats.consume_rate,
+                                     sys->stats.consumed * CLOCK_FREQ / period);
+    sys->stats.consumed = 0;
+    sys->stats.since = now;
+
+    /* Hold a few seconds worth of consumption, and a few reads at least */
+    uint64_t target = sys->stats.consume_rate * BUFFER_DURATION / CLOCK_FREQ;
+    if (target < 4 * (uint64_t)sys->read_size)
+        target = 4 * (uint64_t)sys->read_size;
+    if (target < BUFFER_MIN)
+        target = BUFFER_MIN;
+    if (target > sys->buffer_max)
+        target = sys->buffer_max;
+    if (target > sys->source_size)
+        target = sys->source_size;
+
+    /* Grow eagerly, shrink lazily */
+    if (target > sys->buffer_size || target < sys->buffer_size / 4)
+    {
+        size_t old_size = sys->buffer_size;
+
+        ThreadResize(stream, target);
+        if (sys->buffer_size != old_size)
+            msg_Dbg(stream, "resized buffer from %zu to %zu bytes",
+                    old_size, sys->buffer_size);
+    }
+
+    sys->stats.publish = true;
+}
+
 static int ThreadControl(stream_t *stream, int query, ...)
 {
     stream_sys_t *sys = stream->p_sys;
@@ -141,9 +315,6 @@ static int ThreadControl(stream_t *stream, int query, ...)
     return ret;
 }
 
-#define MAX_READ 65536
-#define SEEK_THRESHOLD MAX_READ
-
 static void *Thread(void *data)
 {
     stream_t *stream = data;
@@ -156,6 +327,8 @@ static void *Thread(void *data)
     mutex_cleanup_push(&sys->lock);
     for (;;)
     {
+        ThreadStats(stream);
+
         if (paused)
         {
             if (sys->paused)
@@ -191,6 +364,8 @@ static void *Thread(void *data)
          * Unread data is however given precedence if the buffer is full. */
         uint64_t history = sys->stream_offset - sys->buffer_offset;
 
+        /* Small skips within the predicted window are filled by reading
+         * through, which is cheaper than paying the seek latency. */
         if (sys->can_seek
          && history >= (sys->buffer_length + sys->seek_threshold))
         {   /* Large skip: seek forward */
@@ -237,7 +412,7 @@ static void *Thread(void *data)
         /* Some streams cannot return a short data count and just wait for all
          * requested data to become available (e.g. regular files). So we have
          * to limit the data read in a single operation to avoid blocking for
-         * too long. */
+         * too long. The read size follows the source throughput. */
         if (unused > sys->read_size)
             unused = sys->read_size;
 
@@ -328,7 +503,25 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
 
     memcpy(buf, sys->buffer + offset, copy);
     sys->stream_offset += copy;
+    sys->stats.consumed += copy;
     vlc_cond_signal(&sys->wait_space);
+
+    if (sys->stats.publish)
+    {   /* Publish the statistics from the reading thread, without the lock */
+        float fill = (float)sys->buffer_length / sys->buffer_size;
+        int64_t latency = sys->stats.latency;
+        int64_t consume_rate = sys->stats.consume_rate;
+        int64_t source_rate = sys->stats.source_rate;
+
+        sys->stats.publish = false;
+        vlc_mutex_unlock(&sys->lock);
+
+        var_SetFloat(stream, "prefetch-fill", fill);
+        var_SetInteger(stream, "prefetch-latency", latency);
+        var_SetInteger(stream, "prefetch-consume-rate", consume_rate);
+        var_SetInteger(stream, "prefetch-source-rate", source_rate);
+        return copy;
+    }
     vlc_mutex_unlock(&sys->lock);
     return copy;
 }
@@ -449,20 +642,45 @@ static int Open(vlc_object_t *obj)
     sys->buffer_offset = 0;
     sys->stream_offset = 0;
     sys->buffer_length = 0;
-    sys->buffer_size = var_InheritInteger(obj, "prefetch-buffer-size") << 10u;
+    sys->buffer_max = var_InheritInteger(obj, "prefetch-buffer-size") << 10u;
     sys->read_size = var_InheritInteger(obj, "prefetch-read-size");
-    sys->seek_threshold = var_InheritInteger(obj, "prefetch-seek-threshold");
+    sys->seek_min = var_InheritInteger(obj, "prefetch-seek-threshold");
+    sys->seek_threshold = sys->seek_min;
+    sys->source_size = SIZE_MAX;
 
     uint64_t size = stream_Size(stream->p_source);
     if (size > 0)
     {   /* No point allocating a buffer larger than the source stream */
-        if (sys->buffer_size > size)
-            sys->buffer_size = size;
+        if (sys->buffer_max > size)
+            sys->buffer_max = size;
         if (sys->read_size > size)
             sys->read_size = size;
+        sys->source_size = size;
     }
-    if (sys->buffer_size < sys->read_size)
-        sys->buffer_size = sys->read_size;
+    if (sys->buffer_max < sys->read_size)
+        sys->buffer_max = sys->read_size;
+
+    /* Start small, the buffer grows with the measured consumption rate */
+    sys->buffer_size = 4 * sys->read_size;
+    if (sys->buffer_size < BUFFER_MIN)
+        sys->buffer_size = BUFFER_MIN;
+    if (sys->buffer_size > sys->buffer_max)
+        sys->buffer_size = sys->buffer_max;
+
+    sys->stats.since = mdate();
+    sys->stats.consumed = 0;
+    sys->stats.consume_rate = 0;
+    sys->stats.source_rate = 0;
+    sys->stats.latency = 0;
+    sys->stats.after_seek = true;
+    sys->stats.seeks = 0;
+    sys->stats.resizes = 0;
+    sys->stats.publish = false;
+
+    var_Create(stream, "prefetch-fill", VLC_VAR_FLOAT);
+    var_Create(stream, "prefetch-latency", VLC_VAR_INTEGER);
+    var_Create(stream, "prefetch-consume-rate", VLC_VAR_INTEGER);
+    var_Create(stream, "prefetch-source-rate", VLC_VAR_INTEGER);
 
     sys->buffer = malloc(sys->buffer_size);
     if (sys->buffer == NULL)
@@ -487,8 +705,8 @@ static int Open(vlc_object_t *obj)
         goto error;
     }
 
-    msg_Dbg(stream, "using %zu bytes buffer, %zu bytes read",
-            sys->buffer_size, sys->read_size);
+    msg_Dbg(stream, "using %zu bytes buffer (up to %zu), %zu bytes read",
+            sys->buffer_size, sys->buffer_max, sys->read_size);
     stream->pf_read = Read;
     stream->pf_readdir = ReadDir;
     stream->pf_control = Control;
@@ -514,6 +732,12 @@ static void Close (vlc_object_t *obj)
     vlc_interrupt_kill(sys->interrupt);
     vlc_join(sys->thread, NULL);
     vlc_interrupt_destroy(sys->interrupt);
+
+    msg_Dbg(stream, "consumption %"PRIu64" B/s, source %"PRIu64" B/s, "
+            "latency %"PRId64" us, %zu bytes buffer, %zu bytes read, "
+            "%u seek(s), %u resize(s)", sys->stats.consume_rate,
+            sys->stats.source_rate, sys->stats.latency, sys->buffer_size,
+            sys->read_size, sys->stats.seeks, sys->stats.resizes);
     vlc_cond_destroy(&sys->wait_space);
     vlc_cond_destroy(&sys->wait_data);
     vlc_mutex_destroy(&sys->lock);
@@ -532,12 +756,16 @@ vlc_module_begin()
     set_callbacks(Open, Close)
 
     add_integer("prefetch-buffer-size", 1 << 14, N_("Buffer size"),
-                N_("Prefetch buffer size (KiB)"), false)
+                N_("Maximum prefetch buffer size (KiB). The buffer grows "
+                   "up to this size depending on the consumption rate."),
+                false)
         change_integer_range(4, 1 << 20)
     add_integer("prefetch-read-size", 1 << 14, N_("Read size"),
-                N_("Prefetch background read size (bytes)"), true)
+                N_("Initial prefetch background read size (bytes). The read "
+                   "size then follows the source throughput."), true)
         change_integer_range(1, 1 << 29)
     add_integer("prefetch-seek-threshold", 1 << 14, N_("Seek threshold"),
-                N_("Prefetch forward seek threshold (bytes)"), true)
+                N_("Minimum prefetch forward seek threshold (bytes). Shorter "
+                   "skips are read through rather than seeked."), true)
         change_integer_range(0, UINT64_C(1) << 60)
 vlc_module_end()
@@ -0,0 +1,676 @@
+/*****************************************************************************
+ * rangecache.c: block cache for seekable network streams
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_stream.h>
+#include <vlc_configuration.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+/*
+ * The stream is split in fixed-size blocks. The blocks read from the source
+ * are kept in memory, the least recently used ones being dropped first, and
+ * optionally in a file of the user cache directory named after the URL.
+ * Reading again a byte range after a seek is then served from the cache,
+ * without touching the network.
+ *
+ * The disk file starts with a header and the bitmap of the blocks it holds,
+ * followed by the blocks at their stream offsets (sparse file). A block bit
+ * is only set once the block data is written. The header records the hash of
+ * the source validator (entity tag or modification time), so that the blocks
+ * of an older version of the resource are never served; sources without a
+ * validator are not cached on disk.
+ */
+#define RC_BLOCK_SIZE  (128 << 10)
+#define RC_MAGIC       "VLCRC002"
+#define RC_HEADER_SIZE 40
+#define RC_ALIGN       4096
+
+typedef struct rc_block rc_block_t;
+
+struct rc_block
+{
+    rc_block_t *prev; /* more recently used */
+    rc_block_t *next; /* less recently used */
+    uint32_t    index;
+    size_t      length;
+    uint8_t     data[];
+};
+
+struct stream_sys_t
+{
+    uint64_t     pos;        /* Current reading offset */
+    uint64_t     size;       /* Source stream size */
+    uint64_t     source_pos; /* Source stream reading offset */
+    uint32_t     count;      /* Number of blocks of the stream */
+
+    /* Memory tier */
+    rc_block_t **blocks;     /* Cached blocks, by index */
+    rc_block_t  *first;      /* Most recently used block */
+    rc_block_t  *last;       /* Least recently used block */
+    unsigned     cached;
+    unsigned     max_cached;
+
+    /* Disk tier */
+    struct
+    {
+        int      fd;
+        uint8_t *map;        /* Blocks available in the file */
+        size_t   map_size;
+        uint64_t data_offset;
+        uint64_t budget;     /* Bytes that can still be written */
+    } disk;
+
+    struct
+    {
+        uint64_t memory_hits;
+        uint64_t disk_hits;
+        uint64_t fetches;
+    } stat;
+};
+
+static size_t BlockLength(const stream_sys_t *sys, uint32_t index)
+{
+    uint64_t offset = (uint64_t)index * RC_BLOCK_SIZE;
+
+    return __MIN(sys->size - offset, RC_BLOCK_SIZE);
+}
+
+/****************************************************************************
+ * Memory tier
+ ****************************************************************************/
+static void BlockUnlink(stream_sys_t *sys, rc_block_t *block)
+{
+    if (block->prev != NULL)
+        block->prev->next = block->next;
+    else
+        sys->first = block->next;
+    if (block->next != NULL)
+        block->next->prev = block->prev;
+    else
+        sys->last = block->prev;
+}
+
+static void BlockPushFront(stream_sys_t *sys, rc_block_t *block)
+{
+    block->prev = NULL;
+    block->next = sys->first;
+    if (sys->first != NULL)
+        sys->first->prev = block;
+    else
+        sys->last = block;
+    sys->first = block;
+}
+
+static void BlockInsert(stream_sys_t *sys, rc_block_t *block)
+{
+    if (sys->cached >= sys->max_cached)
+    {   /* Drop the least recently used block */
+        rc_block_t *old = sys->last;
+
+        BlockUnlink(sys, old);
+        sys->blocks[old->index] = NULL;
+        sys->cached--;
+        free(old);
+    }
+
+    assert(sys->blocks[block->index] == NULL);
+    sys->blocks[block->index] = block;
+    sys->cached++;
+    BlockPushFront(sys, block);
+}
+
+static void BlockFlush(stream_sys_t *sys)
+{
+    for (rc_block_t *block = sys->first, *next; block != NULL; block = next)
+    {
+        next = block->next;
+        sys->blocks[block->index] = NULL;
+        free(block);
+    }
+    sys->first = sys->last = NULL;
+    sys->cached = 0;
+}
+
+/****************************************************************************
+ * Disk tier
+ ****************************************************************************/
+static bool DiskHasBlock(const stream_sys_t *sys, uint32_t index)
+{
+    return sys->disk.fd != -1
+        && (sys->disk.map[index >> 3] & (1 << (index & 7)));
+}
+
+static bool DiskRead(stream_t *s, rc_block_t *block)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    if (!DiskHasBlock(sys, block->index))
+        return false;
+
+    off_t offset = sys->disk.data_offset
+                 + (uint64_t)block->index * RC_BLOCK_SIZE;
+    ssize_t val = pread(sys->disk.fd, block->data, block->length, offset);
+    if (val != (ssize_t)block->length)
+    {
+        msg_Warn(s, "cannot read cached block %"PRIu32, block->index);
+        sys->disk.map[block->index >> 3] &= ~(1 << (block->index & 7));
+        return false;
+    }
+    return true;
+}
+
+static void DiskWrite(stream_t *s, const rc_block_t *block)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    if (sys->disk.fd == -1 || sys->disk.budget < block->length)
+        return;
+
+    off_t offset = sys->disk.data_offset
+                 + (uint64_t)block->index * RC_BLOCK_SIZE;
+    if (pwrite(sys->disk.fd, block->data, block->length, offset)
+            != (ssize_t)block->length)
+    {
+        msg_Warn(s, "cannot write cache file: %s", vlc_strerror_c(errno));
+        sys->disk.budget = 0;
+        return;
+    }
+
+    /* Mark the block only once its data is written */
+    uint8_t *byte = sys->disk.map + (block->index >> 3);
+
+    *byte |= 1 << (block->index & 7);
+    if (pwrite(sys->disk.fd, byte, 1, RC_HEADER_SIZE + (block->index >> 3)) != 1)
+        sys->disk.budget = 0;
+    else
+        sys->disk.budget -= block->length;
+}
+
+typedef struct
+{
+    char    *path;
+    time_t   mtime;
+    uint64_t size;
+} rc_file_t;
+
+static int filecmp(const void *a, const void *b)
+{
+    const rc_file_t *fa = a, *fb = b;
+
+    return (fa->mtime > fb->mtime) - (fa->mtime < fb->mtime);
+}
+
+/**
+ * Removes the least recently written cache files until the cache directory
+ * fits in the quota, and returns the space left.
+ */
+static uint64_t DiskTrim(stream_t *s, const char *dir, const char *keep,
+                         uint64_t quota)
+{
+    DIR *dh = vlc_opendir(dir);
+    if (dh == NULL)
+        return quota;
+
+    rc_file_t *files = NULL;
+    size_t count = 0;
+    uint64_t total = 0;
+    const char *name;
+
+    while ((name = vlc_readdir(dh)) != NULL)
+    {
+        char *path;
+        struct stat st;
+
+        if (name[0] == '.'
+         || asprintf(&path, "%s"DIR_SEP"%s", dir, name) == -1)
+            continue;
+        if (vlc_stat(path, &st) || !S_ISREG(st.st_mode))
+        {
+            free(path);
+            continue;
+        }
+
+        rc_file_t *tab = realloc(files, (count + 1) * sizeof (*tab));
+        if (unlikely(tab == NULL))
+        {
+            free(path);
+            break;
+        }
+        files = tab;
+        files[count].path = path;
+        files[count].mtime = st.st_mtime;
+#ifndef _WIN32
+        /* The cache files are sparse */
+        files[count].size = (uint64_t)st.st_blocks * 512;
+#else
+        files[count].size = st.st_size;
+#endif
+        total += files[count].size;
+        count++;
+    }
+    closedir(dh);
+
+    qsort(files, count, sizeof (*files), filecmp);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (total > quota && strcmp(files[i].path, keep)
+         && vlc_unlink(files[i].path) == 0)
+        {
+            msg_Dbg(s, "removed cache file %s", files[i].path);
+            total -= files[i].size;
+        }
+        free(files[i].path);
+    }
+    free(files);
+
+    return (total < quota) ? quota - total : 0;
+}
+
+static char *DiskPath(stream_t *s, char **dirp)
+{
+    char *cachedir = config_GetUserDir(VLC_CACHE_DIR);
+    if (cachedir == NULL)
+        return NULL;
+
+    char *dir, *path = NULL;
+    if (asprintf(&dir, "%s"DIR_SEP"streams", cachedir) == -1)
+        dir = NULL;
+    free(cachedir);
+    if (dir == NULL)
+        return NULL;
+
+    /* Create the parent directories as well */
+    for (char *p = strchr(dir + 1, DIR_SEP_CHAR); p != NULL;
+         p = strchr(p + 1, DIR_SEP_CHAR))
+    {
+        *p = '\0';
+        vlc_mkdir(dir, 0700);
+        *p = DIR_SEP_CHAR;
+    }
+    vlc_mkdir(dir, 0700);
+
+    struct md5_s md5;
+    InitMD5(&md5);
+    AddMD5(&md5, s->psz_url, strlen(s->psz_url));
+    EndMD5(&md5);
+
+    char *hash = psz_md5_hash(&md5);
+    if (hash == NULL
+     || asprintf(&path, "%s"DIR_SEP"%s", dir, hash) == -1)
+        path = NULL;
+    free(hash);
+
+    *dirp = dir;
+    return path;
+}
+
+static void DiskOpen(stream_t *s)
+{
+    stream_sys_t *sys = s->p_sys;
+    char *validator;
+
+    if (vlc_stream_Control(s->p_source, STREAM_GET_VALIDATOR, &validator))
+    {
+        msg_Dbg(s, "no validator, not caching on disk");
+        return;
+    }
+
+    struct md5_s md5;
+    InitMD5(&md5);
+    AddMD5(&md5, validator, strlen(validator));
+    EndMD5(&md5);
+    free(validator);
+
+    char *dir, *path = DiskPath(s, &dir);
+
+    if (path == NULL)
+        return;
+
+    uint64_t quota = var_InheritInteger(s, "rangecache-disk-size") << 20;
+    sys->disk.budget = DiskTrim(s, dir, path, quota);
+    free(dir);
+
+    sys->disk.map_size = (sys->count + 7) / 8;
+    sys->disk.map = calloc(1, sys->disk.map_size);
+    sys->disk.data_offset = (RC_HEADER_SIZE + sys->disk.map_size + RC_ALIGN - 1)
+                          & ~(uint64_t)(RC_ALIGN - 1);
+    if (unlikely(sys->disk.map == NULL))
+        goto error;
+
+    sys->disk.fd = vlc_open(path, O_RDWR | O_CREAT, 0600);
+    if (sys->disk.fd == -1)
+    {
+        msg_Warn(s, "cannot open cache file %s: %s", path,
+                 vlc_strerror_c(errno));
+        goto error;
+    }
+
+    uint8_t hdr[RC_HEADER_SIZE], cached[RC_HEADER_SIZE];
+
+    memcpy(hdr, RC_MAGIC, 8);
+    SetQWBE(hdr + 8, sys->size);
+    SetDWBE(hdr + 16, RC_BLOCK_SIZE);
+    SetDWBE(hdr + 20, sys->count);
+    memcpy(hdr + 24, md5.buf, 16);
+
+    /* Reuse the blocks of a previous session if the resource did not change */
+    if (pread(sys->disk.fd, cached, sizeof (cached), 0) == sizeof (cached)
+     && !memcmp(cached, hdr, sizeof (hdr))
+     && pread(sys->disk.fd, sys->disk.map, sys->disk.map_size,
+              RC_HEADER_SIZE) == (ssize_t)sys->disk.map_size)
+    {
+        unsigned blocks = 0;
+
+        for (uint32_t i = 0; i < sys->count; i++)
+            if (sys->disk.map[i >> 3] & (1 << (i & 7)))
+                blocks++;
+        msg_Dbg(s, "reusing %u cached blocks from %s", blocks, path);
+    }
+    else
+    {
+        memset(sys->disk.map, 0, sys->disk.map_size);
+        if (ftruncate(sys->disk.fd, 0)
+         || pwrite(sys->disk.fd, sys->disk.map, sys->disk.map_size,
+                   RC_HEADER_SIZE) != (ssize_t)sys->disk.map_size)
+            goto error;
+    }
+
+    /* (Re)write the header last, this also dates the file for DiskTrim() */
+    if (pwrite(sys->disk.fd, hdr, sizeof (hdr), 0) != sizeof (hdr))
+        goto error;
+
+    free(path);
+    return;
+
+error:
+    if (sys->disk.fd != -1)
+    {
+        vlc_close(sys->disk.fd);
+        sys->disk.fd = -1;
+    }
+    free(sys->disk.map);
+    sys->disk.map = NULL;
+    free(path);
+}
+
+static void DiskClose(stream_sys_t *sys)
+{
+    if (sys->disk.fd != -1)
+    {
+        vlc_close(sys->disk.fd);
+        sys->disk.fd = -1;
+    }
+    free(sys->disk.map);
+    sys->disk.map = NULL;
+}
+
+/****************************************************************************
+ * Stream callbacks
+ ****************************************************************************/
+static ssize_t Fetch(stream_t *s, rc_block_t *block)
+{
+    stream_sys_t *sys = s->p_sys;
+    uint64_t offset = (uint64_t)block->index * RC_BLOCK_SIZE;
+
+    if (sys->source_pos != offset)
+    {
+        if (vlc_stream_Seek(s->p_source, offset))
+            return -1;
+        sys->source_pos = offset;
+    }
+
+    ssize_t val = vlc_stream_Read(s->p_source, block->data, block->length);
+    if (val > 0)
+        sys->source_pos += val;
+    return val;
+}
+
+/**
+ * Gets a block from the memory tier, the disk tier or the source stream.
+ * \param cached set to false if the block was incompletely read from the
+ *               source, then it must be freed by the caller
+ */
+static rc_block_t *BlockGet(stream_t *s, uint32_t index, bool *cached)
+{
+    stream_sys_t *sys = s->p_sys;
+    rc_block_t *block = sys->blocks[index];
+
+    *cached = true;
+    if (block != NULL)
+    {
+        BlockUnlink(sys, block);
+        BlockPushFront(sys, block);
+        sys->stat.memory_hits++;
+        return block;
+    }
+
+    size_t length = BlockLength(sys, index);
+
+    block = malloc(sizeof (*block) + length);
+    if (unlikely(block == NULL))
+        return NULL;
+    block->index = index;
+    block->length = length;
+
+    if (DiskRead(s, block))
+        sys->stat.disk_hits++;
+    else
+    {
+        ssize_t val = Fetch(s, block);
+        if (val <= 0)
+        {
+            free(block);
+            return NULL;
+        }
+
+        sys->stat.fetches++;
+        if ((size_t)val < length)
+        {   /* Interrupted, or the stream is shorter than announced */
+            block->length = val;
+            *cached = false;
+            return block;
+        }
+        DiskWrite(s, block);
+    }
+
+    BlockInsert(sys, block);
+    return block;
+}
+
+static ssize_t Read(stream_t *s, void *buf, size_t len)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    if (sys->pos >= sys->size)
+        return 0;
+
+    if (buf == NULL)
+    {
+        len = __MIN(len, sys->size - sys->pos);
+        sys->pos += len;
+        return len;
+    }
+
+    uint32_t index = sys->pos / RC_BLOCK_SIZE;
+    size_t offset = sys->pos % RC_BLOCK_SIZE;
+    bool cached;
+    rc_block_t *block = BlockGet(s, index, &cached);
+
+    if (block == NULL)
+        return 0;
+
+    size_t copy = 0;
+    if (offset < block->length)
+    {
+        copy = __MIN(len, block->length - offset);
+        memcpy(buf, block->data + offset, copy);
+        sys->pos += copy;
+    }
+
+    if (!cached)
+        free(block);
+    return copy;
+}
+
+static int Seek(stream_t *s, uint64_t offset)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    /* The source is only seeked when a missing block is fetched */
+    sys->pos = offset;
+    return VLC_SUCCESS;
+}
+
+static int Control(stream_t *s, int query, va_list args)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_FASTSEEK:
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+        case STREAM_GET_PTS_DELAY:
+        case STREAM_GET_META:
+        case STREAM_GET_CONTENT_TYPE:
+        case STREAM_GET_SIGNAL:
+        case STREAM_GET_VALIDATOR:
+        case STREAM_GET_READ_STATS:
+        case STREAM_SET_PAUSE_STATE:
+            return vlc_stream_vaControl(s->p_source, query, args);
+
+        case STREAM_GET_SIZE:
+            *va_arg(args, uint64_t *) = sys->size;
+            return VLC_SUCCESS;
+
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static int Open(vlc_object_t *obj)
+{
+    stream_t *s = (stream_t *)obj;
+    bool b;
+    uint64_t size;
+
+    /* The cache is disabled by default */
+    unsigned ram = var_InheritInteger(s, "rangecache-memory");
+    bool disk = var_InheritBool(s, "rangecache-disk");
+    if (ram == 0 && !disk)
+        return VLC_EGENERIC;
+
+    /* Local files are better cached by the operating system */
+    if (s->psz_url == NULL
+     || vlc_stream_Control(s->p_source, STREAM_CAN_SEEK, &b) || !b
+     || vlc_stream_Control(s->p_source, STREAM_CAN_FASTSEEK, &b) || b
+     || vlc_stream_GetSize(s->p_source, &size) || size == 0
+     || size / RC_BLOCK_SIZE >= UINT32_MAX)
+        return VLC_EGENERIC;
+
+    stream_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->pos = 0;
+    sys->size = size;
+    sys->source_pos = vlc_stream_Tell(s->p_source);
+    sys->count = (size + RC_BLOCK_SIZE - 1) / RC_BLOCK_SIZE;
+    sys->blocks = calloc(sys->count, sizeof (*sys->blocks));
+    if (unlikely(sys->blocks == NULL))
+    {
+        free(sys);
+        return VLC_ENOMEM;
+    }
+    sys->first = sys->last = NULL;
+    sys->cached = 0;
+    /* Keep at least a couple of blocks for reads across a block boundary */
+    sys->max_cached = __MAX(((uint64_t)ram << 20) / RC_BLOCK_SIZE, 2);
+    sys->disk.fd = -1;
+    sys->disk.map = NULL;
+    sys->disk.budget = 0;
+    sys->stat.memory_hits = 0;
+    sys->stat.disk_hits = 0;
+    sys->stat.fetches = 0;
+
+    s->p_sys = sys;
+    if (disk)
+        DiskOpen(s);
+
+    msg_Dbg(s, "caching %"PRIu32" blocks of %u KiB, up to %u in memory%s",
+            sys->count, RC_BLOCK_SIZE >> 10, sys->max_cached,
+            (sys->disk.fd != -1) ? " and on disk" : "");
+
+    s->pf_read = Read;
+    s->pf_seek = Seek;
+    s->pf_control = Control;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    stream_t *s = (stream_t *)obj;
+    stream_sys_t *sys = s->p_sys;
+
+    msg_Dbg(s, "%"PRIu64" blocks from memory, %"PRIu64" from disk, "
+            "%"PRIu64" fetched", sys->stat.memory_hits, sys->stat.disk_hits,
+            sys->stat.fetches);
+
+    DiskClose(sys);
+    BlockFlush(sys);
+    free(sys->blocks);
+    free(sys);
+}
+
+vlc_module_begin()
+    set_category(CAT_INPUT)
+    set_subcategory(SUBCAT_INPUT_STREAM_FILTER)
+    set_capability("stream_filter", 0)
+
+    set_description(N_("Range cache for network streams"))
+    set_callbacks(Open, Close)
+
+    add_integer("rangecache-memory", 0, N_("Memory cache size"),
+                N_("Memory used to keep the data read from seekable network "
+                   "streams, so that seeking back does not download it "
+                   "again (MiB)."), true)
+        change_integer_range(0, 1 << 12)
+    add_bool("rangecache-disk", false, N_("Disk cache"),
+             N_("Also keep the data read from seekable network streams in "
+                "the user cache directory, across sessions."), true)
+    add_integer("rangecache-disk-size", 1 << 10, N_("Disk cache size"),
+                N_("Maximum size of the disk cache (MiB)."), true)
+        change_integer_range(1, 1 << 20)
+vlc_module_end()
@@ -31,6 +31,7 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
 /*****************************************************************************
@@ -39,9 +40,15 @@
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
 
+#define SIMD_TEXT N_("Optimized blending")
+#define SIMD_LONGTEXT N_("Use the line based and SIMD routines for the " \
+                         "most common chromas.")
+
 vlc_module_begin()
     set_description(N_("Video pictures blending"))
     set_capability("video blending", 100)
+    add_bool("blend-simd", true, SIMD_TEXT, SIMD_LONGTEXT, true)
+        change_volatile()
     set_callbacks(Open, Close)
 vlc_module_end()
 
@@ -82,6 +89,25 @@ public:
     {
         return true;
     }
+    /* Raw access for the line based blending functions */
+    uint8_t *getPixels(unsigned plane, unsigned rx = 1, unsigned ry = 1,
+                       unsigned bytes = 1) const
+    {
+        return &picture->p[plane].p_pixels[(y / ry) * picture->p[plane].i_pitch +
+                                           (x / rx) * bytes];
+    }
+    int getPitch(unsigned plane) const
+    {
+        return picture->p[plane].i_pitch;
+    }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
 
 protected:
     template <unsigned ry>
@@ -547,9 +573,273 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
     }
 }
 
+/* Line merging routines, used instead of Blend() for the most common
+ * chromas. a[] is the source alpha, n the number of destination samples. */
+struct CMergeC {
+    static void line(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                     unsigned n, unsigned alpha)
+    {
+        for (unsigned i = 0; i < n; i++) {
+            unsigned f = div255(alpha * a[i]);
+            if (f > 0)
+                ::merge(&dst[i], src[i], f);
+        }
+    }
+    /* Horizontally subsampled destination: src and a are read every
+     * other sample */
+    static void lineSub(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                        unsigned n, unsigned alpha)
+    {
+        for (unsigned i = 0; i < n; i++) {
+            unsigned f = div255(alpha * a[2 * i]);
+            if (f > 0)
+                ::merge(&dst[i], src[2 * i], f);
+        }
+    }
+    /* Interleaved and subsampled chroma destination */
+    static void lineSemi(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                         const uint8_t *a, unsigned n, unsigned alpha)
+    {
+        for (unsigned i = 0; i < n; i++) {
+            unsigned f = div255(alpha * a[2 * i]);
+            if (f > 0) {
+                ::merge(&dst[2 * i + 0], u[2 * i], f);
+                ::merge(&dst[2 * i + 1], v[2 * i], f);
+            }
+        }
+    }
+    /* RGBA source onto 32 bits RGB (or BGR if swap_rb) pixels */
+    static void lineRGB32(uint8_t *dst, const uint8_t *src, unsigned n,
+                          unsigned alpha, bool swap_rb)
+    {
+        for (unsigned i = 0; i < n; i++) {
+            unsigned f = div255(alpha * src[4 * i + 3]);
+            if (f > 0) {
+                ::merge(&dst[4 * i + (swap_rb ? 2 : 0)], src[4 * i + 0], f);
+                ::merge(&dst[4 * i + 1],                 src[4 * i + 1], f);
+                ::merge(&dst[4 * i + (swap_rb ? 0 : 2)], src[4 * i + 2], f);
+            }
+        }
+    }
+};
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+// ================= SSE2 =================
+#define HAVE_BLEND_SSE2
+#define VEC         __m128i
+#define WIDTH       8
+#define LOAD8(p)    _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p)), \
+                                      _mm_setzero_si128())
+#define STORE8(p, v) _mm_storel_epi64((__m128i *)(p), _mm_packus_epi16(v, v))
+#define LOAD16(p)   _mm_loadu_si128((const __m128i *)(p))
+#define STORE16(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#define LOADEVEN(p) _mm_and_si128(LOAD16(p), _mm_set1_epi16(0xff))
+#define VSET1       _mm_set1_epi16
+#define VADD        _mm_add_epi16
+#define VSUB        _mm_sub_epi16
+#define VMUL        _mm_mullo_epi16
+#define VSRLI       _mm_srli_epi16
+#define VSLLI       _mm_slli_epi16
+#define VAND        _mm_and_si128
+#define VOR         _mm_or_si128
+#define VSHUF4(v, i) _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, i), i)
+#define VISZERO(v)  (_mm_movemask_epi8(_mm_cmpeq_epi16(v, _mm_setzero_si128())) == 0xffff)
+#define VLC_TARGET
+#define RENAME(a)   a ## SSE2
+#include "blend_simd.h"
+#undef VEC
+#undef WIDTH
+#undef LOAD8
+#undef STORE8
+#undef LOAD16
+#undef STORE16
+#undef LOADEVEN
+#undef VSET1
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VSRLI
+#undef VSLLI
+#undef VAND
+#undef VOR
+#undef VSHUF4
+#undef VISZERO
+#undef VLC_TARGET
+#undef RENAME
+#endif
+
+#ifdef CAN_COMPILE_AVX2
+#if defined(__AVX2__) || VLC_GCC_VERSION(4, 9) || defined(__clang__)
+#include <immintrin.h>
+// ================= AVX2 =================
+#define HAVE_BLEND_AVX2
+#define VEC         __m256i
+#define WIDTH       16
+#define LOAD8(p)    _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define STORE8(p, v) \
+    _mm_storeu_si128((__m128i *)(p), _mm256_castsi256_si128( \
+        _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0xD8)))
+#define LOAD16(p)   _mm256_loadu_si256((const __m256i *)(p))
+#define STORE16(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+#define LOADEVEN(p) _mm256_and_si256(LOAD16(p), _mm256_set1_epi16(0xff))
+#define VSET1       _mm256_set1_epi16
+#define VADD        _mm256_add_epi16
+#define VSUB        _mm256_sub_epi16
+#define VMUL        _mm256_mullo_epi16
+#define VSRLI       _mm256_srli_epi16
+#define VSLLI       _mm256_slli_epi16
+#define VAND        _mm256_and_si256
+#define VOR         _mm256_or_si256
+#define VSHUF4(v, i) _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, i), i)
+#define VISZERO(v)  _mm256_testz_si256(v, v)
+#define VLC_TARGET  VLC_AVX2
+#define RENAME(a)   a ## AVX2
+#include "blend_simd.h"
+#undef VEC
+#undef WIDTH
+#undef LOAD8
+#undef STORE8
+#undef LOAD16
+#undef STORE16
+#undef LOADEVEN
+#undef VSET1
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VSRLI
+#undef VSLLI
+#undef VAND
+#undef VOR
+#undef VSHUF4
+#undef VISZERO
+#undef VLC_TARGET
+#undef RENAME
+#endif
+#endif
+
+/* YUVA onto 4:2:0 planar pictures */
+template <class TMerge, bool swap_uv>
+void BlendYUVAToI420(const CPicture &dst_data, const CPicture &src_data,
+                     unsigned width, unsigned height, int alpha)
+{
+    /* Only the pixels on even columns are merged into the chroma planes */
+    const unsigned parity = dst_data.getX() % 2;
+    const unsigned chroma_width = (width - parity + 1) / 2;
+
+    uint8_t *dst_y = dst_data.getPixels(0);
+    uint8_t *dst_u = dst_data.getPixels(swap_uv ? 2 : 1, 2, 2) + parity;
+    uint8_t *dst_v = dst_data.getPixels(swap_uv ? 1 : 2, 2, 2) + parity;
+    const uint8_t *src_y = src_data.getPixels(0);
+    const uint8_t *src_u = src_data.getPixels(1);
+    const uint8_t *src_v = src_data.getPixels(2);
+    const uint8_t *src_a = src_data.getPixels(3);
+
+    for (unsigned y = dst_data.getY(); y < dst_data.getY() + height; y++) {
+        TMerge::line(dst_y, src_y, src_a, width, alpha);
+        if ((y % 2) == 0) {
+            TMerge::lineSub(dst_u, &src_u[parity], &src_a[parity],
+                            chroma_width, alpha);
+            TMerge::lineSub(dst_v, &src_v[parity], &src_a[parity],
+                            chroma_width, alpha);
+        } else {
+            dst_u += dst_data.getPitch(swap_uv ? 2 : 1);
+            dst_v += dst_data.getPitch(swap_uv ? 1 : 2);
+        }
+        dst_y += dst_data.getPitch(0);
+        src_y += src_data.getPitch(0);
+        src_u += src_data.getPitch(1);
+        src_v += src_data.getPitch(2);
+        src_a += src_data.getPitch(3);
+    }
+}
+
+/* YUVA onto 4:2:0 semi-planar pictures */
+template <class TMerge, bool swap_uv>
+void BlendYUVAToNV12(const CPicture &dst_data, const CPicture &src_data,
+                     unsigned width, unsigned height, int alpha)
+{
+    const unsigned parity = dst_data.getX() % 2;
+    const unsigned chroma_width = (width - parity + 1) / 2;
+
+    uint8_t *dst_y  = dst_data.getPixels(0);
+    uint8_t *dst_uv = dst_data.getPixels(1, 2, 2, 2) + 2 * parity;
+    const uint8_t *src_y = src_data.getPixels(0);
+    const uint8_t *src_u = src_data.getPixels(swap_uv ? 2 : 1);
+    const uint8_t *src_v = src_data.getPixels(swap_uv ? 1 : 2);
+    const uint8_t *src_a = src_data.getPixels(3);
+
+    for (unsigned y = dst_data.getY(); y < dst_data.getY() + height; y++) {
+        TMerge::line(dst_y, src_y, src_a, width, alpha);
+        if ((y % 2) == 0)
+            TMerge::lineSemi(dst_uv, &src_u[parity], &src_v[parity],
+                             &src_a[parity], chroma_width, alpha);
+        else
+            dst_uv += dst_data.getPitch(1);
+        dst_y += dst_data.getPitch(0);
+        src_y += src_data.getPitch(0);
+        src_u += src_data.getPitch(swap_uv ? 2 : 1);
+        src_v += src_data.getPitch(swap_uv ? 1 : 2);
+        src_a += src_data.getPitch(3);
+    }
+}
+
+/* RGBA onto 32 bits RGB pictures */
+template <class TMerge>
+void BlendRGBAToRGB32(const CPicture &dst_data, const CPicture &src_data,
+                      unsigned width, unsigned height, int alpha)
+{
+    const video_format_t *fmt = dst_data.getFormat();
+#ifdef WORDS_BIGENDIAN
+    const unsigned offset_r = (32 - fmt->i_lrshift) / 8;
+    const unsigned offset_g = (32 - fmt->i_lgshift) / 8;
+    const unsigned offset_b = (32 - fmt->i_lbshift) / 8;
+#else
+    const unsigned offset_r = fmt->i_lrshift / 8;
+    const unsigned offset_g = fmt->i_lgshift / 8;
+    const unsigned offset_b = fmt->i_lbshift / 8;
+#endif
+    if (offset_g != 1 || offset_r + offset_b != 2 ||
+        (offset_r != 0 && offset_r != 2)) {
+        Blend<CPictureRGB32, CPictureRGBA, compose<convertNone, convertNone> >
+            (dst_data, src_data, width, height, alpha);
+        return;
+    }
+
+    uint8_t *dst = dst_data.getPixels(0, 1, 1, 4);
+    const uint8_t *src = src_data.getPixels(0, 1, 1, 4);
+
+    for (unsigned y = 0; y < height; y++) {
+        TMerge::lineRGB32(dst, src, width, alpha, offset_r == 2);
+        dst += dst_data.getPitch(0);
+        src += src_data.getPitch(0);
+    }
+}
+
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
+template <class TMerge>
+static blend_function_t GetLineBlend(vlc_fourcc_t dst, vlc_fourcc_t src)
+{
+    if (src == VLC_CODEC_YUVA) {
+        switch (dst) {
+            case VLC_CODEC_I420:
+            case VLC_CODEC_J420:
+                return BlendYUVAToI420<TMerge, false>;
+            case VLC_CODEC_YV12:
+                return BlendYUVAToI420<TMerge, true>;
+            case VLC_CODEC_NV12:
+                return BlendYUVAToNV12<TMerge, false>;
+            case VLC_CODEC_NV21:
+                return BlendYUVAToNV12<TMerge, true>;
+        }
+    } else if (src == VLC_CODEC_RGBA && dst == VLC_CODEC_RGB32) {
+        return BlendRGBAToRGB32<TMerge>;
+    }
+    return NULL;
+}
+
 static const struct {
     vlc_fourcc_t     dst;
     vlc_fourcc_t     src;
@@ -670,9 +960,24 @@ static int Open(vlc_object_t *object)
     const vlc_fourcc_t dst = filter->fmt_out.video.i_chroma;
 
     filter_sys_t *sys = new filter_sys_t();
-    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends); i++) {
-        if (blends[i].src == src && blends[i].dst == dst)
-            sys->blend = blends[i].blend;
+    if (var_InheritBool(filter, "blend-simd")) {
+#ifdef HAVE_BLEND_AVX2
+        if (vlc_CPU_AVX2())
+            sys->blend = GetLineBlend<CMergeAVX2>(dst, src);
+        else
+#endif
+#ifdef HAVE_BLEND_SSE2
+        if (vlc_CPU_SSE2())
+            sys->blend = GetLineBlend<CMergeSSE2>(dst, src);
+        else
+#endif
+            sys->blend = GetLineBlend<CMergeC>(dst, src);
+    }
+    if (!sys->blend) {
+        for (size_t i = 0; i < sizeof(blends) / sizeof(*blends); i++) {
+            if (blends[i].src == src && blends[i].dst == dst)
+                sys->blend = blends[i].blend;
+        }
     }
 
     if (!sys->blend) {
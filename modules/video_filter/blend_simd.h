@@ -0,0 +1,127 @@
+/*****************************************************************************
+ * blend_simd.h: SIMD line merging routines for the blend filter
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This template is included by blend.cpp once per instruction set, with:
+ *  - VEC: the vector type, holding WIDTH 16-bit elements,
+ *  - LOAD8()/STORE8(): WIDTH bytes to and from 16-bit elements,
+ *  - LOADEVEN(): the even bytes of 2 * WIDTH bytes,
+ *  - LOAD16()/STORE16(): 2 * WIDTH bytes as they are,
+ *  - VSET1(), VADD(), VSUB(), VMUL(), VSRLI(), VSLLI(), VAND(), VOR():
+ *    16-bit element operations,
+ *  - VSHUF4(): shuffle of each group of 4 elements,
+ *  - VISZERO(): true if all the elements are null,
+ *  - VLC_TARGET: the function attribute enabling the instruction set,
+ *  - RENAME(): the class name suffix.
+ *
+ * All the products fit in 16 bits, so the results are the same as with
+ * CMergeC, which handles the elements that do not fill a vector. */
+
+/* div255() of blend.cpp */
+#define BLEND_DIV255(v) VSRLI( VADD( VADD( VSRLI( v, 8 ), v ), VSET1( 1 ) ), 8 )
+/* merge() of blend.cpp */
+#define BLEND_MERGE(d, s, f) \
+    BLEND_DIV255( VADD( VMUL( VSUB( VSET1( 255 ), f ), d ), VMUL( s, f ) ) )
+
+struct RENAME(CMerge) {
+    VLC_TARGET
+    static void line(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                     unsigned n, unsigned alpha)
+    {
+        const VEC global = VSET1(alpha);
+        unsigned i;
+
+        for (i = 0; i + WIDTH <= n; i += WIDTH) {
+            const VEC f = BLEND_DIV255(VMUL(LOAD8(&a[i]), global));
+            if (VISZERO(f))
+                continue;
+            STORE8(&dst[i], BLEND_MERGE(LOAD8(&dst[i]), LOAD8(&src[i]), f));
+        }
+        CMergeC::line(&dst[i], &src[i], &a[i], n - i, alpha);
+    }
+
+    VLC_TARGET
+    static void lineSub(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                        unsigned n, unsigned alpha)
+    {
+        const VEC global = VSET1(alpha);
+        unsigned i;
+
+        /* The last sample is left to the C code, so as not to read past
+         * the end of the source line */
+        for (i = 0; i + WIDTH < n; i += WIDTH) {
+            const VEC f = BLEND_DIV255(VMUL(LOADEVEN(&a[2 * i]), global));
+            if (VISZERO(f))
+                continue;
+            STORE8(&dst[i], BLEND_MERGE(LOAD8(&dst[i]),
+                                        LOADEVEN(&src[2 * i]), f));
+        }
+        CMergeC::lineSub(&dst[i], &src[2 * i], &a[2 * i], n - i, alpha);
+    }
+
+    VLC_TARGET
+    static void lineSemi(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                         const uint8_t *a, unsigned n, unsigned alpha)
+    {
+        const VEC global = VSET1(alpha);
+        const VEC mask = VSET1(0xff);
+        unsigned i;
+
+        for (i = 0; i + WIDTH < n; i += WIDTH) {
+            const VEC f = BLEND_DIV255(VMUL(LOADEVEN(&a[2 * i]), global));
+            if (VISZERO(f))
+                continue;
+            const VEC uv = LOAD16(&dst[2 * i]);
+            const VEC du = BLEND_MERGE(VAND(uv, mask), LOADEVEN(&u[2 * i]), f);
+            const VEC dv = BLEND_MERGE(VSRLI(uv, 8), LOADEVEN(&v[2 * i]), f);
+            STORE16(&dst[2 * i], VOR(du, VSLLI(dv, 8)));
+        }
+        CMergeC::lineSemi(&dst[2 * i], &u[2 * i], &v[2 * i], &a[2 * i],
+                          n - i, alpha);
+    }
+
+    VLC_TARGET
+    static void lineRGB32(uint8_t *dst, const uint8_t *src, unsigned n,
+                          unsigned alpha, bool swap_rb)
+    {
+        /* Elements 0, 1, 2 of each pixel get its alpha, while element 3
+         * gets 0, so that merge() leaves the fourth byte unchanged */
+        static const uint16_t keep_mask[16] = {
+            0xffff, 0xffff, 0xffff, 0, 0xffff, 0xffff, 0xffff, 0,
+            0xffff, 0xffff, 0xffff, 0, 0xffff, 0xffff, 0xffff, 0,
+        };
+        const VEC global = VSET1(alpha);
+        const VEC keep = LOAD16((const uint8_t *)keep_mask);
+        unsigned i;
+
+        for (i = 0; i + WIDTH / 4 <= n; i += WIDTH / 4) {
+            VEC s = LOAD8(&src[4 * i]);
+            const VEC f = VAND(BLEND_DIV255(VMUL(VSHUF4(s, 0xff), global)), keep);
+            if (VISZERO(f))
+                continue;
+            if (swap_rb)
+                s = VSHUF4(s, 0xc6);
+            STORE8(&dst[4 * i], BLEND_MERGE(LOAD8(&dst[4 * i]), s, f));
+        }
+        CMergeC::lineRGB32(&dst[4 * i], &src[4 * i], n - i, alpha, swap_rb);
+    }
+};
+
+#undef BLEND_MERGE
+#undef BLEND_DIV255
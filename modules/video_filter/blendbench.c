@@ -52,6 +52,10 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define LOOPS_TEXT N_("Number of time to blend")
 #define LOOPS_LONGTEXT N_("The number of time the blend will be performed")
 
+#define CHECK_TEXT N_("Check the blending result")
+#define CHECK_LONGTEXT N_("Compare the blended image with the one given " \
+                          "by the reference (not optimized) blending code")
+
 #define ALPHA_TEXT N_("Alpha of the blended image")
 #define ALPHA_LONGTEXT N_("Alpha with which the blend image is blended")
 
@@ -82,6 +86,7 @@ vlc_module_begin ()
               LOOPS_LONGTEXT, false )
     add_integer_with_range( CFG_PREFIX "alpha", 128, 0, 255, ALPHA_TEXT,
               ALPHA_LONGTEXT, false )
+    add_bool( CFG_PREFIX "check", true, CHECK_TEXT, CHECK_LONGTEXT, false )
 
     set_section( N_("Base image"), NULL )
     add_loadfile( CFG_PREFIX "base-image", NULL, BASE_IMAGE_TEXT,
@@ -99,7 +104,7 @@ vlc_module_begin ()
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "loops", "alpha", "base-image", "base-chroma", "blend-image",
+    "loops", "alpha", "check", "base-image", "base-chroma", "blend-image",
     "blend-chroma", NULL
 };
 
@@ -109,6 +114,7 @@ static const char *const ppsz_filter_options[] = {
 struct filter_sys_t
 {
     bool b_done;
+    bool b_check;
     int i_loops, i_alpha;
 
     picture_t *p_base_image;
@@ -145,6 +151,87 @@ static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
     return VLC_SUCCESS;
 }
 
+static filter_t *blendbench_CreateBlend( filter_t *p_filter, bool b_reference )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    filter_t *p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_blend )
+        return NULL;
+
+    /* The reference blender does not use the optimized routines */
+    if( b_reference )
+        var_Create( p_blend, "blend-simd", VLC_VAR_BOOL );
+
+    p_blend->fmt_out.video = p_sys->p_base_image->format;
+    p_blend->fmt_in.video = p_sys->p_blend_image->format;
+    p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
+    if( !p_blend->p_module )
+    {
+        vlc_object_release( p_blend );
+        return NULL;
+    }
+    return p_blend;
+}
+
+static void blendbench_DeleteBlend( filter_t *p_blend )
+{
+    module_unneed( p_blend, p_blend->p_module );
+    vlc_object_release( p_blend );
+}
+
+/*****************************************************************************
+ * blendbench_Check: compares the blending with the reference blending
+ *****************************************************************************/
+static void blendbench_Check( filter_t *p_filter, filter_t *p_blend )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const picture_t *p_base = p_sys->p_base_image;
+    filter_t *p_ref_blend = blendbench_CreateBlend( p_filter, true );
+    picture_t *p_ref = picture_NewFromFormat( &p_base->format );
+    picture_t *p_out = picture_NewFromFormat( &p_base->format );
+    bool b_same = true;
+
+    if( !p_ref_blend || !p_ref || !p_out )
+    {
+        msg_Err( p_filter, "Unable to check the blending result" );
+        goto end;
+    }
+
+    /* Odd offsets exercise the chroma subsampling paths */
+    for( int i_offset = 0; i_offset < 2 && b_same; i_offset++ )
+    {
+        picture_Copy( p_ref, p_base );
+        picture_Copy( p_out, p_base );
+        p_ref_blend->pf_video_blend( p_ref_blend, p_ref, p_sys->p_blend_image,
+                                     i_offset, i_offset, p_sys->i_alpha );
+        p_blend->pf_video_blend( p_blend, p_out, p_sys->p_blend_image,
+                                 i_offset, i_offset, p_sys->i_alpha );
+
+        for( int i = 0; i < p_out->i_planes && b_same; i++ )
+            for( int y = 0; y < p_out->p[i].i_visible_lines; y++ )
+                if( memcmp( &p_ref->p[i].p_pixels[y * p_ref->p[i].i_pitch],
+                            &p_out->p[i].p_pixels[y * p_out->p[i].i_pitch],
+                            p_out->p[i].i_visible_pitch ) )
+                {
+                    msg_Err( p_filter, "Blending result differs from the "
+                             "reference at offset %d, plane %d, line %d",
+                             i_offset, i, y );
+                    b_same = false;
+                    break;
+                }
+    }
+    if( b_same )
+        msg_Info( p_filter, "Blending result matches the reference" );
+
+end:
+    if( p_out )
+        picture_Release( p_out );
+    if( p_ref )
+        picture_Release( p_ref );
+    if( p_ref_blend )
+        blendbench_DeleteBlend( p_ref_blend );
+}
+
 /*****************************************************************************
  * Create: allocates video thread output method
  *****************************************************************************/
@@ -174,6 +261,7 @@ static int Create( vlc_object_t *p_this )
                                                   CFG_PREFIX "loops" );
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
+    p_sys->b_check = var_CreateGetBoolCommand( p_filter, CFG_PREFIX "check" );
 
     psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
     p_sys->i_base_chroma = VLC_FOURCC( psz_temp[0], psz_temp[1],
@@ -225,21 +313,15 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     if( p_sys->b_done )
         return p_pic;
 
-    p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
+    p_blend = blendbench_CreateBlend( p_filter, false );
     if( !p_blend )
     {
         picture_Release( p_pic );
         return NULL;
     }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
-    p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
-    if( !p_blend->p_module )
-    {
-        picture_Release( p_pic );
-        vlc_object_release( p_blend );
-        return NULL;
-    }
+
+    if( p_sys->b_check )
+        blendbench_Check( p_filter, p_blend );
 
     mtime_t time = mdate();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
@@ -258,9 +340,7 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
                   p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
                   p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
 
-    module_unneed( p_blend, p_blend->p_module );
-
-    vlc_object_release( p_blend );
+    blendbench_DeleteBlend( p_blend );
 
     p_sys->b_done = true;
     return p_pic;
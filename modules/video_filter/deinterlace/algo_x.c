@@ -29,6 +29,10 @@
 #   include "mmx.h"
 #endif
 
+#ifdef CAN_COMPILE_AVX2
+#   include <immintrin.h>
+#endif
+
 #include <stdint.h>
 
 #include <vlc_common.h>
@@ -354,6 +358,187 @@ static inline void XDeint8x8FieldMMXEXT( uint8_t *dst, int i_dst,
 }
 #endif
 
+#ifdef CAN_COMPILE_AVX2
+/* AVX2 versions of the MMXEXT functions above. They give the same output,
+ * but process whole 8 pixels lines at once. */
+VLC_AVX2
+static inline __m256i XDeintLoad2x8AVX2( const uint8_t *a, const uint8_t *b )
+{
+    return _mm256_cvtepu8_epi16(
+        _mm_unpacklo_epi64( _mm_loadl_epi64( (const __m128i *)a ),
+                            _mm_loadl_epi64( (const __m128i *)b ) ) );
+}
+
+VLC_AVX2
+static inline int XDeint8x8DetectAVX2( uint8_t *src, int i_src )
+{
+    int y;
+    int32_t ff, fr;
+    int fc;
+
+    /* Detect interlacing */
+    fc = 0;
+    for( y = 0; y < 9; y += 2 )
+    {
+        /* fr: (l0 - l1)^2 + (l2 - l1)^2, ff: (l0 - l2)^2 + (l3 - l1)^2 */
+        const __m256i d_fr = _mm256_sub_epi16(
+            XDeintLoad2x8AVX2( &src[0*i_src], &src[2*i_src] ),
+            XDeintLoad2x8AVX2( &src[1*i_src], &src[1*i_src] ) );
+        const __m256i d_ff = _mm256_sub_epi16(
+            XDeintLoad2x8AVX2( &src[0*i_src], &src[3*i_src] ),
+            XDeintLoad2x8AVX2( &src[2*i_src], &src[1*i_src] ) );
+        __m256i sum = _mm256_hadd_epi32( _mm256_madd_epi16( d_fr, d_fr ),
+                                         _mm256_madd_epi16( d_ff, d_ff ) );
+        sum = _mm256_hadd_epi32( sum, sum );
+
+        const __m128i total = _mm_add_epi32( _mm256_castsi256_si128( sum ),
+                                             _mm256_extracti128_si256( sum, 1 ) );
+        fr = _mm_cvtsi128_si32( total );
+        ff = _mm_extract_epi32( total, 1 );
+
+        if( ff < 6*fr/8 && fr > 32 )
+            fc++;
+
+        src += 2*i_src;
+    }
+    return fc;
+}
+
+VLC_AVX2
+static inline void XDeint8x8MergeAVX2( uint8_t *dst,  int i_dst,
+                                       uint8_t *src1, int i_src1,
+                                       uint8_t *src2, int i_src2 )
+{
+    const __m128i m_4 = _mm_set1_epi16( 4 );
+    const __m128i m_6 = _mm_set1_epi16( 6 );
+    int y;
+
+    /* Progressive */
+    for( y = 0; y < 8; y += 2 )
+    {
+        const __m128i l1 = _mm_loadl_epi64( (const __m128i *)src1 );
+        const __m128i a = _mm_cvtepu8_epi16( l1 );
+        const __m128i b = _mm_cvtepu8_epi16(
+            _mm_loadl_epi64( (const __m128i *)src2 ) );
+        const __m128i c = _mm_cvtepu8_epi16(
+            _mm_loadl_epi64( (const __m128i *)&src1[i_src1] ) );
+        __m128i v;
+
+        _mm_storel_epi64( (__m128i *)dst, l1 );
+
+        v = _mm_add_epi16( _mm_add_epi16( a, c ),
+                           _mm_add_epi16( _mm_mullo_epi16( b, m_6 ), m_4 ) );
+        v = _mm_srai_epi16( v, 3 );
+        _mm_storel_epi64( (__m128i *)&dst[i_dst], _mm_packus_epi16( v, v ) );
+
+        dst += 2*i_dst;
+        src1 += i_src1;
+        src2 += i_src2;
+    }
+}
+
+VLC_AVX2
+static inline void XDeint8x8FieldEAVX2( uint8_t *dst, int i_dst,
+                                        uint8_t *src, int i_src )
+{
+    int y;
+
+    /* Interlaced */
+    for( y = 0; y < 8; y += 2 )
+    {
+        const __m128i l0 = _mm_loadl_epi64( (const __m128i *)src );
+        const __m128i l2 = _mm_loadl_epi64( (const __m128i *)&src[2*i_src] );
+
+        _mm_storel_epi64( (__m128i *)dst, l0 );
+        dst += i_dst;
+
+        /* pavgb rounds up, as in the MMXEXT version */
+        _mm_storel_epi64( (__m128i *)dst, _mm_avg_epu8( l0, l2 ) );
+
+        dst += 1*i_dst;
+        src += 2*i_src;
+    }
+}
+
+/* Absolute differences between src[i + s] and src2[i + t], for 0 <= i < 16 */
+VLC_AVX2
+static inline __m256i XDeintAbsDiffAVX2( const uint8_t *src,
+                                         const uint8_t *src2, int s, int t )
+{
+    const __m128i a = _mm_loadu_si128( (const __m128i *)&src[s] );
+    const __m128i b = _mm_loadu_si128( (const __m128i *)&src2[t] );
+
+    return _mm256_cvtepu8_epi16( _mm_or_si128( _mm_subs_epu8( a, b ),
+                                               _mm_subs_epu8( b, a ) ) );
+}
+
+/* Sums of 8 consecutive elements: for each 128-bits lane, element i of the
+ * result is the sum of elements i to i+7 of lo:hi */
+VLC_AVX2
+static inline __m256i XDeintSum8AVX2( __m256i lo, __m256i hi )
+{
+    lo = _mm256_add_epi16( lo, _mm256_alignr_epi8( hi, lo, 2 ) );
+    hi = _mm256_add_epi16( hi, _mm256_srli_si256( hi, 2 ) );
+    lo = _mm256_add_epi16( lo, _mm256_alignr_epi8( hi, lo, 4 ) );
+    hi = _mm256_add_epi16( hi, _mm256_srli_si256( hi, 4 ) );
+    return _mm256_add_epi16( lo, _mm256_alignr_epi8( hi, lo, 8 ) );
+}
+
+VLC_AVX2
+static inline __m128i XDeintAvg8AVX2( const uint8_t *a, const uint8_t *b )
+{
+    return _mm_srli_epi16( _mm_add_epi16(
+        _mm_cvtepu8_epi16( _mm_loadl_epi64( (const __m128i *)a ) ),
+        _mm_cvtepu8_epi16( _mm_loadl_epi64( (const __m128i *)b ) ) ), 1 );
+}
+
+/* Unlike XDeint8x8FieldMMXEXT, this computes the three orientation scores of
+ * the 8 pixels of a line at once. It reads up to 5 pixels after the block. */
+VLC_AVX2
+static inline void XDeint8x8FieldAVX2( uint8_t *dst, int i_dst,
+                                       uint8_t *src, int i_src )
+{
+    int y;
+
+    /* Interlaced */
+    for( y = 0; y < 8; y += 2 )
+    {
+        uint8_t *src2 = &src[2*i_src];
+
+        _mm_storel_epi64( (__m128i *)dst,
+                          _mm_loadl_epi64( (const __m128i *)src ) );
+        dst += i_dst;
+
+        /* c0 in the low lane, c2 in the high lane, c1 in both */
+        const __m256i d0 = XDeintAbsDiffAVX2( src, src2, -4, -2 );
+        const __m256i d1 = XDeintAbsDiffAVX2( src, src2, -3, -3 );
+        const __m256i d2 = XDeintAbsDiffAVX2( src, src2, -2, -4 );
+        const __m256i c02 = XDeintSum8AVX2(
+            _mm256_permute2x128_si256( d0, d2, 0x20 ),
+            _mm256_permute2x128_si256( d0, d2, 0x31 ) );
+        const __m256i c11 = XDeintSum8AVX2(
+            _mm256_permute2x128_si256( d1, d1, 0x00 ),
+            _mm256_permute2x128_si256( d1, d1, 0x11 ) );
+        const __m128i c0 = _mm256_castsi256_si128( c02 );
+        const __m128i c1 = _mm256_castsi256_si128( c11 );
+        const __m128i c2 = _mm256_extracti128_si256( c02, 1 );
+
+        /* c0 < c1 && c1 <= c2, and c2 < c1 && c1 <= c0 */
+        const __m128i m0 = _mm_andnot_si128( _mm_cmpgt_epi16( c1, c2 ),
+                                             _mm_cmpgt_epi16( c1, c0 ) );
+        const __m128i m2 = _mm_andnot_si128( _mm_cmpgt_epi16( c1, c0 ),
+                                             _mm_cmpgt_epi16( c1, c2 ) );
+        __m128i v = XDeintAvg8AVX2( &src[0], &src2[0] );
+        v = _mm_blendv_epi8( v, XDeintAvg8AVX2( &src[-1], &src2[1] ), m0 );
+        v = _mm_blendv_epi8( v, XDeintAvg8AVX2( &src[1], &src2[-1] ), m2 );
+        _mm_storel_epi64( (__m128i *)dst, _mm_packus_epi16( v, v ) );
+
+        dst += 1*i_dst;
+        src += 2*i_src;
+    }
+}
+#endif
+
 /* NxN arbitray size (and then only use pixel in the NxN block)
  */
 static inline int XDeintNxNDetect( uint8_t *src, int i_src,
@@ -533,6 +718,40 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
 }
 #endif
 
+#ifdef CAN_COMPILE_AVX2
+VLC_AVX2
+static inline void XDeintBand8x8AVX2( uint8_t *dst, int i_dst,
+                                      uint8_t *src, int i_src,
+                                      const int i_mbx, int i_modx )
+{
+    int x;
+
+    for( x = 0; x < i_mbx; x++ )
+    {
+        int s;
+        if( ( s = XDeint8x8DetectAVX2( src, i_src ) ) )
+        {
+            if( x == 0 || x == i_mbx - 1 )
+                XDeint8x8FieldEAVX2( dst, i_dst, src, i_src );
+            else
+                XDeint8x8FieldAVX2( dst, i_dst, src, i_src );
+        }
+        else
+        {
+            XDeint8x8MergeAVX2( dst, i_dst,
+                                &src[0*i_src], 2*i_src,
+                                &src[1*i_src], 2*i_src );
+        }
+
+        dst += 8;
+        src += 8;
+    }
+
+    if( i_modx )
+        XDeintNxN( dst, i_dst, src, i_src, i_modx, 8 );
+}
+#endif
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -540,6 +759,9 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
 void RenderX( picture_t *p_outpic, picture_t *p_pic )
 {
     int i_plane;
+#if defined (CAN_COMPILE_AVX2)
+    const bool avx2 = vlc_CPU_AVX2();
+#endif
 #if defined (CAN_COMPILE_MMXEXT)
     const bool mmxext = vlc_CPU_MMXEXT();
 #endif
@@ -563,6 +785,11 @@ void RenderX( picture_t *p_outpic, picture_t *p_pic )
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
 
+#ifdef CAN_COMPILE_AVX2
+            if( avx2 )
+                XDeintBand8x8AVX2( dst, i_dst, src, i_src, i_mbx, i_modx );
+            else
+#endif
 #ifdef CAN_COMPILE_MMXEXT
             if( mmxext )
                 XDeintBand8x8MMXEXT( dst, i_dst, src, i_src, i_mbx, i_modx );
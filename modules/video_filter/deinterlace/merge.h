@@ -158,6 +158,21 @@ void Merge8BitSSE2( void *, const void *, const void *, size_t );
 void Merge16BitSSE2( void *, const void *, const void *, size_t );
 #endif
 
+#if defined(CAN_COMPILE_AVX2)
+/**
+ * AVX2 routine to blend pixels from two picture lines.
+ *
+ * The output is the same as with Merge8BitSSE2().
+ */
+void Merge8BitAVX2( void *, const void *, const void *, size_t );
+/**
+ * AVX2 routine to blend pixels from two picture lines.
+ *
+ * The output is the same as with Merge16BitSSE2().
+ */
+void Merge16BitAVX2( void *, const void *, const void *, size_t );
+#endif
+
 #if defined(CAN_COMPILE_ARM)
 /**
  * ARM NEON routine to blend pixels from two picture lines.
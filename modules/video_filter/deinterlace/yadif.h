@@ -147,3 +147,74 @@ static void yadif_filter_line_c_16bit(uint16_t *dst, uint16_t *prev, uint16_t *c
     prefs /= 2;
     FILTER
 }
+
+#ifdef CAN_COMPILE_AVX2
+#if defined(__AVX2__) || VLC_GCC_VERSION(4, 9) || defined(__clang__)
+#include <immintrin.h>
+// ================ AVX2 =================
+#define HAVE_YADIF_AVX2
+#define VSRAI   _mm256_srai_epi16
+#define VABS    _mm256_abs_epi16
+#define VADD    _mm256_add_epi16
+#define VSUB    _mm256_sub_epi16
+#define VMIN    _mm256_min_epi16
+#define VMAX    _mm256_max_epi16
+#define VGT     _mm256_cmpgt_epi16
+#define VSET1   _mm256_set1_epi16
+#define PIXEL  uint8_t
+#define STEP   16
+#define LOAD(p) _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)(p) ) )
+#define STORE(p, v) \
+    _mm_storeu_si128( (__m128i *)(p), _mm256_castsi256_si128( \
+        _mm256_permute4x64_epi64( _mm256_packus_epi16( v, v ), 0xD8 ) ) )
+#define FILTER_C yadif_filter_line_c
+#define RENAME(a) a ## _avx2
+#include "yadif_avx2.h"
+#undef VSRAI
+#undef VABS
+#undef VADD
+#undef VSUB
+#undef VMIN
+#undef VMAX
+#undef VGT
+#undef VSET1
+#undef PIXEL
+#undef STEP
+#undef LOAD
+#undef STORE
+#undef FILTER_C
+#undef RENAME
+
+#define VSRAI   _mm256_srai_epi32
+#define VABS    _mm256_abs_epi32
+#define VADD    _mm256_add_epi32
+#define VSUB    _mm256_sub_epi32
+#define VMIN    _mm256_min_epi32
+#define VMAX    _mm256_max_epi32
+#define VGT     _mm256_cmpgt_epi32
+#define VSET1   _mm256_set1_epi32
+#define PIXEL  uint16_t
+#define STEP   8
+#define LOAD(p) _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i *)(p) ) )
+#define STORE(p, v) \
+    _mm_storeu_si128( (__m128i *)(p), _mm256_castsi256_si128( \
+        _mm256_permute4x64_epi64( _mm256_packus_epi32( v, v ), 0xD8 ) ) )
+#define FILTER_C yadif_filter_line_c_16bit
+#define RENAME(a) a ## _avx2_16bit
+#include "yadif_avx2.h"
+#undef VSRAI
+#undef VABS
+#undef VADD
+#undef VSUB
+#undef VMIN
+#undef VMAX
+#undef VGT
+#undef VSET1
+#undef PIXEL
+#undef STEP
+#undef LOAD
+#undef STORE
+#undef FILTER_C
+#undef RENAME
+#endif
+#endif
@@ -0,0 +1,131 @@
+/*****************************************************************************
+ * yadif_avx2.h : AVX2 version of the Yadif line filter
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This template is included by yadif.h once per pixel size, with:
+ *  - PIXEL: the pixel type,
+ *  - STEP: the number of pixels per vector,
+ *  - LOAD()/STORE(): conversions between pixels and vector elements,
+ *  - VADD(), VSUB(), VSRAI(), VABS(), VMIN(), VMAX(), VGT(), VSET1():
+ *    element operations,
+ *  - RENAME(): the function name suffix,
+ *  - FILTER_C: the C function for the pixels that do not fill a vector.
+ *
+ * Elements are wide enough to never overflow, so that the output is the
+ * same as with the C code, including the rounding. */
+
+#define YADIF_LOAD_AT(p, o) LOAD( &(p)[x + (o)] )
+#define YADIF_AVG(a, b)     VSRAI( VADD(a, b), 1 )
+
+/* CHECK(j) of the C code */
+#define YADIF_SCORE(j) \
+    VADD( VADD( VABS( VSUB( YADIF_LOAD_AT(cur, mrefs - 1 + (j)), \
+                        YADIF_LOAD_AT(cur, prefs - 1 - (j)) ) ), \
+              VABS( VSUB( YADIF_LOAD_AT(cur, mrefs + (j)), \
+                        YADIF_LOAD_AT(cur, prefs - (j)) ) ) ), \
+         VABS( VSUB( YADIF_LOAD_AT(cur, mrefs + 1 + (j)), \
+                   YADIF_LOAD_AT(cur, prefs + 1 - (j)) ) ) )
+#define YADIF_PRED(j) \
+    YADIF_AVG( YADIF_LOAD_AT(cur, mrefs + (j)), YADIF_LOAD_AT(cur, prefs - (j)) )
+#define YADIF_CHECK(j, accept) \
+    do { \
+        __m256i score = YADIF_SCORE(j); \
+        mask = _mm256_and_si256( accept, VGT( spatial_score, score ) ); \
+        spatial_score = _mm256_blendv_epi8( spatial_score, score, mask ); \
+        spatial_pred = _mm256_blendv_epi8( spatial_pred, YADIF_PRED(j), mask ); \
+    } while(0)
+
+VLC_AVX2
+static void RENAME(yadif_filter_line)( PIXEL *dst, PIXEL *prev, PIXEL *cur,
+                                       PIXEL *next, int w, int prefs,
+                                       int mrefs, int parity, int mode )
+{
+    PIXEL *prev2 = parity ? prev : cur ;
+    PIXEL *next2 = parity ? cur  : next;
+    const int i_prefs = prefs;
+    const int i_mrefs = mrefs;
+    const __m256i all = _mm256_set1_epi8( -1 );
+    const __m256i zero = _mm256_setzero_si256();
+    int x;
+
+    prefs /= (int)sizeof(PIXEL);
+    mrefs /= (int)sizeof(PIXEL);
+
+    for( x = 0; x + STEP <= w; x += STEP )
+    {
+        const __m256i c = YADIF_LOAD_AT(cur, mrefs);
+        const __m256i d = YADIF_AVG( YADIF_LOAD_AT(prev2, 0),
+                                     YADIF_LOAD_AT(next2, 0) );
+        const __m256i e = YADIF_LOAD_AT(cur, prefs);
+        const __m256i temporal_diff0 = VABS( VSUB( YADIF_LOAD_AT(prev2, 0),
+                                                 YADIF_LOAD_AT(next2, 0) ) );
+        const __m256i temporal_diff1 =
+            VSRAI( VADD( VABS( VSUB( YADIF_LOAD_AT(prev, mrefs), c ) ),
+                       VABS( VSUB( YADIF_LOAD_AT(prev, prefs), e ) ) ), 1 );
+        const __m256i temporal_diff2 =
+            VSRAI( VADD( VABS( VSUB( YADIF_LOAD_AT(next, mrefs), c ) ),
+                       VABS( VSUB( YADIF_LOAD_AT(next, prefs), e ) ) ), 1 );
+        __m256i diff = VMAX( VMAX( VSRAI(temporal_diff0, 1), temporal_diff1 ),
+                            temporal_diff2 );
+        __m256i spatial_pred = YADIF_AVG( c, e );
+        __m256i spatial_score =
+            VSUB( VADD( VADD( VABS( VSUB( YADIF_LOAD_AT(cur, mrefs - 1),
+                                     YADIF_LOAD_AT(cur, prefs - 1) ) ),
+                           VABS( VSUB( c, e ) ) ),
+                      VABS( VSUB( YADIF_LOAD_AT(cur, mrefs + 1),
+                                YADIF_LOAD_AT(cur, prefs + 1) ) ) ),
+                 VSET1( 1 ) );
+        __m256i mask;
+
+        /* The second check of each side only applies if the first one
+         * improved the score */
+        YADIF_CHECK( -1, all );
+        YADIF_CHECK( -2, mask );
+        YADIF_CHECK(  1, all );
+        YADIF_CHECK(  2, mask );
+
+        if( mode < 2 )
+        {
+            const __m256i b = YADIF_AVG( YADIF_LOAD_AT(prev2, 2 * mrefs),
+                                         YADIF_LOAD_AT(next2, 2 * mrefs) );
+            const __m256i f = YADIF_AVG( YADIF_LOAD_AT(prev2, 2 * prefs),
+                                         YADIF_LOAD_AT(next2, 2 * prefs) );
+            const __m256i max = VMAX( VMAX( VSUB(d, e), VSUB(d, c) ),
+                                     VMIN( VSUB(b, c), VSUB(f, e) ) );
+            const __m256i min = VMIN( VMIN( VSUB(d, e), VSUB(d, c) ),
+                                     VMAX( VSUB(b, c), VSUB(f, e) ) );
+
+            diff = VMAX( VMAX( diff, min ), VSUB( zero, max ) );
+        }
+
+        /* diff is never negative */
+        spatial_pred = VMIN( VMAX( spatial_pred, VSUB( d, diff ) ), VADD( d, diff ) );
+        STORE( &dst[x], spatial_pred );
+    }
+
+    if( x < w )
+        FILTER_C( &dst[x], &prev[x], &cur[x], &next[x], w - x,
+                  i_prefs, i_mrefs, parity, mode );
+}
+
+#undef YADIF_CHECK
+#undef YADIF_PRED
+#undef YADIF_SCORE
+#undef YADIF_AVG
+#undef YADIF_LOAD_AT
@@ -160,47 +160,43 @@ static void Destroy( vlc_object_t *p_this )
     free( p_sys );
 }
 
+typedef struct
+{
+    const plane_t *p_src;
+    plane_t *p_out;
+    int sigma;
+} sharpen_slice_t;
+
 /*****************************************************************************
- * Render: displays previously rendered output
- *****************************************************************************
- * This function send the currently rendered image to Invert image, waits
- * until it is displayed and switch the two rendering buffers, preparing next
- * frame.
+ * SharpenSlice: sharpens the lines of a slice of the Y plane
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static void SharpenSlice( void *p_data, unsigned i_slice, unsigned i_count )
 {
-    picture_t *p_outpic;
-    uint8_t *restrict p_src = NULL;
-    uint8_t *restrict p_out = NULL;
-    int i_src_pitch;
-    int i_out_pitch;
-    int pix;
+    const sharpen_slice_t *p_job = p_data;
+    const uint8_t *restrict p_src = p_job->p_src->p_pixels;
+    uint8_t *restrict p_out = p_job->p_out->p_pixels;
+    const int i_src_pitch = p_job->p_src->i_pitch;
+    const int i_out_pitch = p_job->p_out->i_pitch;
+    const unsigned i_visible_lines = p_job->p_src->i_visible_lines;
+    const unsigned i_visible_pitch = p_job->p_src->i_visible_pitch;
+    const int sigma = p_job->sigma;
     const int v1 = -1;
     const int v2 = 3; /* 2^3 = 8 */
-    const unsigned i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines;
-    const unsigned i_visible_pitch = p_pic->p[Y_PLANE].i_visible_pitch;
-    const int sigma = var_GetFloat( p_filter, FILTER_PREFIX "sigma" ) * (1 << 20);
-
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-
-    /* process the Y plane */
-    p_src = p_pic->p[Y_PLANE].p_pixels;
-    p_out = p_outpic->p[Y_PLANE].p_pixels;
-    i_src_pitch = p_pic->p[Y_PLANE].i_pitch;
-    i_out_pitch = p_outpic->p[Y_PLANE].i_pitch;
-
-    /* perform convolution only on Y plane. Avoid border line. */
-    vlc_mutex_lock( &p_filter->p_sys->lock );
+    unsigned i_begin, i_end;
+    int pix;
 
-    memcpy(p_out, p_src, i_visible_pitch);
+    filter_GetSlice( i_visible_lines, i_slice, i_count, 1, &i_begin, &i_end );
 
-    for( unsigned i = 1; i < i_visible_lines - 1; i++ )
+    for( unsigned i = i_begin; i < i_end; i++ )
     {
+        /* Avoid border lines */
+        if( i == 0 || i == i_visible_lines - 1 )
+        {
+            memcpy( &p_out[i * i_out_pitch], &p_src[i * i_src_pitch],
+                    i_visible_pitch );
+            continue;
+        }
+
         p_out[i * i_out_pitch] = p_src[i * i_src_pitch];
 
         for( unsigned j = 1; j < i_visible_pitch - 1; j++ )
@@ -223,9 +219,35 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         p_out[i * i_out_pitch + i_visible_pitch - 1] =
             p_src[i * i_src_pitch + i_visible_pitch - 1];
     }
-    memcpy(&p_out[(i_visible_lines - 1) * i_out_pitch],
-           &p_src[(i_visible_lines - 1) * i_src_pitch], i_visible_pitch);
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************
+ * This function send the currently rendered image to Invert image, waits
+ * until it is displayed and switch the two rendering buffers, preparing next
+ * frame.
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    picture_t *p_outpic;
+    sharpen_slice_t job;
+
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
 
+    /* perform convolution only on Y plane. */
+    job.p_src = &p_pic->p[Y_PLANE];
+    job.p_out = &p_outpic->p[Y_PLANE];
+    job.sigma = var_GetFloat( p_filter, FILTER_PREFIX "sigma" ) * (1 << 20);
+
+    vlc_mutex_lock( &p_filter->p_sys->lock );
+    filter_ProcessSlices( p_filter, job.p_src->i_visible_lines,
+                          SharpenSlice, &job );
     vlc_mutex_unlock( &p_filter->p_sys->lock );
 
     plane_CopyPixels( &p_outpic->p[U_PLANE], &p_pic->p[U_PLANE] );
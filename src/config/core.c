@@ -580,17 +580,22 @@ module_config_t *config_FindConfig (vlc_object_t *p_this, const char *name)
  * Destroys an array of configuration items.
  * \param config start of array of items
  * \param confsize number of items in the array
+ * \param owned whether the items own their names, descriptions, default
+ *              values and list strings (false for the plugins cache)
  */
-void config_Free (module_config_t *tab, size_t confsize)
+void config_Free (module_config_t *tab, size_t confsize, bool owned)
 {
     for (size_t j = 0; j < confsize; j++)
     {
         module_config_t *p_item = &tab[j];
 
-        free( p_item->psz_type );
-        free( p_item->psz_name );
-        free( p_item->psz_text );
-        free( p_item->psz_longtext );
+        if (owned)
+        {
+            free( p_item->psz_type );
+            free( p_item->psz_name );
+            free( p_item->psz_text );
+            free( p_item->psz_longtext );
+        }
 
         if (IsConfigIntegerType (p_item->i_type))
         {
@@ -601,16 +606,19 @@ void config_Free (module_config_t *tab, size_t confsize)
         if (IsConfigStringType (p_item->i_type))
         {
             free (p_item->value.psz);
-            free (p_item->orig.psz);
+            if (owned)
+                free (p_item->orig.psz);
             if (p_item->list_count)
             {
-                for (size_t i = 0; i < p_item->list_count; i++)
-                    free (p_item->list.psz[i]);
+                if (owned)
+                    for (size_t i = 0; i < p_item->list_count; i++)
+                        free (p_item->list.psz[i]);
                 free (p_item->list.psz);
             }
         }
 
-        for (size_t i = 0; i < p_item->list_count; i++)
+        if (owned)
+            for (size_t i = 0; i < p_item->list_count; i++)
                 free (p_item->list_text[i]);
         free (p_item->list_text);
     }
@@ -315,7 +315,16 @@ stream_t *stream_AccessNew(vlc_object_t *parent, input_thread_t *input,
     s->p_sys      = access;
 
     if (cachename != NULL)
+    {
+        /* Keep the data of seekable network streams, read again on seeks */
+        if (!preparsing)
+        {
+            stream_t *cache = vlc_stream_FilterNew(s, "rangecache");
+            if (cache != NULL)
+                s = cache;
+        }
         s = stream_FilterChainNew(s, cachename);
+    }
     return s;
 }
 
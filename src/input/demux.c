@@ -141,6 +141,44 @@ static const char* DemuxNameFromExtension( char const* ext,
     return result ? result->name : NULL;
 }
 
+static const char *DemuxNameFromMagic( stream_t *s )
+{
+    /* NOTE: Add only signatures that the demuxer checks by itself, the
+     * result is only tried first, the other demuxers are still probed */
+    static const struct
+    {
+        uint8_t offset;
+        uint8_t size;
+        char const magic[6];
+        char const name[8];
+    } signatures[] =
+    {
+        { 0, 4, "\x1A\x45\xDF\xA3", "mkv" },
+        { 0, 4, "OggS",           "ogg" },
+        { 0, 4, "fLaC",           "flac" },
+        { 0, 4, "\x30\x26\xB2\x75", "asf" },
+        { 4, 4, "ftyp",           "mp4" },
+        { 8, 4, "AVI ",           "avi" },
+        { 8, 4, "AIFF",           "aiff" },
+    };
+    const uint8_t *p_peek;
+
+    ssize_t i_peek = vlc_stream_Peek( s, &p_peek, 2 * 188 + 1 );
+    if( i_peek < 12 )
+        return NULL;
+
+    for( size_t i = 0; i < ARRAY_SIZE( signatures ); i++ )
+        if( !memcmp( p_peek + signatures[i].offset, signatures[i].magic,
+                     signatures[i].size ) )
+            return signatures[i].name;
+
+    /* MPEG-TS sync bytes */
+    if( i_peek > 2 * 188 && p_peek[0] == 0x47 && p_peek[188] == 0x47
+     && p_peek[2 * 188] == 0x47 )
+        return "ts";
+    return NULL;
+}
+
 /*****************************************************************************
  * demux_New:
  *  if s is NULL then load a access_demux
@@ -245,9 +283,6 @@ demux_t *demux_NewAdvanced( vlc_object_t *p_obj, input_thread_t *p_parent_input,
                 psz_module = DemuxNameFromExtension( psz_ext + 1, b_preparsing );
         }
 
-        if( psz_module == NULL )
-            psz_module = p_demux->psz_demux;
-
         /* ID3/APE tags will mess-up demuxer probing so we skip it here.
          * ID3/APE parsers will called later on in the demuxer to access the
          * skipped info. */
@@ -255,6 +290,14 @@ demux_t *demux_NewAdvanced( vlc_object_t *p_obj, input_thread_t *p_parent_input,
           ;
         SkipAPETag( p_demux );
 
+        /* Without a known extension, try the demuxer matching the first
+         * bytes before the others, rather than all of them by score */
+        if( psz_module == NULL && !strcmp( p_demux->psz_demux, "any" ) )
+            psz_module = DemuxNameFromMagic( p_demux->s );
+
+        if( psz_module == NULL )
+            psz_module = p_demux->psz_demux;
+
         p_demux->p_module =
             module_need( p_demux, "demux", psz_module,
                          !strcmp( psz_module, p_demux->psz_demux ) );
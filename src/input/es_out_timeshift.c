@@ -167,8 +167,8 @@ struct ts_storage_t
 #endif
     size_t  i_file_max; /* Max size in bytes */
     int64_t i_file_size;/* Current size in bytes */
-    FILE    *p_filew;   /* FILE handle for data writing */
-    FILE    *p_filer;   /* FILE handle for data reading */
+    FILE    *p_filew;   /* FILE handle for data writing (NULL in memory) */
+    FILE    *p_filer;   /* FILE handle for data reading (NULL in memory) */
 
     /* */
     int      i_cmd_r;
@@ -184,6 +184,8 @@ typedef struct
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
     const char     *psz_tmp_path;
+    int64_t        i_mem_max;
+    mtime_t        i_duration_max;
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
@@ -208,6 +210,11 @@ typedef struct
 
     mtime_t        i_cmd_delay;
 
+    /* */
+    int64_t        i_mem_size;    /* Size of the blocks kept in memory */
+    mtime_t        i_last_date;   /* Date of the last stored command */
+    mtime_t        i_status_date; /* Date of the last status update */
+
 } ts_thread_t;
 
 struct es_out_id_t
@@ -223,6 +230,8 @@ struct es_out_sys_t
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
+    int64_t        i_mem_max;         /* Maximal memory size in byte, 0 to use files */
+    mtime_t        i_duration_max;    /* Maximal delay, 0 for none */
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
@@ -256,12 +265,15 @@ static void         TsPushCmd( ts_thread_t *, ts_cmd_t * );
 static int          TsPopCmdLocked( ts_thread_t *, ts_cmd_t *, bool b_flush );
 static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
+static mtime_t      TsGetDepthLocked( ts_thread_t * );
+static void         TsDropLocked( ts_thread_t * );
+static void         TsUpdateStatus( ts_thread_t *, mtime_t i_depth, double f_fill );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, mtime_t i_date );
 static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
 
 static void         *TsRun( void * );
 
-static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
+static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max, bool b_memory );
 static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
@@ -378,7 +390,15 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
         p_sys->psz_tmp_path[len] = '\0';
     }
 #endif
-    if( p_sys->psz_tmp_path != NULL )
+    p_sys->i_mem_max = INT64_C(1024) * 1024 *
+                       __MAX( var_InheritInteger( p_input, "input-timeshift-memory" ), 0 );
+    p_sys->i_duration_max = CLOCK_FREQ *
+                       __MAX( var_InheritInteger( p_input, "input-timeshift-duration" ), 0 );
+
+    if( p_sys->i_mem_max > 0 )
+        msg_Dbg( p_input, "using timeshift memory of %d MiB",
+                 (int)(p_sys->i_mem_max/(1024*1024)) );
+    else if( p_sys->psz_tmp_path != NULL )
         msg_Dbg( p_input, "using timeshift path: %s", p_sys->psz_tmp_path );
     else
         msg_Dbg( p_input, "using default timeshift path" );
@@ -787,6 +807,8 @@ static int TsStart( es_out_t *p_out )
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
+    p_ts->i_mem_max = p_sys->i_mem_max;
+    p_ts->i_duration_max = p_sys->i_duration_max;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
     vlc_mutex_init( &p_ts->lock );
@@ -801,6 +823,9 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_cmd_delay = 0;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
+    p_ts->i_mem_size = 0;
+    p_ts->i_last_date = -1;
+    p_ts->i_status_date = -1;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
@@ -847,6 +872,7 @@ static void TsStop( ts_thread_t *p_ts )
         TsStorageDelete( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
 
+    TsUpdateStatus( p_ts, 0, 0.0 );
     TsDestroy( p_ts );
 }
 static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
@@ -855,7 +881,8 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 
     if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
     {
-        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
+        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max,
+                                                p_ts->i_mem_max > 0 );
 
         if( !p_storage )
         {
@@ -877,12 +904,36 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
         }
     }
 
+    if( p_cmd->i_type == C_SEND && p_ts->i_mem_max > 0 )
+        p_ts->i_mem_size += p_cmd->u.send.p_block->i_buffer;
+    p_ts->i_last_date = p_cmd->i_date;
+
     /* TODO return error and warn the user (but only once) */
     TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
 
+    TsDropLocked( p_ts );
+
     vlc_cond_signal( &p_ts->wait );
 
+    /* Refresh the status variables a few times per second */
+    mtime_t i_depth = 0;
+    double f_fill = 0.0;
+    const bool b_status = p_ts->i_status_date < 0 ||
+                          p_ts->i_last_date - p_ts->i_status_date >= CLOCK_FREQ/4;
+    if( b_status )
+    {
+        p_ts->i_status_date = p_ts->i_last_date;
+        i_depth = TsGetDepthLocked( p_ts );
+        if( p_ts->i_mem_max > 0 )
+            f_fill = (double)p_ts->i_mem_size / p_ts->i_mem_max;
+        if( p_ts->i_duration_max > 0 )
+            f_fill = __MAX( f_fill, (double)i_depth / p_ts->i_duration_max );
+    }
+
     vlc_mutex_unlock( &p_ts->lock );
+
+    if( b_status )
+        TsUpdateStatus( p_ts, i_depth, f_fill );
 }
 static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
 {
@@ -893,6 +944,9 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
 
     TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
 
+    if( p_cmd->i_type == C_SEND && p_cmd->u.send.p_block && p_ts->i_mem_max > 0 )
+        p_ts->i_mem_size -= p_cmd->u.send.p_block->i_buffer;
+
     while( p_ts->p_storage_r && TsStorageIsEmpty( p_ts->p_storage_r ) )
     {
         ts_storage_t *p_next = p_ts->p_storage_r->p_next;
@@ -905,6 +959,147 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
 
     return VLC_SUCCESS;
 }
+static mtime_t TsGetDepthLocked( ts_thread_t *p_ts )
+{
+    ts_storage_t *p_storage = p_ts->p_storage_r;
+
+    if( TsStorageIsEmpty( p_storage ) )
+        return 0;
+    return p_ts->i_last_date - p_storage->p_cmd[p_storage->i_cmd_r].i_date;
+}
+static bool TsIsOverLimits( ts_thread_t *p_ts )
+{
+    if( p_ts->i_mem_max > 0 && p_ts->i_mem_size > p_ts->i_mem_max )
+        return true;
+    if( p_ts->i_duration_max > 0 && TsGetDepthLocked( p_ts ) > p_ts->i_duration_max )
+        return true;
+    return false;
+}
+static bool CmdIsDroppable( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type == C_SEND )
+        return true;
+    return p_cmd->i_type == C_CONTROL &&
+           ( p_cmd->u.control.i_query == ES_OUT_SET_PCR ||
+             p_cmd->u.control.i_query == ES_OUT_SET_GROUP_PCR ||
+             p_cmd->u.control.i_query == ES_OUT_SET_TIMES );
+}
+/* Tells if p_later makes p_cmd useless: the same EPG table or meta data is
+ * sent again for the same group */
+static bool CmdIsSupersededBy( const ts_cmd_t *p_cmd, const ts_cmd_t *p_later )
+{
+    if( p_cmd->i_type != C_CONTROL || p_later->i_type != C_CONTROL ||
+        p_cmd->u.control.i_query != p_later->u.control.i_query )
+        return false;
+
+    switch( p_cmd->u.control.i_query )
+    {
+    case ES_OUT_SET_META:
+        return true;
+    case ES_OUT_SET_GROUP_META:
+        return p_cmd->u.control.u.int_meta.i_int == p_later->u.control.u.int_meta.i_int;
+    case ES_OUT_SET_GROUP_EPG:
+    {
+        const vlc_epg_t *p_epg = p_cmd->u.control.u.int_epg.p_epg;
+        const vlc_epg_t *p_later_epg = p_later->u.control.u.int_epg.p_epg;
+
+        return p_cmd->u.control.u.int_epg.i_int == p_later->u.control.u.int_epg.i_int &&
+               p_epg && p_later_epg &&
+               p_epg->i_id == p_later_epg->i_id &&
+               p_epg->i_source_id == p_later_epg->i_source_id;
+    }
+    default:
+        return false;
+    }
+}
+/* The storage is a ring once the limits are reached: the oldest data,
+ * clock references and times are dropped, and the delay is shortened by as
+ * much. Other commands cannot be dropped: they are stepped over, and kept
+ * right before the oldest command left, except for EPG and meta data sent
+ * again since. */
+static void TsDropLocked( ts_thread_t *p_ts )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    while( TsIsOverLimits( p_ts ) )
+    {
+        /* Find the oldest droppable command */
+        ts_storage_t *p_storage;
+        int i_drop = -1;
+
+        for( p_storage = p_ts->p_storage_r; p_storage; p_storage = p_storage->p_next )
+        {
+            for( int i = p_storage->i_cmd_r; i < p_storage->i_cmd_w && i_drop < 0; i++ )
+            {
+                if( CmdIsDroppable( &p_storage->p_cmd[i] ) )
+                    i_drop = i;
+            }
+            if( i_drop >= 0 )
+                break;
+        }
+        if( !p_storage )
+            break;
+
+        const mtime_t i_oldest_date = p_ts->p_storage_r->p_cmd[p_ts->p_storage_r->i_cmd_r].i_date;
+        ts_cmd_t *p_cmd = &p_storage->p_cmd[i_drop];
+        mtime_t i_date = p_cmd->i_date;
+
+        if( p_cmd->i_type == C_SEND && p_ts->i_mem_max > 0 )
+            p_ts->i_mem_size -= p_cmd->u.send.p_block->i_buffer;
+        CmdClean( p_cmd );
+
+        /* Move the commands stepped over in this storage next to the
+         * following one, without those superseded by a later one */
+        int i_kept = i_drop + 1;
+        for( int i = i_drop - 1; i >= p_storage->i_cmd_r; i-- )
+        {
+            bool b_superseded = false;
+
+            for( int j = i_kept; j <= i_drop && !b_superseded; j++ )
+                b_superseded = CmdIsSupersededBy( &p_storage->p_cmd[i],
+                                                  &p_storage->p_cmd[j] );
+            if( b_superseded )
+                CmdClean( &p_storage->p_cmd[i] );
+            else
+                p_storage->p_cmd[--i_kept] = p_storage->p_cmd[i];
+        }
+        p_storage->i_cmd_r = i_kept;
+
+        /* They will now be executed with the command following the dropped
+         * one, or at its date if it was the newest */
+        if( i_drop + 1 < p_storage->i_cmd_w )
+            i_date = p_storage->p_cmd[i_drop + 1].i_date;
+        else if( p_storage->p_next && !TsStorageIsEmpty( p_storage->p_next ) )
+            i_date = p_storage->p_next->p_cmd[p_storage->p_next->i_cmd_r].i_date;
+
+        for( ts_storage_t *p = p_ts->p_storage_r; ; p = p->p_next )
+        {
+            const int i_end = p == p_storage ? i_drop + 1 : p->i_cmd_w;
+
+            for( int i = p->i_cmd_r; i < i_end; i++ )
+                p->p_cmd[i].i_date = __MAX( p->p_cmd[i].i_date, i_date );
+            if( p == p_storage )
+                break;
+        }
+
+        while( TsStorageIsEmpty( p_ts->p_storage_r ) && p_ts->p_storage_r->p_next )
+        {
+            ts_storage_t *p_next_storage = p_ts->p_storage_r->p_next;
+
+            TsStorageDelete( p_ts->p_storage_r );
+            p_ts->p_storage_r = p_next_storage;
+        }
+
+        p_storage = p_ts->p_storage_r;
+        if( !TsStorageIsEmpty( p_storage ) )
+            p_ts->i_cmd_delay -= p_storage->p_cmd[p_storage->i_cmd_r].i_date - i_oldest_date;
+    }
+}
+static void TsUpdateStatus( ts_thread_t *p_ts, mtime_t i_depth, double f_fill )
+{
+    var_SetInteger( p_ts->p_input, "timeshift-depth", i_depth );
+    var_SetFloat( p_ts->p_input, "timeshift-fill", f_fill );
+}
 static bool TsHasCmd( ts_thread_t *p_ts )
 {
     bool b_cmd;
@@ -1099,19 +1294,12 @@ static void *TsRun( void *p_data )
 /*****************************************************************************
  *
  *****************************************************************************/
-static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max )
+static int TsStorageOpenFiles( ts_storage_t *p_storage, const char *psz_tmp_path )
 {
-    ts_storage_t *p_storage = malloc( sizeof (*p_storage) );
-    if( unlikely(p_storage == NULL) )
-        return NULL;
-
     char *psz_file;
     int fd = GetTmpFile( &psz_file, psz_tmp_path );
     if( fd == -1 )
-    {
-        free( p_storage );
-        return NULL;
-    }
+        return VLC_EGENERIC;
 
     p_storage->p_filew = fdopen( fd, "w+b" );
     if( p_storage->p_filew == NULL )
@@ -1135,6 +1323,30 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
 #else
     p_storage->psz_file = psz_file;
 #endif
+    return VLC_SUCCESS;
+error:
+    free( psz_file );
+    return VLC_EGENERIC;
+}
+
+static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max,
+                                  bool b_memory )
+{
+    ts_storage_t *p_storage = malloc( sizeof (*p_storage) );
+    if( unlikely(p_storage == NULL) )
+        return NULL;
+
+    if( b_memory )
+    {
+        /* The blocks are kept as is, the total size is bounded by the caller */
+        p_storage->p_filew = NULL;
+        p_storage->p_filer = NULL;
+    }
+    else if( TsStorageOpenFiles( p_storage, psz_tmp_path ) )
+    {
+        free( p_storage );
+        return NULL;
+    }
     p_storage->p_next = NULL;
 
     /* */
@@ -1154,10 +1366,6 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
         return NULL;
     }
     return p_storage;
-error:
-    free( psz_file );
-    free( p_storage );
-    return NULL;
 }
 
 static void TsStorageDelete( ts_storage_t *p_storage )
@@ -1172,12 +1380,15 @@ static void TsStorageDelete( ts_storage_t *p_storage )
     }
     free( p_storage->p_cmd );
 
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
+    if( p_storage->p_filew )
+    {
+        fclose( p_storage->p_filer );
+        fclose( p_storage->p_filew );
 #ifdef _WIN32
-    vlc_unlink( p_storage->psz_file );
-    free( p_storage->psz_file );
+        vlc_unlink( p_storage->psz_file );
+        free( p_storage->psz_file );
 #endif
+    }
     free( p_storage );
 }
 
@@ -1214,7 +1425,7 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
 
     assert( !TsStorageIsFull( p_storage, p_cmd ) );
 
-    if( cmd.i_type == C_SEND )
+    if( cmd.i_type == C_SEND && p_storage->p_filew )
     {
         block_t *p_block = cmd.u.send.p_block;
 
@@ -1248,7 +1459,7 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     assert( !TsStorageIsEmpty( p_storage ) );
 
     *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
-    if( p_cmd->i_type == C_SEND )
+    if( p_cmd->i_type == C_SEND && p_storage->p_filew )
     {
         block_t block;
 
@@ -212,6 +212,9 @@ void input_ControlVarInit ( input_thread_t *p_input )
     var_Create( p_input, "bit-rate", VLC_VAR_INTEGER );
     var_Create( p_input, "sample-rate", VLC_VAR_INTEGER );
 
+    var_Create( p_input, "timeshift-depth", VLC_VAR_INTEGER );
+    var_Create( p_input, "timeshift-fill", VLC_VAR_FLOAT );
+
     /* Special "intf-event" variable. */
     var_Create( p_input, "intf-event", VLC_VAR_INTEGER );
 
@@ -386,6 +386,13 @@ static const char *const ppsz_pos_descriptions[] =
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define VIDEO_FILTER_PIPELINE_TEXT N_("Pipelined video filters")
+#define VIDEO_FILTER_PIPELINE_LONGTEXT N_( \
+    "Run each video filter on its own thread, so that successive pictures " \
+    "are filtered in parallel on multi-core systems. This adds latency, " \
+    "and filter settings changed while paused only apply to the next " \
+    "pictures.")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -643,6 +650,12 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_FAST_SEEK_LONGTEXT N_( \
     "Favor speed over precision while seeking" )
 
+#define DEMUX_INDEX_CACHE_TEXT N_("Cache seek indexes")
+#define DEMUX_INDEX_CACHE_LONGTEXT N_( \
+    "Keep the seek indexes that some demuxers need to build from the " \
+    "whole file, so that seeking is immediate the next time the same " \
+    "local file is opened." )
+
 #define INPUT_RATE_TEXT N_("Playback speed")
 #define INPUT_RATE_LONGTEXT N_( \
     "This defines the playback speed (nominal speed is 1.0)." )
@@ -682,6 +695,17 @@ static const char *const ppsz_prefres[] = {
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_MEMORY_TEXT N_("Timeshift memory (MiB)")
+#define INPUT_TIMESHIFT_MEMORY_LONGTEXT N_( \
+    "Keep the timeshifted streams in memory, up to this size, instead of " \
+    "storing them in temporary files. The oldest data is dropped when " \
+    "the limit is reached. 0 uses temporary files." )
+
+#define INPUT_TIMESHIFT_DURATION_TEXT N_("Timeshift duration (s)")
+#define INPUT_TIMESHIFT_DURATION_LONGTEXT N_( \
+    "Maximum delay of the timeshifted streams. The oldest data is dropped " \
+    "when the limit is reached. 0 means no limit." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -822,6 +846,11 @@ static const char *const ppsz_prefres[] = {
     "However allocation of port numbers below 1025 is usually restricted " \
     "by the operating system." )
 
+#define HTTP_THREADS_TEXT N_( "HTTP server threads" )
+#define HTTP_THREADS_LONGTEXT N_( \
+    "Number of threads serving the connections of each HTTP and RTSP " \
+    "server. More threads help when streaming to many clients at once." )
+
 #define RTSP_PORT_TEXT N_( "RTSP server port" )
 #define RTSP_PORT_LONGTEXT N_( \
     "The RTSP server will listen on this TCP port. " \
@@ -1110,6 +1139,19 @@ static const char *const ppsz_prefres[] = {
 #define PREPARSE_TIMEOUT_LONGTEXT N_( \
     "Maximum time allowed to preparse a file" )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparsing threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of files preparsed at the same time." )
+
+#define FETCH_ART_THREADS_TEXT N_( "Art fetching threads" )
+#define FETCH_ART_THREADS_LONGTEXT N_( \
+    "Maximum number of files whose art is fetched at the same time." )
+
+#define FETCH_ART_TIMEOUT_TEXT N_( "Art fetching timeout" )
+#define FETCH_ART_TIMEOUT_LONGTEXT N_( \
+    "Maximum time allowed to fetch the art of a file (in milliseconds), " \
+    "or 0 for no limit." )
+
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
 #define SD_TEXT N_( "Services discovery modules")
@@ -1616,6 +1658,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list_cat( "video-filter", SUBCAT_VIDEO_VFILTER, NULL,
                 VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT, false )
+    add_bool( "video-filter-pipeline", false, VIDEO_FILTER_PIPELINE_TEXT,
+              VIDEO_FILTER_PIPELINE_LONGTEXT, true )
 
     set_subcategory( SUBCAT_VIDEO_SPLITTER )
     add_module_list( "video-splitter", "video splitter", NULL,
@@ -1719,6 +1763,8 @@ vlc_module_begin ()
     add_bool( "input-fast-seek", false,
               INPUT_FAST_SEEK_TEXT, INPUT_FAST_SEEK_LONGTEXT, false )
         change_safe ()
+    add_bool( "demux-index-cache", false,
+              DEMUX_INDEX_CACHE_TEXT, DEMUX_INDEX_CACHE_LONGTEXT, true )
     add_float( "rate", 1.,
                INPUT_RATE_TEXT, INPUT_RATE_LONGTEXT, false )
 
@@ -1751,6 +1797,9 @@ vlc_module_begin ()
         change_integer_range( 1, 65535 )
     add_integer( "https-port", 8443, HTTPS_PORT_TEXT, HTTPS_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
+    add_integer( "http-threads", 1, HTTP_THREADS_TEXT, HTTP_THREADS_LONGTEXT,
+                 true )
+        change_integer_range( 1, 64 )
     add_string( "rtsp-host", NULL, RTSP_HOST_TEXT, RTSP_HOST_LONGTEXT, true )
     add_integer( "rtsp-port", 554, RTSP_PORT_TEXT, RTSP_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
@@ -1866,6 +1915,10 @@ vlc_module_begin ()
                 INPUT_TIMESHIFT_PATH_LONGTEXT, true )
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_integer( "input-timeshift-memory", 0, INPUT_TIMESHIFT_MEMORY_TEXT,
+                 INPUT_TIMESHIFT_MEMORY_LONGTEXT, true )
+    add_integer( "input-timeshift-duration", 0, INPUT_TIMESHIFT_DURATION_TEXT,
+                 INPUT_TIMESHIFT_DURATION_LONGTEXT, true )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -2042,6 +2095,14 @@ vlc_module_begin ()
 
     add_integer( "preparse-timeout", 5000, PREPARSE_TIMEOUT_TEXT,
                  PREPARSE_TIMEOUT_LONGTEXT, false )
+    add_integer( "preparse-threads", 2, PREPARSE_THREADS_TEXT,
+                 PREPARSE_THREADS_LONGTEXT, true )
+        change_integer_range( 1, 32 )
+    add_integer( "fetch-art-threads", 2, FETCH_ART_THREADS_TEXT,
+                 FETCH_ART_THREADS_LONGTEXT, true )
+        change_integer_range( 1, 32 )
+    add_integer( "fetch-art-timeout", 30000, FETCH_ART_TIMEOUT_TEXT,
+                 FETCH_ART_TIMEOUT_LONGTEXT, true )
 
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
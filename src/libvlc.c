@@ -103,6 +103,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv = libvlc_priv (p_libvlc);
     priv->playlist = NULL;
     priv->p_vlm = NULL;
+    priv->slices = vlc_slices_New();
 
     vlc_ExitInit( &priv->exit );
 
@@ -544,6 +545,8 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
 
+    block_PoolDump( VLC_OBJECT(p_libvlc) );
+
     /* Free module bank. It is refcounted, so we call this each time  */
     vlc_LogDeinit (p_libvlc);
     module_EndBank (true);
@@ -564,6 +567,7 @@ void libvlc_InternalDestroy( libvlc_int_t *p_libvlc )
     libvlc_priv_t *priv = libvlc_priv( p_libvlc );
 
     vlc_ExitDestroy( &priv->exit );
+    vlc_slices_Delete( priv->slices );
 
     assert( atomic_load(&(vlc_internals(p_libvlc)->refs)) == 1 );
     vlc_object_release( p_libvlc );
@@ -48,6 +48,11 @@ size_t EnumClockSource( vlc_object_t *, const char *, char ***, char *** );
 void vlc_CPU_init(void);
 void vlc_CPU_dump(vlc_object_t *);
 
+/*
+ * Blocks
+ */
+void block_PoolDump(vlc_object_t *);
+
 /*
  * Threads subsystem
  */
@@ -135,6 +140,7 @@ void vlc_object_set_destructor (vlc_object_t *, vlc_destructor_t);
  */
 typedef struct vlc_dialog_provider vlc_dialog_provider;
 typedef struct vlc_keystore vlc_keystore;
+typedef struct vlc_slices vlc_slices_t;
 
 typedef struct libvlc_priv_t
 {
@@ -151,6 +157,7 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     struct vlc_actions *actions; ///< Hotkeys handler
+    vlc_slices_t      *slices; ///< Workers for slice-parallel filters (or NULL)
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -165,6 +172,12 @@ void intf_InsertItem(libvlc_int_t *, const char *mrl, unsigned optc,
                      const char * const *optv, unsigned flags);
 void intf_DestroyAll( libvlc_int_t * );
 
+/*
+ * Slice-parallel filters
+ */
+vlc_slices_t *vlc_slices_New(void);
+void vlc_slices_Delete(vlc_slices_t *);
+
 #define libvlc_stats( o ) (libvlc_priv((VLC_OBJECT(o))->obj.libvlc)->b_stats)
 
 /*
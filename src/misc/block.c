@@ -37,6 +37,8 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
+#include "libvlc.h"
 
 /**
  * @section Block handling functions.
@@ -124,15 +126,324 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/**
+ * @section Block pool
+ *
+ * Small and medium block_Alloc() allocations are rounded up to a power of
+ * two size class and recycled. Each thread keeps a cache of free blocks per
+ * class, so that allocating and releasing does not take any lock. Blocks are
+ * returned to the cache of the releasing thread, whichever thread allocated
+ * them. Caches exchange batches of blocks with a global depot when they run
+ * empty or overflow.
+ *
+ * The pool is disabled with address sanitizer builds, or if the
+ * VLC_BLOCK_POOL environment variable is set to 0, so that memory checkers
+ * can track each block.
+ */
+#define BLOCK_POOL_MIN_SHIFT 8  /* 256 bytes */
+#define BLOCK_POOL_MAX_SHIFT 16 /* 64 kiB */
+#define BLOCK_POOL_CLASSES   (BLOCK_POOL_MAX_SHIFT - BLOCK_POOL_MIN_SHIFT + 1)
+/** Maximum bytes cached per class in each thread and in the depot */
+#define BLOCK_POOL_CACHE_BYTES (256 << 10)
+#define BLOCK_POOL_DEPOT_BYTES (4 << 20)
+
+#if defined (__SANITIZE_ADDRESS__)
+# define BLOCK_POOL_DEFAULT false
+#elif defined (__has_feature)
+# if __has_feature(address_sanitizer)
+#  define BLOCK_POOL_DEFAULT false
+# endif
+#endif
+#ifndef BLOCK_POOL_DEFAULT
+# define BLOCK_POOL_DEFAULT true
+#endif
+
+struct block_cache
+{
+    block_t *list[BLOCK_POOL_CLASSES];
+    unsigned count[BLOCK_POOL_CLASSES];
+    /* Statistics not yet added to block_pool_stats */
+    unsigned long allocs;
+    unsigned long hits;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    block_t *list[BLOCK_POOL_CLASSES];
+    unsigned count[BLOCK_POOL_CLASSES];
+} block_depot = { VLC_STATIC_MUTEX, { NULL }, { 0 } };
+
+/* Allocations and hits are counted in each thread cache, and only added
+ * there when the cache exchanges blocks with the depot, or is destroyed,
+ * so that the fast paths do not share any cache line. */
+static struct
+{
+    atomic_ulong allocs;  /**< Allocations within the size classes */
+    atomic_ulong hits;    /**< Allocations from a thread cache */
+    atomic_ulong refills; /**< Thread cache refills from the depot */
+    atomic_ulong flushes; /**< Thread cache flushes to the depot */
+    atomic_ulong frees;   /**< Blocks given back to the C library */
+} block_pool_stats;
+
+static vlc_mutex_t block_pool_lock = VLC_STATIC_MUTEX;
+static vlc_threadvar_t block_pool_var;
+static atomic_int block_pool_state = ATOMIC_VAR_INIT(0);
+
+static inline size_t block_PoolClassSize(unsigned c)
+{
+    return (size_t)1 << (c + BLOCK_POOL_MIN_SHIFT);
+}
+
+/* Maximum number of blocks per class in a thread cache */
+static inline unsigned block_PoolCacheMax(unsigned c)
+{
+    return __MAX(BLOCK_POOL_CACHE_BYTES / block_PoolClassSize(c), 4);
+}
+
+static int block_PoolClass(size_t alloc)
+{
+    for (unsigned c = 0; c < BLOCK_POOL_CLASSES; c++)
+        if (alloc <= block_PoolClassSize(c))
+            return c;
+    return -1;
+}
+
+/**
+ * Gives a list of blocks of a class to the depot, or to the C library if the
+ * depot is full.
+ */
+static void block_DepotPut(unsigned c, block_t *list, block_t **tail,
+                           unsigned count)
+{
+    const unsigned max = BLOCK_POOL_DEPOT_BYTES / block_PoolClassSize(c);
+
+    vlc_mutex_lock(&block_depot.lock);
+    if (block_depot.count[c] + count <= max)
+    {
+        *tail = block_depot.list[c];
+        block_depot.list[c] = list;
+        block_depot.count[c] += count;
+        list = NULL;
+    }
+    vlc_mutex_unlock(&block_depot.lock);
+
+    if (list == NULL)
+        return;
+
+    atomic_fetch_add_explicit(&block_pool_stats.frees, count,
+                              memory_order_relaxed);
+    while (list != NULL)
+    {
+        block_t *next = list->p_next;
+
+        free(list);
+        list = next;
+    }
+}
+
+static void block_CacheFlushStats(struct block_cache *cache)
+{
+    atomic_fetch_add_explicit(&block_pool_stats.allocs, cache->allocs,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&block_pool_stats.hits, cache->hits,
+                              memory_order_relaxed);
+    cache->allocs = 0;
+    cache->hits = 0;
+}
+
+static void block_CacheDestroy(void *data)
+{
+    struct block_cache *cache = data;
+
+    block_CacheFlushStats(cache);
+
+    for (unsigned c = 0; c < BLOCK_POOL_CLASSES; c++)
+    {
+        block_t **tail = &cache->list[c];
+
+        if (*tail == NULL)
+            continue;
+        while (*tail != NULL)
+            tail = &(*tail)->p_next;
+        block_DepotPut(c, cache->list[c], tail, cache->count[c]);
+    }
+    free(cache);
+}
+
+static bool block_PoolEnabled(void)
+{
+    int state = atomic_load_explicit(&block_pool_state, memory_order_acquire);
+
+    if (likely(state != 0))
+        return state > 0;
+
+    vlc_mutex_lock(&block_pool_lock);
+    state = atomic_load_explicit(&block_pool_state, memory_order_relaxed);
+    if (state == 0)
+    {
+        const char *env = getenv("VLC_BLOCK_POOL");
+        bool enabled = (env != NULL) ? atoi(env) != 0 : BLOCK_POOL_DEFAULT;
+
+        if (enabled
+         && vlc_threadvar_create(&block_pool_var, block_CacheDestroy))
+            enabled = false;
+        state = enabled ? 1 : -1;
+        atomic_store_explicit(&block_pool_state, state, memory_order_release);
+    }
+    vlc_mutex_unlock(&block_pool_lock);
+    return state > 0;
+}
+
+static struct block_cache *block_CacheGet(void)
+{
+    struct block_cache *cache = vlc_threadvar_get(block_pool_var);
+
+    if (unlikely(cache == NULL))
+    {
+        cache = calloc(1, sizeof (*cache));
+        if (likely(cache != NULL)
+         && unlikely(vlc_threadvar_set(block_pool_var, cache)))
+        {
+            free(cache);
+            cache = NULL;
+        }
+    }
+    return cache;
+}
+
+static block_t *block_PoolGet(unsigned c)
+{
+    struct block_cache *cache = block_CacheGet();
+
+    if (unlikely(cache == NULL))
+    {
+        atomic_fetch_add_explicit(&block_pool_stats.allocs, 1,
+                                  memory_order_relaxed);
+        return malloc(block_PoolClassSize(c));
+    }
+
+    cache->allocs++;
+    if (cache->list[c] == NULL)
+    {   /* Take a batch of blocks from the depot */
+        unsigned count = block_PoolCacheMax(c) / 2;
+        block_t *list, **tail;
+
+        block_CacheFlushStats(cache);
+
+        vlc_mutex_lock(&block_depot.lock);
+        list = block_depot.list[c];
+        tail = &list;
+        if (count > block_depot.count[c])
+            count = block_depot.count[c];
+        for (unsigned i = 0; i < count; i++)
+            tail = &(*tail)->p_next;
+        block_depot.list[c] = *tail;
+        block_depot.count[c] -= count;
+        vlc_mutex_unlock(&block_depot.lock);
+
+        *tail = NULL;
+        if (count == 0)
+            return malloc(block_PoolClassSize(c));
+
+        cache->list[c] = list;
+        cache->count[c] = count;
+        atomic_fetch_add_explicit(&block_pool_stats.refills, 1,
+                                  memory_order_relaxed);
+    }
+    else
+        cache->hits++;
+
+    block_t *b = cache->list[c];
+
+    cache->list[c] = b->p_next;
+    cache->count[c]--;
+    return b;
+}
+
+static void block_pool_Release (block_t *block)
+{
+    /* That is always true for blocks allocated with block_Alloc(). */
+    assert (block->p_start == (unsigned char *)(block + 1));
+
+    int c = block_PoolClass (sizeof (*block) + block->i_size);
+    assert (c >= 0);
+    assert (block_PoolClassSize (c) == sizeof (*block) + block->i_size);
+    block_Invalidate (block);
+
+    struct block_cache *cache = block_CacheGet ();
+    if (unlikely(cache == NULL))
+    {
+        free (block);
+        return;
+    }
+
+    block->p_next = cache->list[c];
+    cache->list[c] = block;
+
+    if (++cache->count[c] <= block_PoolCacheMax (c))
+        return;
+
+    /* Give half of the cache back to the depot */
+    unsigned count = cache->count[c] / 2;
+    block_t **tail = &cache->list[c];
+
+    for (unsigned i = 0; i < cache->count[c] - count; i++)
+        tail = &(*tail)->p_next;
+
+    block_t *list = *tail;
+
+    *tail = NULL;
+    cache->count[c] -= count;
+    for (tail = &list; *tail != NULL; tail = &(*tail)->p_next);
+
+    atomic_fetch_add_explicit (&block_pool_stats.flushes, 1,
+                               memory_order_relaxed);
+    block_CacheFlushStats (cache);
+    block_DepotPut (c, list, tail, count);
+}
+
+/**
+ * Prints block pool statistics.
+ *
+ * Allocations served by thread caches since their last exchange with the
+ * depot are not accounted yet.
+ */
+void block_PoolDump (vlc_object_t *obj)
+{
+    if (atomic_load (&block_pool_state) <= 0)
+        return;
+
+    unsigned long allocs = atomic_load (&block_pool_stats.allocs);
+    unsigned long hits = atomic_load (&block_pool_stats.hits);
+
+    msg_Dbg (obj, "block pool: %lu allocations, %lu%% from thread caches, "
+             "%lu refills, %lu flushes, %lu freed", allocs,
+             allocs ? (hits * 100) / allocs : 0,
+             atomic_load (&block_pool_stats.refills),
+             atomic_load (&block_pool_stats.flushes),
+             atomic_load (&block_pool_stats.frees));
+}
+
 block_t *block_Alloc (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
+    size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                 + size;
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
+    int c = block_PoolClass (alloc);
+    bool pooled = c >= 0 && block_PoolEnabled ();
+    block_t *b;
+
+    if (pooled)
+    {
+        alloc = block_PoolClassSize (c);
+        b = block_PoolGet (c);
+    }
+    else
+        b = malloc (alloc);
     if (unlikely(b == NULL))
         return NULL;
 
@@ -142,7 +453,7 @@ block_t *block_Alloc (size_t size)
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
     b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
     b->i_buffer = size;
-    b->pf_release = block_generic_Release;
+    b->pf_release = pooled ? block_pool_Release : block_generic_Release;
     return b;
 }
 
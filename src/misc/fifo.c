@@ -30,12 +30,15 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "libvlc.h"
 
 /**
  * @section Thread-safe block queue functions
  */
 
+#define FIFO_RING_SIZE 256 /* must be a power of two */
+
 /**
  * Internal state for block queues
  */
@@ -48,8 +51,87 @@ struct block_fifo_t
     block_t             **pp_last;
     size_t              i_depth;
     size_t              i_size;
+
+    /* Lock-free ring, only for single producer FIFOs (NULL otherwise).
+     * Blocks in the ring are always older than blocks in the list above. */
+    atomic_uintptr_t    *ring;
+    atomic_bool         spilled;   /**< The list is not empty */
+
+    /* Consumer side */
+    char                pad_head[64];
+    atomic_size_t       ring_head; /**< Next block to dequeue */
+    atomic_size_t       ring_out;  /**< Bytes dequeued from the ring */
+    atomic_uint         waiters;   /**< Threads sleeping on the FIFO */
+
+    /* Producer side (written by the producer thread only) */
+    char                pad_tail[64];
+    atomic_size_t       ring_tail; /**< Next free slot */
+    atomic_size_t       ring_in;   /**< Bytes queued into the ring */
 };
 
+/**
+ * Queues one block in the lock-free ring (from the producer thread).
+ * @return false if the ring is full or the list is in use
+ */
+static bool block_FifoPush(block_fifo_t *fifo, block_t *block)
+{
+    if (atomic_load(&fifo->spilled))
+        return false; /* preserve ordering */
+
+    size_t tail = atomic_load_explicit(&fifo->ring_tail, memory_order_relaxed);
+
+    if (tail - atomic_load_explicit(&fifo->ring_head, memory_order_acquire)
+            >= FIFO_RING_SIZE)
+        return false;
+
+    atomic_store_explicit(&fifo->ring_in,
+        atomic_load_explicit(&fifo->ring_in, memory_order_relaxed)
+            + block->i_buffer, memory_order_relaxed);
+    atomic_store_explicit(&fifo->ring[tail & (FIFO_RING_SIZE - 1)],
+                          (uintptr_t)block, memory_order_relaxed);
+    atomic_store_explicit(&fifo->ring_tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Dequeues the oldest block from the lock-free ring, if any.
+ */
+static block_t *block_FifoPop(block_fifo_t *fifo)
+{
+    size_t head = atomic_load_explicit(&fifo->ring_head, memory_order_relaxed);
+    block_t *block;
+
+    /* Several threads may dequeue, e.g. block_FifoEmpty() from another
+     * thread than the consumer, hence the compare-and-swap. */
+    do
+    {
+        if (head == atomic_load_explicit(&fifo->ring_tail,
+                                         memory_order_acquire))
+            return NULL;
+
+        block = (block_t *)atomic_load_explicit(&fifo->ring[head & (FIFO_RING_SIZE - 1)],
+                                                memory_order_relaxed);
+    }
+    while (!atomic_compare_exchange_weak(&fifo->ring_head, &head, head + 1));
+
+    atomic_fetch_add_explicit(&fifo->ring_out, block->i_buffer,
+                              memory_order_relaxed);
+    return block;
+}
+
+static bool block_FifoRingEmpty(const block_fifo_t *fifo)
+{
+    return atomic_load(&((block_fifo_t *)fifo)->ring_head)
+        == atomic_load(&((block_fifo_t *)fifo)->ring_tail);
+}
+
+static void block_FifoUnwait(void *data)
+{
+    block_fifo_t *fifo = data;
+
+    atomic_fetch_sub(&fifo->waiters, 1);
+}
+
 /**
  * Locks a block FIFO. No more than one thread can lock the FIFO at any given
  * time, and no other thread can modify the FIFO while it is locked.
@@ -107,7 +189,22 @@ void vlc_fifo_Wait(vlc_fifo_t *fifo)
 
 void vlc_fifo_WaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar)
 {
-    vlc_cond_wait(condvar, &fifo->lock);
+    if (fifo->ring == NULL)
+    {
+        vlc_cond_wait(condvar, &fifo->lock);
+        return;
+    }
+
+    /* The producer only locks the FIFO to signal it if there are waiters.
+     * Check the ring again after announcing this thread (spurious wake-up). */
+    atomic_fetch_add(&fifo->waiters, 1);
+    if (block_FifoRingEmpty(fifo))
+    {
+        vlc_cleanup_push(block_FifoUnwait, fifo);
+        vlc_cond_wait(condvar, &fifo->lock);
+        vlc_cleanup_pop();
+    }
+    atomic_fetch_sub(&fifo->waiters, 1);
 }
 
 /**
@@ -116,7 +213,20 @@ void vlc_fifo_WaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar)
  */
 int vlc_fifo_TimedWaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar, mtime_t deadline)
 {
-    return vlc_cond_timedwait(condvar, &fifo->lock, deadline);
+    if (fifo->ring == NULL)
+        return vlc_cond_timedwait(condvar, &fifo->lock, deadline);
+
+    int ret = 0;
+
+    atomic_fetch_add(&fifo->waiters, 1);
+    if (block_FifoRingEmpty(fifo))
+    {
+        vlc_cleanup_push(block_FifoUnwait, fifo);
+        ret = vlc_cond_timedwait(condvar, &fifo->lock, deadline);
+        vlc_cleanup_pop();
+    }
+    atomic_fetch_sub(&fifo->waiters, 1);
+    return ret;
 }
 
 /**
@@ -131,7 +241,15 @@ int vlc_fifo_TimedWaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar, mtime_t deadli
  */
 size_t vlc_fifo_GetCount(const vlc_fifo_t *fifo)
 {
-    return fifo->i_depth;
+    size_t depth = fifo->i_depth;
+
+    if (fifo->ring != NULL)
+    {
+        vlc_fifo_t *f = (vlc_fifo_t *)fifo;
+
+        depth += atomic_load(&f->ring_tail) - atomic_load(&f->ring_head);
+    }
+    return depth;
 }
 
 /**
@@ -150,7 +268,16 @@ size_t vlc_fifo_GetCount(const vlc_fifo_t *fifo)
  */
 size_t vlc_fifo_GetBytes(const vlc_fifo_t *fifo)
 {
-    return fifo->i_size;
+    size_t size = fifo->i_size;
+
+    if (fifo->ring != NULL)
+    {
+        vlc_fifo_t *f = (vlc_fifo_t *)fifo;
+        size_t out = atomic_load(&f->ring_out);
+
+        size += atomic_load(&f->ring_in) - out;
+    }
+    return size;
 }
 
 /**
@@ -169,6 +296,9 @@ void vlc_fifo_QueueUnlocked(block_fifo_t *fifo, block_t *block)
     vlc_assert_locked(&fifo->lock);
     assert(*(fifo->pp_last) == NULL);
 
+    if (fifo->ring != NULL && block != NULL)
+        atomic_store(&fifo->spilled, true);
+
     *(fifo->pp_last) = block;
 
     while (block != NULL)
@@ -197,14 +327,23 @@ block_t *vlc_fifo_DequeueUnlocked(block_fifo_t *fifo)
 {
     vlc_assert_locked(&fifo->lock);
 
-    block_t *block = fifo->p_first;
+    block_t *block;
+
+    if (fifo->ring != NULL && (block = block_FifoPop(fifo)) != NULL)
+        return block;
+
+    block = fifo->p_first;
 
     if (block == NULL)
         return NULL; /* Nothing to do */
 
     fifo->p_first = block->p_next;
     if (block->p_next == NULL)
+    {
         fifo->pp_last = &fifo->p_first;
+        if (fifo->ring != NULL)
+            atomic_store(&fifo->spilled, false);
+    }
     block->p_next = NULL;
 
     assert(fifo->i_depth > 0);
@@ -233,6 +372,20 @@ block_t *vlc_fifo_DequeueAllUnlocked(block_fifo_t *fifo)
 
     block_t *block = fifo->p_first;
 
+    if (fifo->ring != NULL)
+    {
+        block_t *head = NULL, **pp = &head, *b;
+
+        while ((b = block_FifoPop(fifo)) != NULL)
+        {
+            *pp = b;
+            pp = &b->p_next;
+        }
+        *pp = block;
+        block = head;
+        atomic_store(&fifo->spilled, false);
+    }
+
     fifo->p_first = NULL;
     fifo->pp_last = &fifo->p_first;
     fifo->i_depth = 0;
@@ -258,6 +411,43 @@ block_fifo_t *block_FifoNew( void )
     p_fifo->p_first = NULL;
     p_fifo->pp_last = &p_fifo->p_first;
     p_fifo->i_depth = p_fifo->i_size = 0;
+    p_fifo->ring = NULL;
+
+    return p_fifo;
+}
+
+/**
+ * Creates a thread-safe FIFO queue of blocks for a single producer thread.
+ *
+ * Queueing with block_FifoPut() and dequeueing with block_FifoGet() are
+ * lock-free as long as the FIFO is neither empty nor too full. The FIFO
+ * otherwise behaves like one created with block_FifoNew(), and the
+ * vlc_fifo_*() functions can still be used.
+ *
+ * @warning Only one thread at a time may queue blocks.
+ * @return the FIFO or NULL on memory error
+ */
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    block_fifo_t *p_fifo = block_FifoNew();
+    if( !p_fifo )
+        return NULL;
+
+    p_fifo->ring = malloc( FIFO_RING_SIZE * sizeof( *p_fifo->ring ) );
+    if( !p_fifo->ring )
+    {
+        block_FifoRelease( p_fifo );
+        return NULL;
+    }
+
+    for( size_t i = 0; i < FIFO_RING_SIZE; i++ )
+        atomic_init( &p_fifo->ring[i], 0 );
+    atomic_init( &p_fifo->ring_head, 0 );
+    atomic_init( &p_fifo->ring_tail, 0 );
+    atomic_init( &p_fifo->ring_in, 0 );
+    atomic_init( &p_fifo->ring_out, 0 );
+    atomic_init( &p_fifo->spilled, false );
+    atomic_init( &p_fifo->waiters, 0 );
 
     return p_fifo;
 }
@@ -268,6 +458,14 @@ block_fifo_t *block_FifoNew( void )
  */
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
+    if( p_fifo->ring != NULL )
+    {
+        block_t *b;
+
+        while( (b = block_FifoPop( p_fifo )) != NULL )
+            block_Release( b );
+        free( p_fifo->ring );
+    }
     block_ChainRelease( p_fifo->p_first );
     vlc_cond_destroy( &p_fifo->wait );
     vlc_mutex_destroy( &p_fifo->lock );
@@ -294,6 +492,36 @@ void block_FifoEmpty(block_fifo_t *fifo)
  */
 void block_FifoPut(block_fifo_t *fifo, block_t *block)
 {
+    if (fifo->ring != NULL)
+    {
+        while (block != NULL)
+        {
+            block_t *next = block->p_next;
+
+            block->p_next = NULL;
+            if (!block_FifoPush(fifo, block))
+            {
+                block->p_next = next;
+                break;
+            }
+            block = next;
+        }
+
+        if (block == NULL)
+        {
+            /* pairs with the consumer incrementing waiters then checking
+             * the ring in vlc_fifo_WaitCond() */
+            atomic_thread_fence(memory_order_seq_cst);
+            if (atomic_load_explicit(&fifo->waiters, memory_order_relaxed) > 0)
+            {   /* the consumer is asleep */
+                vlc_fifo_Lock(fifo);
+                vlc_fifo_Signal(fifo);
+                vlc_fifo_Unlock(fifo);
+            }
+            return;
+        }
+    }
+
     vlc_fifo_Lock(fifo);
     vlc_fifo_QueueUnlocked(fifo, block);
     vlc_fifo_Unlock(fifo);
@@ -311,6 +539,9 @@ block_t *block_FifoGet(block_fifo_t *fifo)
 
     vlc_testcancel();
 
+    if (fifo->ring != NULL && (block = block_FifoPop(fifo)) != NULL)
+        return block;
+
     vlc_fifo_Lock(fifo);
     while (vlc_fifo_IsEmpty(fifo))
     {
@@ -339,6 +570,13 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 {
     block_t *b;
 
+    if( p_fifo->ring != NULL && !block_FifoRingEmpty( p_fifo ) )
+    {
+        size_t head = atomic_load( &p_fifo->ring_head );
+
+        return (block_t *)atomic_load( &p_fifo->ring[head & (FIFO_RING_SIZE - 1)] );
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     assert(p_fifo->p_first != NULL);
     b = p_fifo->p_first;
@@ -352,8 +590,12 @@ size_t block_FifoSize (block_fifo_t *fifo)
 {
     size_t size;
 
+    /* Only the ring is in use: no need to lock */
+    if (fifo->ring != NULL && !atomic_load(&fifo->spilled))
+        return vlc_fifo_GetBytes (fifo);
+
     vlc_mutex_lock (&fifo->lock);
-    size = fifo->i_size;
+    size = vlc_fifo_GetBytes (fifo);
     vlc_mutex_unlock (&fifo->lock);
     return size;
 }
@@ -363,8 +605,11 @@ size_t block_FifoCount (block_fifo_t *fifo)
 {
     size_t depth;
 
+    if (fifo->ring != NULL && !atomic_load(&fifo->spilled))
+        return vlc_fifo_GetCount (fifo);
+
     vlc_mutex_lock (&fifo->lock);
-    depth = fifo->i_depth;
+    depth = vlc_fifo_GetCount (fifo);
     vlc_mutex_unlock (&fifo->lock);
     return depth;
 }
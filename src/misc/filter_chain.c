@@ -29,6 +29,7 @@
 #include <vlc_modules.h>
 #include <vlc_spu.h>
 #include <libvlc.h>
+#include "filter_chain.h"
 #include <assert.h>
 
 typedef struct chained_filter_t
@@ -39,6 +40,19 @@ typedef struct chained_filter_t
     struct chained_filter_t *prev, *next;
     vlc_mouse_t *mouse;
     picture_t *pending;
+
+    /* Statistics */
+    uint64_t count; /**< Number of processed pictures */
+    mtime_t time_total; /**< Total processing time */
+    mtime_t time_max; /**< Longest processing time */
+
+    /* Pipelined execution */
+    vlc_thread_t thread;
+    vlc_mutex_t lock; /**< Serializes the filter callbacks */
+    picture_t *queue, **queue_tail; /**< Input pictures */
+    unsigned queue_length;
+    mtime_t time_starved; /**< Time spent waiting for input */
+    mtime_t time_blocked; /**< Time spent waiting for downstream space */
 } chained_filter_t;
 
 /* Only use this with filter objects from _this_ C module */
@@ -47,6 +61,10 @@ static inline chained_filter_t *chained (filter_t *filter)
     return (chained_filter_t *)filter;
 }
 
+/* Maximum number of private pictures allocated by the last pipelined filter
+ * with a thread-safe owner allocator */
+#define FILTER_CHAIN_MAX_COPIES 8
+
 /* */
 struct filter_chain_t
 {
@@ -59,13 +77,36 @@ struct filter_chain_t
     es_format_t fmt_out; /**< Chain current output format */
     unsigned length; /**< Number of filters */
     bool b_allow_fmt_out_change; /**< Can the output format be changed? */
+
+    struct
+    {
+        bool enabled; /**< Is pipelined execution requested? */
+        bool owner_alloc; /**< Is the owner allocator thread-safe? */
+        bool running; /**< Are the filter threads running? */
+        bool stopping; /**< Are the filter threads requested to exit? */
+        vlc_mutex_t lock; /**< Protects the queues */
+        vlc_cond_t wait; /**< Signaled on any queue change */
+        picture_t *output, **output_tail; /**< Output pictures */
+        unsigned in_flight; /**< Pictures queued, processed or output */
+        void (*wake)(void *); /**< Output notification callback */
+        void *opaque;
+        /** Private pictures of the last filter, if the owner allocator is
+         * thread-safe but was exhausted */
+        picture_t *copies[FILTER_CHAIN_MAX_COPIES];
+        unsigned copies_count;
+    } pipeline;
+
     char psz_capability[]; /**< Module capability for all chained filters */
 };
 
+/* Maximum number of pictures queued before each pipelined filter */
+#define FILTER_CHAIN_QUEUE_LENGTH 1
+
 /**
  * Local prototypes
  */
 static void FilterDeletePictures( picture_t * );
+static void FilterChainPipelineStop( filter_chain_t * );
 
 static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     const char *cap, bool fmt_out_change, const filter_owner_t *owner )
@@ -86,6 +127,18 @@ static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     es_format_Init( &chain->fmt_out, UNKNOWN_ES, 0 );
     chain->length = 0;
     chain->b_allow_fmt_out_change = fmt_out_change;
+    chain->pipeline.enabled = false;
+    chain->pipeline.owner_alloc = false;
+    chain->pipeline.running = false;
+    chain->pipeline.stopping = false;
+    vlc_mutex_init( &chain->pipeline.lock );
+    vlc_cond_init( &chain->pipeline.wait );
+    chain->pipeline.output = NULL;
+    chain->pipeline.output_tail = &chain->pipeline.output;
+    chain->pipeline.in_flight = 0;
+    chain->pipeline.wake = NULL;
+    chain->pipeline.opaque = NULL;
+    chain->pipeline.copies_count = 0;
     strcpy( chain->psz_capability, cap );
 
     return chain;
@@ -108,23 +161,40 @@ filter_chain_t *filter_chain_New( vlc_object_t *obj, const char *cap,
 /** Chained filter picture allocator function */
 static picture_t *filter_chain_VideoBufferNew( filter_t *filter )
 {
-    if( chained(filter)->next != NULL )
-    {
-        picture_t *pic = picture_NewFromFormat( &filter->fmt_out.video );
-        if( pic == NULL )
-            msg_Err( filter, "Failed to allocate picture" );
-        return pic;
-    }
-    else
-    {
-        filter_chain_t *chain = filter->owner.sys;
+    filter_chain_t *chain = filter->owner.sys;
+    bool last = chained(filter)->next == NULL;
+    picture_t *pic;
 
+    if( last && (!chain->pipeline.running || chain->pipeline.owner_alloc) )
+    {
         /* XXX ugly */
         filter->owner.sys = chain->owner.sys;
-        picture_t *pic = chain->owner.video.buffer_new( filter );
+        pic = chain->owner.video.buffer_new( filter );
         filter->owner.sys = chain;
-        return pic;
+        if( pic != NULL || !chain->pipeline.running )
+            return pic;
+        /* The owner pictures can all be queued at the chain output */
+    }
+
+    /* In pipelined mode, the last filter does not run on the owner thread.
+     * Unless the owner allocator is thread-safe, its output is copied to an
+     * owner picture later, see FilterChainPipelineOutput(). */
+    pic = picture_NewFromFormat( &filter->fmt_out.video );
+    if( pic != NULL && last && chain->pipeline.owner_alloc )
+    {
+        vlc_mutex_lock( &chain->pipeline.lock );
+        if( chain->pipeline.copies_count < FILTER_CHAIN_MAX_COPIES )
+            chain->pipeline.copies[chain->pipeline.copies_count++] = pic;
+        else
+        {
+            picture_Release( pic );
+            pic = NULL;
+        }
+        vlc_mutex_unlock( &chain->pipeline.lock );
     }
+    if( pic == NULL )
+        msg_Err( filter, "Failed to allocate picture" );
+    return pic;
 }
 
 #undef filter_chain_NewVideo
@@ -152,6 +222,8 @@ void filter_chain_Delete( filter_chain_t *p_chain )
 
     es_format_Clean( &p_chain->fmt_in );
     es_format_Clean( &p_chain->fmt_out );
+    vlc_cond_destroy( &p_chain->pipeline.wait );
+    vlc_mutex_destroy( &p_chain->pipeline.lock );
 
     free( p_chain );
 }
@@ -187,6 +259,9 @@ filter_t *filter_chain_AppendFilter( filter_chain_t *chain, const char *name,
     if( unlikely(chained == NULL) )
         return NULL;
 
+    /* The threads are restarted with the new filter on the next picture */
+    FilterChainPipelineStop( chain );
+
     filter_t *filter = &chained->filter;
 
     if( fmt_in == NULL )
@@ -236,6 +311,15 @@ filter_t *filter_chain_AppendFilter( filter_chain_t *chain, const char *name,
         vlc_mouse_Init( mouse );
     chained->mouse = mouse;
     chained->pending = NULL;
+    chained->count = 0;
+    chained->time_total = 0;
+    chained->time_max = 0;
+    vlc_mutex_init( &chained->lock );
+    chained->queue = NULL;
+    chained->queue_tail = &chained->queue;
+    chained->queue_length = 0;
+    chained->time_starved = 0;
+    chained->time_blocked = 0;
 
     msg_Dbg( parent, "Filter '%s' (%p) appended to chain",
              (name != NULL) ? name : module_get_name(filter->p_module, false),
@@ -259,6 +343,8 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
     vlc_object_t *obj = chain->callbacks.sys;
     chained_filter_t *chained = (chained_filter_t *)filter;
 
+    FilterChainPipelineStop( chain );
+
     /* Remove it from the chain */
     if( chained->prev != NULL )
         chained->prev->next = chained->next;
@@ -282,7 +368,15 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
     module_unneed( filter, filter->p_module );
 
     msg_Dbg( obj, "Filter %p removed from chain", (void *)filter );
+    if( chained->count > 0 )
+        msg_Dbg( obj, "Filter %p processed %"PRIu64" pictures in %"PRId64
+                 " us on average (%"PRId64" us max), %"PRId64" ms starved, "
+                 "%"PRId64" ms blocked", (void *)filter, chained->count,
+                 chained->time_total / (mtime_t)chained->count,
+                 chained->time_max, chained->time_starved / 1000,
+                 chained->time_blocked / 1000 );
     FilterDeletePictures( chained->pending );
+    vlc_mutex_destroy( &chained->lock );
 
     free( chained->mouse );
     es_format_Clean( &filter->fmt_out );
@@ -369,12 +463,28 @@ const es_format_t *filter_chain_GetFmtOut( filter_chain_t *p_chain )
     return &p_chain->fmt_out;
 }
 
+/** Runs a single filter and accounts for its processing time */
+static picture_t *FilterRun( chained_filter_t *f, picture_t *p_pic )
+{
+    filter_t *p_filter = &f->filter;
+    mtime_t start = mdate();
+
+    p_pic = p_filter->pf_video_filter( p_filter, p_pic );
+
+    mtime_t duration = mdate() - start;
+    f->count++;
+    f->time_total += duration;
+    if( duration > f->time_max )
+        f->time_max = duration;
+    return p_pic;
+}
+
 static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic )
 {
     for( ; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
-        p_pic = p_filter->pf_video_filter( p_filter, p_pic );
+        p_pic = FilterRun( f, p_pic );
         if( !p_pic )
             break;
         if( f->pending )
@@ -388,8 +498,275 @@ static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic
     return p_pic;
 }
 
+/*
+ * Pipelined execution: each filter runs on its own thread, and takes its
+ * input pictures from a bounded queue filled by the previous filter (or by
+ * the chain owner for the first filter). The last filter appends its output
+ * to an unbounded queue, which holds at most the pictures in flight, since
+ * the owner only pushes pictures until it gets one out.
+ */
+static void FilterChainEnqueue( chained_filter_t *f, picture_t *pic )
+{
+    pic->p_next = NULL;
+    *f->queue_tail = pic;
+    f->queue_tail = &pic->p_next;
+    f->queue_length++;
+}
+
+static picture_t *FilterChainDequeue( chained_filter_t *f )
+{
+    picture_t *pic = f->queue;
+
+    assert( pic != NULL );
+    f->queue = pic->p_next;
+    if( f->queue == NULL )
+        f->queue_tail = &f->queue;
+    f->queue_length--;
+    pic->p_next = NULL;
+    return pic;
+}
+
+static void *FilterChainWorker( void *data )
+{
+    chained_filter_t *f = data;
+    filter_chain_t *chain = f->filter.owner.sys;
+
+    vlc_mutex_lock( &chain->pipeline.lock );
+    for( ;; )
+    {
+        mtime_t start = mdate();
+        while( f->queue == NULL && !chain->pipeline.stopping )
+            vlc_cond_wait( &chain->pipeline.wait, &chain->pipeline.lock );
+        f->time_starved += mdate() - start;
+
+        if( chain->pipeline.stopping )
+            break;
+
+        picture_t *pic = FilterChainDequeue( f );
+        vlc_cond_broadcast( &chain->pipeline.wait );
+        vlc_mutex_unlock( &chain->pipeline.lock );
+
+        vlc_mutex_lock( &f->lock );
+        pic = FilterRun( f, pic );
+        vlc_mutex_unlock( &f->lock );
+
+        vlc_mutex_lock( &chain->pipeline.lock );
+        start = mdate();
+
+        /* A filter can output several pictures at once (e.g. deinterlace) */
+        chain->pipeline.in_flight--;
+        for( picture_t *p = pic; p != NULL; p = p->p_next )
+            chain->pipeline.in_flight++;
+
+        bool output = false;
+        while( pic != NULL )
+        {
+            picture_t *next = pic->p_next;
+            chained_filter_t *down = f->next;
+
+            if( down != NULL )
+            {
+                while( down->queue_length >= FILTER_CHAIN_QUEUE_LENGTH
+                    && !chain->pipeline.stopping )
+                    vlc_cond_wait( &chain->pipeline.wait,
+                                   &chain->pipeline.lock );
+                if( chain->pipeline.stopping )
+                {
+                    FilterDeletePictures( pic );
+                    break;
+                }
+                FilterChainEnqueue( down, pic );
+            }
+            else
+            {
+                pic->p_next = NULL;
+                *chain->pipeline.output_tail = pic;
+                chain->pipeline.output_tail = &pic->p_next;
+                output = true;
+            }
+            vlc_cond_broadcast( &chain->pipeline.wait );
+            pic = next;
+        }
+        f->time_blocked += mdate() - start;
+
+        if( output && chain->pipeline.wake != NULL )
+        {
+            vlc_mutex_unlock( &chain->pipeline.lock );
+            chain->pipeline.wake( chain->pipeline.opaque );
+            vlc_mutex_lock( &chain->pipeline.lock );
+        }
+    }
+    vlc_mutex_unlock( &chain->pipeline.lock );
+    return NULL;
+}
+
+static int FilterChainPipelineStart( filter_chain_t *chain )
+{
+    assert( !chain->pipeline.running );
+
+    /* Set before the threads start, as it changes the picture allocator */
+    chain->pipeline.running = true;
+
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+        if( vlc_clone( &f->thread, FilterChainWorker, f,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            vlc_mutex_lock( &chain->pipeline.lock );
+            chain->pipeline.stopping = true;
+            vlc_cond_broadcast( &chain->pipeline.wait );
+            vlc_mutex_unlock( &chain->pipeline.lock );
+
+            for( chained_filter_t *g = chain->first; g != f; g = g->next )
+                vlc_join( g->thread, NULL );
+
+            chain->pipeline.stopping = false;
+            chain->pipeline.running = false;
+            return VLC_EGENERIC;
+        }
+    return VLC_SUCCESS;
+}
+
+/** Stops the filter threads, and discards the pictures in flight */
+static void FilterChainPipelineStop( filter_chain_t *chain )
+{
+    if( !chain->pipeline.running )
+        return;
+
+    vlc_mutex_lock( &chain->pipeline.lock );
+    chain->pipeline.stopping = true;
+    vlc_cond_broadcast( &chain->pipeline.wait );
+    vlc_mutex_unlock( &chain->pipeline.lock );
+
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+        vlc_join( f->thread, NULL );
+
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+    {
+        FilterDeletePictures( f->queue );
+        f->queue = NULL;
+        f->queue_tail = &f->queue;
+        f->queue_length = 0;
+    }
+    FilterDeletePictures( chain->pipeline.output );
+    chain->pipeline.output = NULL;
+    chain->pipeline.output_tail = &chain->pipeline.output;
+    chain->pipeline.in_flight = 0;
+    chain->pipeline.copies_count = 0;
+
+    chain->pipeline.stopping = false;
+    chain->pipeline.running = false;
+}
+
+/** Tells whether an output picture is a private picture of the last filter
+ * (called with the pipeline lock held) */
+static bool FilterChainPipelineIsCopy( filter_chain_t *chain, picture_t *pic )
+{
+    if( !chain->pipeline.owner_alloc )
+        return true;
+
+    for( unsigned i = 0; i < chain->pipeline.copies_count; i++ )
+        if( chain->pipeline.copies[i] == pic )
+        {
+            chain->pipeline.copies[i] =
+                chain->pipeline.copies[--chain->pipeline.copies_count];
+            return true;
+        }
+    return false;
+}
+
+static picture_t *FilterChainPipelineOutput( filter_chain_t *chain )
+{
+    bool to_copy = false;
+
+    vlc_mutex_lock( &chain->pipeline.lock );
+    picture_t *pic = chain->pipeline.output;
+    if( pic != NULL )
+    {
+        chain->pipeline.output = pic->p_next;
+        if( chain->pipeline.output == NULL )
+            chain->pipeline.output_tail = &chain->pipeline.output;
+        pic->p_next = NULL;
+        chain->pipeline.in_flight--;
+        to_copy = FilterChainPipelineIsCopy( chain, pic );
+    }
+    vlc_mutex_unlock( &chain->pipeline.lock );
+
+    if( !to_copy || chain->owner.video.buffer_new == NULL )
+        return pic;
+
+    /* The last filter output a private picture, as the owner allocator is
+     * not usable from the filter threads or had no free pictures. Copy to
+     * an owner picture. */
+    chained_filter_t *last = chain->last;
+    filter_t *filter = &last->filter;
+
+    vlc_mutex_lock( &last->lock );
+    /* XXX ugly, see filter_chain_VideoBufferNew() */
+    filter->owner.sys = chain->owner.sys;
+    picture_t *copy = chain->owner.video.buffer_new( filter );
+    filter->owner.sys = chain;
+    vlc_mutex_unlock( &last->lock );
+
+    if( copy != NULL )
+        picture_Copy( copy, pic );
+    else
+        msg_Warn( filter, "dropping pictures" );
+    picture_Release( pic );
+    return copy;
+}
+
+static picture_t *FilterChainPipelineFilter( filter_chain_t *chain,
+                                             picture_t *pic )
+{
+    if( pic != NULL )
+    {
+        chained_filter_t *first = chain->first;
+
+        vlc_mutex_lock( &chain->pipeline.lock );
+        while( first->queue_length >= FILTER_CHAIN_QUEUE_LENGTH )
+            vlc_cond_wait( &chain->pipeline.wait, &chain->pipeline.lock );
+        FilterChainEnqueue( first, pic );
+        chain->pipeline.in_flight++;
+        vlc_cond_broadcast( &chain->pipeline.wait );
+        vlc_mutex_unlock( &chain->pipeline.lock );
+    }
+    return FilterChainPipelineOutput( chain );
+}
+
+void filter_chain_EnablePipeline( filter_chain_t *chain, bool owner_alloc,
+                                  void (*wake)( void * ), void *opaque )
+{
+    FilterChainPipelineStop( chain );
+    chain->pipeline.enabled = true;
+    chain->pipeline.owner_alloc = owner_alloc;
+    chain->pipeline.wake = wake;
+    chain->pipeline.opaque = opaque;
+}
+
+bool filter_chain_IsPipelineBusy( filter_chain_t *chain )
+{
+    if( !chain->pipeline.running )
+        return false;
+
+    vlc_mutex_lock( &chain->pipeline.lock );
+    bool busy = chain->pipeline.in_flight > 0;
+    vlc_mutex_unlock( &chain->pipeline.lock );
+    return busy;
+}
+
 picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
 {
+    if( p_chain->pipeline.enabled && p_chain->first != NULL )
+    {
+        if( p_chain->pipeline.running
+         || FilterChainPipelineStart( p_chain ) == VLC_SUCCESS )
+            return FilterChainPipelineFilter( p_chain, p_pic );
+
+        vlc_object_t *obj = p_chain->callbacks.sys;
+        msg_Err( obj, "cannot start filter threads" );
+        p_chain->pipeline.enabled = false;
+    }
+
     if( p_pic )
     {
         p_pic = FilterChainVideoFilter( p_chain->first, p_pic );
@@ -413,6 +790,9 @@ picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
 
 void filter_chain_VideoFlush( filter_chain_t *p_chain )
 {
+    /* The filter threads are restarted on the next picture */
+    FilterChainPipelineStop( p_chain );
+
     for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
@@ -479,7 +859,12 @@ int filter_chain_MouseFilter( filter_chain_t *p_chain, vlc_mouse_t *p_dst, const
             vlc_mouse_t filtered;
 
             *p_mouse = current;
-            if( p_filter->pf_video_mouse( p_filter, &filtered, &old, &current ) )
+            /* Serialize with the filter thread in pipelined mode */
+            vlc_mutex_lock( &f->lock );
+            int ret = p_filter->pf_video_mouse( p_filter, &filtered, &old,
+                                                &current );
+            vlc_mutex_unlock( &f->lock );
+            if( ret )
                 return VLC_EGENERIC;
             current = filtered;
         }
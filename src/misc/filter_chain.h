@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * filter_chain.h: filter chain internals
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_FILTER_CHAIN_H
+# define LIBVLC_FILTER_CHAIN_H 1
+
+# include <vlc_filter.h>
+
+/**
+ * Enable pipelined execution of a video filter chain.
+ *
+ * Each filter then runs on its own thread, so that successive pictures are
+ * processed by the different filters in parallel. filter_chain_VideoFilter()
+ * queues the input picture, waiting only if the first filter is busy, and
+ * returns the next output picture if one is ready. Output pictures come out
+ * in order, after the latency of the pipeline; call
+ * filter_chain_VideoFilter() with a NULL picture to collect them.
+ * filter_chain_VideoFlush() discards the pictures in flight.
+ *
+ * If the owner picture allocator can be called from any thread, and the
+ * owner pictures remain valid until the chain is flushed, the last filter
+ * allocates its output pictures from the owner directly. Otherwise they are
+ * copied to owner pictures on the calling thread.
+ *
+ * \param chain video filter chain
+ * \param owner_alloc whether the owner allocator is thread-safe
+ * \param wake callback invoked from a filter thread when an output picture
+ *             becomes ready (can be NULL)
+ * \param opaque data for the callback
+ */
+void filter_chain_EnablePipeline(filter_chain_t *chain, bool owner_alloc,
+                                 void (*wake)(void *), void *opaque);
+
+/**
+ * Tells whether a pipelined video filter chain is processing pictures.
+ *
+ * \return true if pictures are in flight or waiting at the chain output,
+ *         false otherwise (and always false if pipelining is not enabled)
+ */
+bool filter_chain_IsPipelineBusy(filter_chain_t *chain);
+
+#endif
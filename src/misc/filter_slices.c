@@ -0,0 +1,187 @@
+/*****************************************************************************
+ * filter_slices.c : slice-parallel video filter processing
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include "../libvlc.h"
+
+/* Slices thinner than this are not worth the synchronization */
+#define SLICE_MIN_LINES 32
+#define SLICE_MAX_THREADS 15
+
+struct vlc_slices
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait_work;
+    vlc_cond_t  wait_done;
+    bool        busy;
+    bool        closing;
+
+    /* Current job */
+    filter_slice_cb_t cb;
+    void       *opaque;
+    unsigned    count; /**< total number of slices */
+    unsigned    next; /**< next slice to be processed */
+    unsigned    done; /**< number of processed slices */
+
+    unsigned    thread_count; /**< number of running workers */
+    unsigned    thread_max;
+    vlc_thread_t threads[SLICE_MAX_THREADS];
+};
+
+/**
+ * Processes slices of the current job until there are none left.
+ * The pool lock must be held.
+ */
+static void SlicesRun(vlc_slices_t *pool)
+{
+    while (pool->next < pool->count)
+    {
+        unsigned slice = pool->next++;
+
+        vlc_mutex_unlock(&pool->lock);
+        pool->cb(pool->opaque, slice, pool->count);
+        vlc_mutex_lock(&pool->lock);
+
+        if (++pool->done == pool->count)
+            vlc_cond_signal(&pool->wait_done);
+    }
+}
+
+static void *SlicesThread(void *data)
+{
+    vlc_slices_t *pool = data;
+
+    vlc_mutex_lock(&pool->lock);
+    while (!pool->closing)
+    {
+        if (pool->next < pool->count)
+            SlicesRun(pool);
+        else
+            vlc_cond_wait(&pool->wait_work, &pool->lock);
+    }
+    vlc_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+vlc_slices_t *vlc_slices_New(void)
+{
+    unsigned cpus = vlc_GetCPUCount();
+    if (cpus <= 1)
+        return NULL; /* run everything on the calling thread */
+
+    vlc_slices_t *pool = malloc(sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init(&pool->lock);
+    vlc_cond_init(&pool->wait_work);
+    vlc_cond_init(&pool->wait_done);
+    pool->busy = false;
+    pool->closing = false;
+    pool->count = pool->next = pool->done = 0;
+    pool->thread_count = 0;
+    pool->thread_max = __MIN(cpus - 1, SLICE_MAX_THREADS);
+    return pool;
+}
+
+void vlc_slices_Delete(vlc_slices_t *pool)
+{
+    if (pool == NULL)
+        return;
+
+    vlc_mutex_lock(&pool->lock);
+    assert(!pool->busy);
+    pool->closing = true;
+    vlc_cond_broadcast(&pool->wait_work);
+    vlc_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->thread_count; i++)
+        vlc_join(pool->threads[i], NULL);
+
+    vlc_cond_destroy(&pool->wait_done);
+    vlc_cond_destroy(&pool->wait_work);
+    vlc_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+void filter_ProcessSlices(filter_t *filter, unsigned lines,
+                          filter_slice_cb_t cb, void *opaque)
+{
+    vlc_slices_t *pool = libvlc_priv(filter->obj.libvlc)->slices;
+    unsigned count = lines / SLICE_MIN_LINES;
+
+    if (pool == NULL || count <= 1)
+        goto serial;
+
+    vlc_mutex_lock(&pool->lock);
+    if (pool->busy)
+    {   /* Another filter (e.g. from a pipelined chain) owns the workers */
+        vlc_mutex_unlock(&pool->lock);
+        goto serial;
+    }
+
+    /* Workers are only started once a filter actually needs them */
+    while (pool->thread_count < pool->thread_max)
+    {
+        if (vlc_clone(&pool->threads[pool->thread_count], SlicesThread, pool,
+                      VLC_THREAD_PRIORITY_VIDEO))
+        {
+            pool->thread_max = pool->thread_count;
+            break;
+        }
+        pool->thread_count++;
+    }
+
+    count = __MIN(count, pool->thread_count + 1);
+    if (count <= 1)
+    {
+        vlc_mutex_unlock(&pool->lock);
+        goto serial;
+    }
+
+    pool->busy = true;
+    pool->cb = cb;
+    pool->opaque = opaque;
+    pool->count = count;
+    pool->next = 0;
+    pool->done = 0;
+    vlc_cond_broadcast(&pool->wait_work);
+
+    /* The calling thread processes slices too */
+    SlicesRun(pool);
+    while (pool->done < pool->count)
+        vlc_cond_wait(&pool->wait_done, &pool->lock);
+
+    pool->count = pool->next = pool->done = 0;
+    pool->busy = false;
+    vlc_mutex_unlock(&pool->lock);
+    return;
+
+serial:
+    cb(opaque, 0, 1);
+}
@@ -147,7 +147,7 @@ subpicture_t *subpicture_NewFromPicture( vlc_object_t *p_obj,
     return p_subpic;
 }
 
-void subpicture_Update( subpicture_t *p_subpicture,
+bool subpicture_Update( subpicture_t *p_subpicture,
                         const video_format_t *p_fmt_src,
                         const video_format_t *p_fmt_dst,
                         mtime_t i_ts )
@@ -156,14 +156,14 @@ void subpicture_Update( subpicture_t *p_subpicture,
     subpicture_private_t *p_private = p_subpicture->p_private;
 
     if( !p_upd->pf_validate )
-        return;
+        return false;
     if( !p_upd->pf_validate( p_subpicture,
                           !video_format_IsSimilar( p_fmt_src,
                                                    &p_private->src ), p_fmt_src,
                           !video_format_IsSimilar( p_fmt_dst,
                                                    &p_private->dst ), p_fmt_dst,
                           i_ts ) )
-        return;
+        return false;
 
     subpicture_region_ChainDelete( p_subpicture->p_region );
     p_subpicture->p_region = NULL;
@@ -175,6 +175,7 @@ void subpicture_Update( subpicture_t *p_subpicture,
 
     video_format_Copy( &p_private->src, p_fmt_src );
     video_format_Copy( &p_private->dst, p_fmt_dst );
+    return true;
 }
 
 
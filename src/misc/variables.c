@@ -28,9 +28,6 @@
 # include "config.h"
 #endif
 
-#ifdef HAVE_SEARCH_H
-# include <search.h>
-#endif
 #include <assert.h>
 #include <math.h>
 #include <limits.h>
@@ -71,7 +68,8 @@ typedef struct callback_table_t
  */
 struct variable_t
 {
-    char *       psz_name; /**< The variable unique name (must be first) */
+    char *       psz_name; /**< The variable unique name */
+    uint32_t     i_hash;   /**< Hash of the name */
 
     /** The variable's exported value */
     vlc_value_t  val;
@@ -142,23 +140,98 @@ int_ops    = { CmpInt,     DupDummy,  FreeDummy,  },
 string_ops = { CmpString,  DupString, FreeString, },
 coords_ops = { NULL,       DupDummy,  FreeDummy,  };
 
-static int varcmp( const void *a, const void *b )
+/* The variables of an object are stored in an open addressing hash table,
+ * with linear probing. Its size is a power of two. */
+static uint32_t VarHash( const char *psz_name )
+{
+    /* FNV-1a */
+    uint32_t i_hash = 2166136261u;
+
+    while( *psz_name )
+    {
+        i_hash ^= (unsigned char)*(psz_name++);
+        i_hash *= 16777619u;
+    }
+    return i_hash;
+}
+
+/* Returns the slot of the variable, or the empty slot where it belongs */
+static variable_t **VarSlot( vlc_object_internals_t *priv,
+                             const char *psz_name, uint32_t i_hash )
 {
-    const variable_t *va = a, *vb = b;
+    const unsigned mask = priv->var_size - 1;
+
+    assert( priv->var_count < priv->var_size );
+    for( unsigned i = i_hash & mask;; i = (i + 1) & mask )
+    {
+        variable_t *var = priv->var_table[i];
 
-    /* psz_name must be first */
-    assert( va == (const void *)&va->psz_name );
-    return strcmp( va->psz_name, vb->psz_name );
+        if( var == NULL
+         || ( var->i_hash == i_hash && !strcmp( var->psz_name, psz_name ) ) )
+            return &priv->var_table[i];
+    }
+}
+
+static int VarInsert( vlc_object_internals_t *priv, variable_t *var )
+{
+    /* Keep the load factor below 3/4 */
+    if( (priv->var_count + 1) * 4 > priv->var_size * 3 )
+    {
+        variable_t **old_table = priv->var_table;
+        unsigned old_size = priv->var_size;
+        unsigned size = old_size ? old_size * 2 : 16;
+
+        variable_t **table = calloc( size, sizeof( *table ) );
+        if( unlikely(table == NULL) )
+            return VLC_ENOMEM;
+
+        priv->var_table = table;
+        priv->var_size = size;
+        for( unsigned i = 0; i < old_size; i++ )
+            if( old_table[i] != NULL )
+                *VarSlot( priv, old_table[i]->psz_name,
+                          old_table[i]->i_hash ) = old_table[i];
+        free( old_table );
+    }
+
+    *VarSlot( priv, var->psz_name, var->i_hash ) = var;
+    priv->var_count++;
+    return VLC_SUCCESS;
+}
+
+static void VarRemove( vlc_object_internals_t *priv, variable_t *var )
+{
+    const unsigned mask = priv->var_size - 1;
+    unsigned i = var->i_hash & mask;
+
+    while( priv->var_table[i] != var )
+        i = (i + 1) & mask;
+
+    /* Shift back the next entries of the run unless that would move them
+     * before their own hash slot, so that lookups need no tombstones */
+    for( unsigned j = (i + 1) & mask; priv->var_table[j] != NULL;
+         j = (j + 1) & mask )
+    {
+        unsigned home = priv->var_table[j]->i_hash & mask;
+
+        if( (j > i) ? (home <= i || home > j) : (home <= i && home > j) )
+        {
+            priv->var_table[i] = priv->var_table[j];
+            i = j;
+        }
+    }
+    priv->var_table[i] = NULL;
+    priv->var_count--;
 }
 
 static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
-    variable_t **pp_var;
 
     vlc_mutex_lock(&priv->var_lock);
-    pp_var = tfind( &psz_name, &priv->var_root, varcmp );
-    return (pp_var != NULL) ? *pp_var : NULL;
+    if( priv->var_count == 0 )
+        return NULL;
+    return *VarSlot( priv, psz_name, VarHash( psz_name ) );
 }
 
 static void Destroy( variable_t *p_var )
@@ -306,9 +379,9 @@ static void TriggerListCallback(vlc_object_t *obj, variable_t *var,
 /**
  * Initialize a vlc variable
  *
- * We hash the given string and insert it into the sorted list. The insertion
- * may require slow memory copies, but think about what we gain in the log(n)
- * lookup phase when setting/getting the variable value!
+ * We hash the given string and insert it into the hash table of the object,
+ * so that getting/setting the variable value does not compare names but
+ * on collisions.
  *
  * \param p_this The object in which to create the variable
  * \param psz_name The name of the variable
@@ -324,6 +397,7 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
         return VLC_ENOMEM;
 
     p_var->psz_name = strdup( psz_name );
+    p_var->i_hash = VarHash( psz_name );
     p_var->psz_text = NULL;
 
     p_var->i_type = i_type & ~VLC_VAR_DOINHERIT;
@@ -393,16 +467,19 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
     }
 
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
-    variable_t **pp_var, *p_oldvar;
+    variable_t *p_oldvar = NULL;
     int ret = VLC_SUCCESS;
 
     vlc_mutex_lock( &p_priv->var_lock );
 
-    pp_var = tsearch( p_var, &p_priv->var_root, varcmp );
-    if( unlikely(pp_var == NULL) )
-        ret = VLC_ENOMEM;
-    else if( (p_oldvar = *pp_var) == p_var ) /* Variable create */
-        p_var = NULL; /* Variable created */
+    if( p_priv->var_count > 0 )
+        p_oldvar = *VarSlot( p_priv, p_var->psz_name, p_var->i_hash );
+    if( p_oldvar == NULL ) /* Variable create */
+    {
+        ret = VarInsert( p_priv, p_var );
+        if( likely(ret == VLC_SUCCESS) )
+            p_var = NULL; /* Variable created */
+    }
     else /* Variable already exists */
     {
         assert (((i_type ^ p_oldvar->i_type) & VLC_VAR_CLASS) == 0);
@@ -444,7 +521,7 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
     WaitUnused( p_this, p_var );
 
     if( --p_var->i_usage == 0 )
-        tdelete( p_var, &p_priv->var_root, varcmp );
+        VarRemove( p_priv, p_var );
     else
         p_var = NULL;
     vlc_mutex_unlock( &p_priv->var_lock );
@@ -453,17 +530,17 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
         Destroy( p_var );
 }
 
-static void CleanupVar( void *var )
-{
-    Destroy( var );
-}
-
 void var_DestroyAll( vlc_object_t *obj )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
 
-    tdestroy( priv->var_root, CleanupVar );
-    priv->var_root = NULL;
+    for( unsigned i = 0; i < priv->var_size; i++ )
+        if( priv->var_table[i] != NULL )
+            Destroy( priv->var_table[i] );
+    free( priv->var_table );
+    priv->var_table = NULL;
+    priv->var_count = 0;
+    priv->var_size = 0;
 }
 
 #undef var_Change
@@ -1382,13 +1459,15 @@ void var_FreeList( vlc_value_t *p_val, vlc_value_t *p_val2 )
     }
 }
 
-static void DumpVariable(const void *data, const VISIT which, const int depth)
+static int DumpVariableCmp(const void *a, const void *b)
 {
-    if (which != postorder && which != leaf)
-        return;
-    (void) depth;
+    const variable_t *const *va = a, *const *vb = b;
+
+    return strcmp((*va)->psz_name, (*vb)->psz_name);
+}
 
-    const variable_t *var = *(const variable_t **)data;
+static void DumpVariable(const variable_t *var)
+{
     const char *typename = "unknown";
 
     switch (var->i_type & VLC_VAR_TYPE)
@@ -1443,10 +1522,27 @@ static void DumpVariable(const void *data, const VISIT which, const int depth)
 
 void DumpVariables(vlc_object_t *obj)
 {
-    vlc_mutex_lock(&vlc_internals(obj)->var_lock);
-    if (vlc_internals(obj)->var_root == NULL)
+    vlc_object_internals_t *priv = vlc_internals(obj);
+
+    vlc_mutex_lock(&priv->var_lock);
+    if (priv->var_count == 0)
         puts(" `-o No variables");
     else
-        twalk(vlc_internals(obj)->var_root, DumpVariable);
-    vlc_mutex_unlock(&vlc_internals(obj)->var_lock);
+    {
+        /* Sort by name, as the hash table order means nothing */
+        variable_t **vars = malloc(priv->var_count * sizeof (*vars));
+        unsigned count = 0;
+
+        if (vars != NULL)
+        {
+            for (unsigned i = 0; i < priv->var_size; i++)
+                if (priv->var_table[i] != NULL)
+                    vars[count++] = priv->var_table[i];
+            qsort(vars, count, sizeof (*vars), DumpVariableCmp);
+            for (unsigned i = 0; i < count; i++)
+                DumpVariable(vars[i]);
+            free(vars);
+        }
+    }
+    vlc_mutex_unlock(&priv->var_lock);
 }
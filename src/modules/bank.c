@@ -45,12 +45,23 @@
 #include "config/configuration.h"
 #include "modules/modules.h"
 
+/** Modules with a given capability, sorted by decreasing score */
+typedef struct
+{
+    const char *name;
+    module_t  **list;
+    size_t      count;
+} module_cap_t;
+
 static struct
 {
     vlc_mutex_t lock;
     module_t *head;
+    module_cache_data_t *caches;
+    module_cap_t *caps;
+    size_t cap_count;
     unsigned usage;
-} modules = { VLC_STATIC_MUTEX, NULL, 0 };
+} modules = { VLC_STATIC_MUTEX, NULL, NULL, NULL, 0, 0 };
 
 /*****************************************************************************
  * Local prototypes
@@ -59,6 +70,8 @@ static struct
 static void AllocateAllPlugins (vlc_object_t *);
 #endif
 static module_t *module_InitStatic (vlc_plugin_cb);
+static void module_IndexCaps (void);
+static void module_FreeCaps (module_cap_t *, size_t);
 
 static void module_StoreBank (module_t *module)
 {
@@ -131,6 +144,9 @@ void module_InitBank (void)
 void module_EndBank (bool b_plugins)
 {
     module_t *head = NULL;
+    module_cache_data_t *caches = NULL;
+    module_cap_t *caps = NULL;
+    size_t cap_count = 0;
 
     /* If plugins were _not_ loaded, then the caller still has the bank lock
      * from module_InitBank(). */
@@ -145,9 +161,17 @@ void module_EndBank (bool b_plugins)
         config_UnsortConfig ();
         head = modules.head;
         modules.head = NULL;
+        caches = modules.caches;
+        modules.caches = NULL;
+        caps = modules.caps;
+        cap_count = modules.cap_count;
+        modules.caps = NULL;
+        modules.cap_count = 0;
     }
     vlc_mutex_unlock (&modules.lock);
 
+    module_FreeCaps (caps, cap_count);
+
     while (head != NULL)
     {
         module_t *module = head;
@@ -162,6 +186,19 @@ void module_EndBank (bool b_plugins)
 #endif
         vlc_module_destroy (module);
     }
+
+#ifdef HAVE_DYNAMIC_PLUGINS
+    /* The cached modules are gone, their cache data can be released */
+    while (caches != NULL)
+    {
+        module_cache_data_t *data = caches;
+
+        caches = data->next;
+        CacheUnload (data);
+    }
+#else
+    assert (caches == NULL);
+#endif
 }
 
 #undef module_LoadPlugins
@@ -185,6 +222,7 @@ size_t module_LoadPlugins (vlc_object_t *obj)
 #endif
         config_UnsortConfig ();
         config_SortConfig ();
+        module_IndexCaps ();
     }
     vlc_mutex_unlock (&modules.lock);
 
@@ -247,6 +285,97 @@ static int modulecmp (const void *a, const void *b)
     return (*mb)->i_score - (*ma)->i_score;
 }
 
+typedef struct
+{
+    module_t *module;
+    size_t    rank; /* position in the bank */
+} module_rank_t;
+
+static int modulecapcmp (const void *a, const void *b)
+{
+    const module_rank_t *ma = a, *mb = b;
+    int ret = strcmp (module_get_capability (ma->module),
+                      module_get_capability (mb->module));
+    if (ret == 0)
+        ret = mb->module->i_score - ma->module->i_score;
+    if (ret == 0) /* keep the bank order for equal scores */
+        ret = (ma->rank > mb->rank) - (ma->rank < mb->rank);
+    return ret;
+}
+
+static int capcmp (const void *key, const void *cap)
+{
+    return strcmp (key, ((const module_cap_t *)cap)->name);
+}
+
+static void module_FreeCaps (module_cap_t *caps, size_t count)
+{
+    if (count > 0)
+        free (caps[0].list);
+    free (caps);
+}
+
+/**
+ * Indexes the modules of the bank by capability, so that module_list_cap()
+ * does not need to scan and sort the whole bank for each module load.
+ * The bank is read-only once the plugins are loaded.
+ */
+static void module_IndexCaps (void)
+{
+    module_FreeCaps (modules.caps, modules.cap_count);
+    modules.caps = NULL;
+    modules.cap_count = 0;
+
+    size_t n;
+    module_t **tab = module_list_get (&n);
+    module_rank_t *ranks = malloc (n * sizeof (*ranks));
+
+    if (unlikely(tab == NULL || ranks == NULL) || n == 0)
+        goto out;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        ranks[i].module = tab[i];
+        ranks[i].rank = i;
+    }
+    qsort (ranks, n, sizeof (*ranks), modulecapcmp);
+
+    /* Reuse the flat module table, in capability and score order */
+    size_t cap_count = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        tab[i] = ranks[i].module;
+        if (i == 0 || strcmp (module_get_capability (tab[i]),
+                              module_get_capability (tab[i - 1])))
+            cap_count++;
+    }
+
+    module_cap_t *caps = malloc (cap_count * sizeof (*caps));
+    if (unlikely(caps == NULL))
+        goto out;
+
+    module_cap_t *cap = NULL;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (cap == NULL || strcmp (module_get_capability (tab[i]), cap->name))
+        {
+            cap = (cap != NULL) ? cap + 1 : caps;
+            cap->name = module_get_capability (tab[i]);
+            cap->list = tab + i;
+            cap->count = 0;
+        }
+        cap->count++;
+    }
+    assert (cap == caps + cap_count - 1);
+
+    modules.caps = caps;
+    modules.cap_count = cap_count;
+    tab = NULL; /* now owned by the index */
+out:
+    free (ranks);
+    module_list_free (tab);
+}
+
 /**
  * Builds a sorted list of all VLC modules with a given capability.
  * The list is sorted from the highest module score to the lowest.
@@ -257,11 +386,28 @@ static int modulecmp (const void *a, const void *b)
  */
 ssize_t module_list_cap (module_t ***restrict list, const char *cap)
 {
-    /* TODO: This is quite inefficient. List should be sorted by capability. */
     ssize_t n = 0;
 
     assert (list != NULL);
 
+    if (modules.caps != NULL)
+    {   /* Copy the list from the index */
+        const module_cap_t *entry = bsearch (cap, modules.caps,
+                                             modules.cap_count,
+                                             sizeof (*modules.caps), capcmp);
+        if (entry != NULL)
+            n = entry->count;
+
+        module_t **tab = malloc (sizeof (*tab) * n);
+        *list = tab;
+        if (unlikely(tab == NULL))
+            return -1;
+        if (n > 0)
+            memcpy (tab, entry->list, sizeof (*tab) * n);
+        return n;
+    }
+
+    /* The index is not built until the plugins are loaded */
     for (module_t *mod = modules.head; mod != NULL; mod = mod->next)
     {
          if (module_provides (mod, cap))
@@ -373,12 +519,13 @@ static void AllocatePluginPath (vlc_object_t *p_this, const char *path,
 {
     module_bank_t bank;
     module_cache_t *cache = NULL;
+    module_cache_data_t *data = NULL;
     size_t count = 0;
 
     switch( mode )
     {
         case CACHE_USE:
-            count = CacheLoad( p_this, path, &cache );
+            count = CacheLoad( p_this, path, &cache, &data );
             break;
         case CACHE_RESET:
             CacheDelete( p_this, path );
@@ -403,18 +550,32 @@ static void AllocatePluginPath (vlc_object_t *p_this, const char *path,
     switch( mode )
     {
         case CACHE_USE:
+        {
+            bool used = false;
+
             /* Discard unmatched cache entries */
             for( size_t i = 0; i < count; i++ )
             {
                 if (cache[i].p_module != NULL)
                    vlc_module_destroy (cache[i].p_module);
-                free (cache[i].path);
+                else
+                   used = true;
             }
             free( cache );
+
+            /* Keep the cache data as long as modules point to it */
+            if (used)
+            {
+                data->next = modules.caches;
+                modules.caches = data;
+            }
+            else if (data != NULL)
+                CacheUnload (data);
             for (size_t i = 0; i < bank.i_cache; i++)
                 free (bank.cache[i].path);
             free (bank.cache);
             break;
+        }
         case CACHE_RESET:
             CacheSave (p_this, path, bank.cache, bank.i_cache);
         case CACHE_IGNORE:
@@ -34,7 +34,11 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <assert.h>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "libvlc.h"
@@ -55,12 +59,14 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 23
+#define CACHE_SUBVERSION_NUM 24
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
 /* Magic for the cache filename */
 #define CACHE_STRING "cache "PACKAGE_NAME" "PACKAGE_VERSION
+/* Sanity limit for the cache file size */
+#define CACHE_MAX_SIZE (64 << 20)
 
 
 void CacheDelete( vlc_object_t *obj, const char *dir )
@@ -76,8 +82,28 @@ void CacheDelete( vlc_object_t *obj, const char *dir )
     free( path );
 }
 
+/*
+ * The cache file is mapped (or read at once) in memory, and used in place:
+ * the strings of the cached modules point into it, so that loading the cache
+ * does not allocate and copy each string.
+ */
+typedef struct
+{
+    const char *ptr;
+    const char *end;
+} cache_reader_t;
+
+static int CacheLoadBytes (void *p, size_t size, cache_reader_t *reader)
+{
+    if ((size_t)(reader->end - reader->ptr) < size)
+        return -1;
+    memcpy (p, reader->ptr, size);
+    reader->ptr += size;
+    return 0;
+}
+
 #define LOAD_IMMEDIATE(a) \
-    if (fread (&(a), sizeof (char), sizeof (a), file) != sizeof (a)) \
+    if (CacheLoadBytes (&(a), sizeof (a), reader)) \
         goto error
 #define LOAD_FLAG(a) \
     do { \
@@ -88,9 +114,9 @@ void CacheDelete( vlc_object_t *obj, const char *dir )
         (a) = b; \
     } while (0)
 
-static int CacheLoadString (char **p, FILE *file)
+static int CacheLoadString (char **p, cache_reader_t *reader)
 {
-    char *psz = NULL;
+    const char *psz = NULL;
     uint16_t size;
 
     LOAD_IMMEDIATE (size);
@@ -102,24 +128,21 @@ error:
 
     if (size > 0)
     {
-        psz = malloc (size+1);
-        if (unlikely(psz == NULL))
+        /* Non-empty strings are stored with their nul terminator */
+        if ((size_t)(reader->end - reader->ptr) <= size
+         || reader->ptr[size] != '\0')
             goto error;
-        if (fread (psz, 1, size, file) != size)
-        {
-            free (psz);
-            goto error;
-        }
-        psz[size] = '\0';
+        psz = reader->ptr;
+        reader->ptr += size + 1;
     }
-    *p = psz;
+    *p = (char *)psz;
     return 0;
 }
 
 #define LOAD_STRING(a) \
-    if (CacheLoadString (&(a), file)) goto error
+    if (CacheLoadString (&(a), reader)) goto error
 
-static int CacheLoadConfig (module_config_t *cfg, FILE *file)
+static int CacheLoadConfig (module_config_t *cfg, cache_reader_t *reader)
 {
     LOAD_IMMEDIATE (cfg->i_type);
     LOAD_IMMEDIATE (cfg->i_short);
@@ -137,6 +160,7 @@ static int CacheLoadConfig (module_config_t *cfg, FILE *file)
     if (IsConfigStringType (cfg->i_type))
     {
         LOAD_STRING (cfg->orig.psz);
+        /* The current value is owned by the item, unlike the other strings */
         if (cfg->orig.psz != NULL)
             cfg->value.psz = strdup (cfg->orig.psz);
         else
@@ -149,9 +173,8 @@ static int CacheLoadConfig (module_config_t *cfg, FILE *file)
         for (unsigned i = 0; i < cfg->list_count; i++)
         {
             LOAD_STRING (cfg->list.psz[i]);
-            if (cfg->list.psz[i] == NULL /* NULL -> empty string */
-             && (cfg->list.psz[i] = calloc (1, 1)) == NULL)
-                goto error;
+            if (cfg->list.psz[i] == NULL) /* NULL -> empty string */
+                cfg->list.psz[i] = (char *)"";
         }
     }
     else
@@ -172,9 +195,8 @@ static int CacheLoadConfig (module_config_t *cfg, FILE *file)
     for (unsigned i = 0; i < cfg->list_count; i++)
     {
         LOAD_STRING (cfg->list_text[i]);
-        if (cfg->list_text[i] == NULL /* NULL -> empty string */
-         && (cfg->list_text[i] = calloc (1, 1)) == NULL)
-            goto error;
+        if (cfg->list_text[i] == NULL) /* NULL -> empty string */
+            cfg->list_text[i] = (char *)"";
     }
 
     return 0;
@@ -182,7 +204,7 @@ error:
     return -1; /* FIXME: leaks */
 }
 
-static int CacheLoadModuleConfig (module_t *module, FILE *file)
+static int CacheLoadModuleConfig (module_t *module, cache_reader_t *reader)
 {
     uint16_t lines;
 
@@ -194,7 +216,7 @@ static int CacheLoadModuleConfig (module_t *module, FILE *file)
     /* Allocate memory */
     if (lines)
     {
-        module->p_config = malloc (lines * sizeof (module_config_t));
+        module->p_config = calloc (lines, sizeof (module_config_t));
         if (unlikely(module->p_config == NULL))
         {
             module->confsize = 0;
@@ -207,19 +229,21 @@ static int CacheLoadModuleConfig (module_t *module, FILE *file)
 
     /* Do the duplication job */
     for (size_t i = 0; i < lines; i++)
-        if (CacheLoadConfig (module->p_config + i, file))
+        if (CacheLoadConfig (module->p_config + i, reader))
             return -1;
     return 0;
 error:
     return -1; /* FIXME: leaks */
 }
 
-static module_t *CacheLoadModule (FILE *file)
+static module_t *CacheLoadModule (cache_reader_t *reader)
 {
     module_t *module = vlc_module_create (NULL);
     if (unlikely(module == NULL))
         return NULL;
 
+    module->b_cached = true;
+
     /* Load additional infos */
     LOAD_STRING(module->psz_shortname);
     LOAD_STRING(module->psz_longname);
@@ -241,7 +265,7 @@ static module_t *CacheLoadModule (FILE *file)
     LOAD_IMMEDIATE(module->b_unloadable);
 
     /* Config stuff */
-    if (CacheLoadModuleConfig (module, file) != VLC_SUCCESS)
+    if (CacheLoadModuleConfig (module, reader) != VLC_SUCCESS)
         goto error;
 
     LOAD_STRING(module->domain);
@@ -254,14 +278,19 @@ static module_t *CacheLoadModule (FILE *file)
     for (; submodules > 0; submodules--)
     {
         module_t *submodule = vlc_module_create (module);
+        if (unlikely(submodule == NULL))
+            goto error;
 
-        free (submodule->pp_shortcuts);
+        submodule->b_cached = true;
         LOAD_STRING(submodule->psz_shortname);
         LOAD_STRING(submodule->psz_longname);
 
         LOAD_IMMEDIATE(submodule->i_shortcuts);
         if (submodule->i_shortcuts > MODULE_SHORTCUT_MAX)
+        {
+            submodule->i_shortcuts = 0;
             goto error;
+        }
         else
         {
             submodule->pp_shortcuts =
@@ -280,6 +309,70 @@ error:
     return NULL;
 }
 
+static module_cache_data_t *CacheMap (vlc_object_t *obj, const char *path)
+{
+    module_cache_data_t *data = malloc (sizeof (*data));
+    if (unlikely(data == NULL))
+        return NULL;
+
+    int fd = vlc_open (path, O_RDONLY);
+    if (fd == -1)
+    {
+        msg_Warn (obj, "cannot read %s: %s", path, vlc_strerror_c(errno));
+        free (data);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat (fd, &st) || st.st_size <= 0 || st.st_size > CACHE_MAX_SIZE)
+        goto error;
+
+    data->next = NULL;
+    data->size = st.st_size;
+#ifdef HAVE_MMAP
+    data->base = mmap (NULL, data->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data->base == MAP_FAILED)
+        goto error;
+#else
+    char *buf = malloc (data->size);
+    if (unlikely(buf == NULL))
+        goto error;
+    for (size_t offset = 0; offset < data->size;)
+    {
+        ssize_t val = read (fd, buf + offset, data->size - offset);
+        if (val <= 0)
+        {
+            free (buf);
+            goto error;
+        }
+        offset += val;
+    }
+    data->base = buf;
+#endif
+    vlc_close (fd);
+    return data;
+
+error:
+    msg_Warn (obj, "cannot load %s", path);
+    vlc_close (fd);
+    free (data);
+    return NULL;
+}
+
+/**
+ * Releases the contents of a plugins cache file, once none of the modules
+ * loaded from it remain.
+ */
+void CacheUnload (module_cache_data_t *data)
+{
+#ifdef HAVE_MMAP
+    munmap ((void *)data->base, data->size);
+#else
+    free ((void *)data->base);
+#endif
+    free (data);
+}
+
 /**
  * Loads a plugins cache file.
  *
@@ -287,121 +380,124 @@ error:
  * will in turn be queried by AllocateAllPlugins() to see if it needs to
  * actually load the dynamically loadable module.
  * This allows us to only fully load plugins when they are actually used.
+ *
+ * The cached modules refer to the returned file contents (*datap), which
+ * must be released with CacheUnload() after those modules are destroyed.
  */
-size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
+size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r,
+                  module_cache_data_t **datap )
 {
     char *psz_filename;
-    FILE *file;
-    int i_size, i_read;
-    char p_cachestring[sizeof(CACHE_STRING)];
     int32_t i_marker;
+    uint32_t i_count;
 
     assert( dir != NULL );
 
     *r = NULL;
+    *datap = NULL;
     if( asprintf( &psz_filename, "%s"DIR_SEP CACHE_NAME, dir ) == -1 )
         return 0;
 
     msg_Dbg( p_this, "loading plugins cache file %s", psz_filename );
 
-    file = vlc_fopen( psz_filename, "rb" );
-    if( !file )
-    {
-        msg_Warn( p_this, "cannot read %s: %s", psz_filename,
-                  vlc_strerror_c(errno) );
-        free( psz_filename );
-        return 0;
-    }
+    module_cache_data_t *data = CacheMap( p_this, psz_filename );
     free( psz_filename );
+    if( data == NULL )
+        return 0;
+
+    cache_reader_t stream = {
+        .ptr = data->base,
+        .end = (const char *)data->base + data->size,
+    }, *reader = &stream;
 
     /* Check the file is a plugins cache */
-    i_size = sizeof(CACHE_STRING) - 1;
-    i_read = fread( p_cachestring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_cachestring, CACHE_STRING, i_size ) )
+    if( (size_t)(reader->end - reader->ptr) < strlen( CACHE_STRING ) ||
+        memcmp( reader->ptr, CACHE_STRING, strlen( CACHE_STRING ) ) )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
+        CacheUnload( data );
         return 0;
     }
+    reader->ptr += strlen( CACHE_STRING );
 
 #ifdef DISTRO_VERSION
     /* Check for distribution specific version */
-    char p_distrostring[sizeof( DISTRO_VERSION )];
-    i_size = sizeof( DISTRO_VERSION ) - 1;
-    i_read = fread( p_distrostring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_distrostring, DISTRO_VERSION, i_size ) )
+    if( (size_t)(reader->end - reader->ptr) < strlen( DISTRO_VERSION ) ||
+        memcmp( reader->ptr, DISTRO_VERSION, strlen( DISTRO_VERSION ) ) )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
+        CacheUnload( data );
         return 0;
     }
+    reader->ptr += strlen( DISTRO_VERSION );
 #endif
 
     /* Check sub-version number */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) || i_marker != CACHE_SUBVERSION_NUM )
+    if( CacheLoadBytes( &i_marker, sizeof( i_marker ), reader ) ||
+        i_marker != CACHE_SUBVERSION_NUM )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
                   "(corrupted header)" );
-        fclose( file );
+        CacheUnload( data );
         return 0;
     }
 
     /* Check header marker */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) ||
-        i_marker != ftell( file ) - (int)sizeof(i_marker) )
+    if( CacheLoadBytes( &i_marker, sizeof( i_marker ), reader ) ||
+        i_marker != reader->ptr - (const char *)data->base
+                    - (int)sizeof( i_marker ) ||
+        CacheLoadBytes( &i_count, sizeof( i_count ), reader ) ||
+        i_count > (size_t)(reader->end - reader->ptr) )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
                   "(corrupted header)" );
-        fclose( file );
+        CacheUnload( data );
         return 0;
     }
 
     module_cache_t *cache = NULL;
     size_t count = 0;
-    char *path = NULL;
 
-    for (;;)
+    if( i_count > 0 )
     {
-        module_t *module = CacheLoadModule (file);
-        if (module == NULL)
+        cache = malloc( i_count * sizeof( *cache ) );
+        if( unlikely(cache == NULL) )
         {
-            if (feof (file))
-                break;
-            goto error;
+            CacheUnload( data );
+            return 0;
         }
+    }
+
+    while( count < i_count )
+    {
+        module_t *module = CacheLoadModule (reader);
+        if (module == NULL)
+            goto error;
 
-        struct stat st;
+        module_cache_t *entry = cache + count;
 
         /* Load common info */
-        LOAD_STRING(path);
-        if (path == NULL)
-            goto error;
-        LOAD_IMMEDIATE(st.st_mtime);
-        LOAD_IMMEDIATE(st.st_size);
+        LOAD_STRING(entry->path);
+        LOAD_IMMEDIATE(entry->mtime);
+        LOAD_IMMEDIATE(entry->size);
+        entry->p_module = module;
+        count++;
 
-        CacheAdd (&cache, &count, path, &st, module);
-        free (path);
-        path = NULL;
-        /* TODO: deal with errors */
+        if (entry->path == NULL)
+            goto error;
     }
 
-    fclose( file );
-
     *r = cache;
+    *datap = data;
     return count;
 
 error:
-    free( path );
-    if (ferror (file))
-        msg_Err(p_this, "plugins cache read error: %s", vlc_strerror_c(errno));
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
 
-    /* TODO: cleanup */
-    fclose( file );
+    for( size_t i = 0; i < count; i++ )
+        vlc_module_destroy( cache[i].p_module );
+    free( cache );
+    CacheUnload( data );
     return 0;
 }
 
@@ -419,7 +515,8 @@ static int CacheSaveString (FILE *file, const char *str)
     uint16_t size = (str != NULL) ? strlen (str) : 0;
 
     SAVE_IMMEDIATE (size);
-    if (size != 0 && fwrite (str, 1, size, file) != size)
+    /* Include the nul terminator, so that the string can be used in place */
+    if (size != 0 && fwrite (str, 1, size + 1, file) != size + 1u)
     {
 error:
         return -1;
@@ -568,6 +665,11 @@ static int CacheSaveBank (FILE *file, const module_cache_t *cache,
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
+    /* Number of plugins */
+    uint32_t count = i_cache;
+    if (fwrite (&count, sizeof (count), 1, file) != 1)
+        goto error;
+
     for (unsigned i = 0; i < i_cache; i++)
     {
         module_t *module = cache[i].p_module;
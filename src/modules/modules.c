@@ -240,6 +240,8 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
 
     module_t *module = NULL;
     const bool b_force_backup = obj->obj.force; /* FIXME: remove this */
+    const mtime_t start = mdate();
+    unsigned probes = 0;
     va_list args;
 
     va_start(args, probe);
@@ -274,6 +276,7 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
                 continue;
             mods[i] = NULL; // only try each module once at most...
 
+            probes++;
             int ret = module_load (obj, cand, probe, args);
             switch (ret)
             {
@@ -296,6 +299,7 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
             if (cand == NULL || module_get_score (cand) <= 0)
                 continue;
 
+            probes++;
             int ret = module_load (obj, cand, probe, args);
             switch (ret)
             {
@@ -313,14 +317,17 @@ done:
     module_list_free (mods);
     free (var);
 
+    /* Report the probing cost, each input probes several capabilities */
+    const mtime_t duration = mdate() - start;
     if (module != NULL)
     {
-        msg_Dbg (obj, "using %s module \"%s\"", capability,
-                 module_get_object (module));
+        msg_Dbg (obj, "using %s module \"%s\" (%u probed in %"PRId64" us)",
+                 capability, module_get_object (module), probes, duration);
         vlc_object_set_name (obj, module_get_object (module));
     }
     else
-        msg_Dbg (obj, "no %s modules matched", capability);
+        msg_Dbg (obj, "no %s modules matched (%u probed in %"PRId64" us)",
+                 capability, probes, duration);
     return module;
 }
 
@@ -25,6 +25,7 @@
 # define LIBVLC_MODULES_H 1
 
 typedef struct module_cache_t module_cache_t;
+typedef struct module_cache_data_t module_cache_data_t;
 
 /*****************************************************************************
  * Module cache description structure
@@ -40,6 +41,16 @@ struct module_cache_t
     module_t *p_module;
 };
 
+/**
+ * Contents of a plugins cache file, referred to by the modules loaded from it
+ */
+struct module_cache_data_t
+{
+    module_cache_data_t *next;
+    const void *base;
+    size_t      size;
+};
+
 
 #define MODULE_SHORTCUT_MAX 20
 
@@ -78,6 +89,7 @@ struct module_t
 
     bool          b_loaded;        /* Set to true if the dll is loaded */
     bool b_unloadable;                        /**< Can we be dlclosed? */
+    bool b_cached;        /**< Strings belong to the plugins cache data */
 
     /* Callbacks */
     void *pf_activate;
@@ -122,7 +134,9 @@ void module_Unload (module_handle_t);
 /* Plugins cache */
 void   CacheMerge (vlc_object_t *, module_t *, module_t *);
 void   CacheDelete(vlc_object_t *, const char *);
-size_t CacheLoad  (vlc_object_t *, const char *, module_cache_t **);
+size_t CacheLoad  (vlc_object_t *, const char *, module_cache_t **,
+                   module_cache_data_t **);
+void   CacheUnload (module_cache_data_t *);
 
 struct stat;
 
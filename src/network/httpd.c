@@ -40,6 +40,8 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
 #include <string.h>
@@ -49,6 +51,10 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+# include <fcntl.h>
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -63,10 +69,48 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* maximum number of stream segments queued on a client at once */
+#define HTTPD_CL_MAXSEG 32
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+static int httpd_AppendData(httpd_stream_t *stream, const uint8_t *p_data,
+                            size_t i_data);
+static void httpd_HostWake(httpd_host_t *host);
+
+typedef struct httpd_worker_t httpd_worker_t;
+
+static void httpd_WorkerKill(httpd_worker_t *w, httpd_client_t *cl);
+static void httpd_WorkerWake(httpd_worker_t *w);
+
+/* each worker serves its own set of connections in its own thread */
+struct httpd_worker_t
+{
+    httpd_host_t *host;
+
+    vlc_thread_t thread;
+    vlc_mutex_t  lock; /* protects the client tables below */
+
+    int            i_client;
+    httpd_client_t **client;
 
-/* each host run in his own thread */
+    /* stream clients waiting for more data */
+    int            i_waiting;
+    httpd_client_t **waiting;
+
+    /* clients to destroy at the end of the current iteration */
+    int            i_dead;
+    httpd_client_t **dead;
+
+    mtime_t        i_next_expiry;
+
+#ifdef HAVE_SYS_EPOLL_H
+    int            epfd;
+    int            wakefd[2];
+    atomic_bool    b_woken;
+#endif
+};
+
+/* each host runs one or more workers */
 struct httpd_host_t
 {
     VLC_COMMON_MEMBERS
@@ -79,7 +123,7 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
+    /* protects the URL list and serializes all URL callbacks */
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
@@ -90,8 +134,10 @@ struct httpd_host_t
     int         i_url;
     httpd_url_t **url;
 
-    int            i_client;
-    httpd_client_t **client;
+    /* the first worker also accepts new connections */
+    unsigned        i_worker;
+    httpd_worker_t *worker;
+    unsigned        i_next_worker; /* only used by the first worker */
 
     /* TLS data */
     vlc_tls_creds_t *p_tls;
@@ -150,6 +196,10 @@ struct httpd_client_t
     bool    b_stream_mode;
     uint8_t i_state;
 
+    bool    b_waiting; /* in the worker waiting list */
+    bool    b_dead;    /* in the worker dead list */
+    short   i_events;  /* I/O events the worker polls for */
+
     mtime_t i_activity_date;
     mtime_t i_activity_timeout;
 
@@ -165,6 +215,11 @@ struct httpd_client_t
      */
     int64_t i_keyframe_wait_to_pass;
 
+    /* stream data shared with the other clients, sent before p_buffer */
+    block_t *p_seg[HTTPD_CL_MAXSEG];
+    unsigned i_seg;
+    size_t   i_seg_sent; /* bytes of the first segment already sent */
+
     /* */
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
@@ -611,17 +666,86 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* ring of shared data segments, oldest first */
+    int         i_buffer_size;      /* amount of data to keep */
     int64_t     i_buffer_pos;       /* absolute position from beginning */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
+    block_t     **pp_seg;
+    unsigned    i_seg_max;          /* ring capacity (power of two) */
+    unsigned    i_seg_first;
+    unsigned    i_seg;
+    int64_t     i_seg_size;         /* bytes in the ring */
 
     /* custom headers */
     size_t        i_http_headers;
     httpd_header * p_http_headers;
 };
 
+/* Reference-counted block of stream data, shared by all the clients */
+typedef struct
+{
+    block_t     self;
+    atomic_uint refs;
+    int64_t     i_pos;  /* absolute position of the first byte */
+} httpd_segment_t;
+
+static void httpd_SegmentRelease(block_t *block)
+{
+    httpd_segment_t *seg = (httpd_segment_t *)block;
+
+    if (atomic_fetch_sub(&seg->refs, 1) == 1)
+        free(seg);
+}
+
+static block_t *httpd_SegmentNew(const uint8_t *p_data, size_t i_data,
+                                 int64_t i_pos)
+{
+    httpd_segment_t *seg = malloc(sizeof (*seg) + i_data);
+    if (unlikely(seg == NULL))
+        return NULL;
+
+    block_Init(&seg->self, seg + 1, i_data);
+    seg->self.pf_release = httpd_SegmentRelease;
+    atomic_init(&seg->refs, 1);
+    seg->i_pos = i_pos;
+    memcpy(seg->self.p_buffer, p_data, i_data);
+    return &seg->self;
+}
+
+static block_t *httpd_SegmentHold(block_t *block)
+{
+    httpd_segment_t *seg = (httpd_segment_t *)block;
+
+    atomic_fetch_add(&seg->refs, 1);
+    return block;
+}
+
+static inline int64_t httpd_SegmentPos(const block_t *block)
+{
+    return ((const httpd_segment_t *)block)->i_pos;
+}
+
+static block_t *httpd_StreamSegment(const httpd_stream_t *stream, unsigned i)
+{
+    return stream->pp_seg[(stream->i_seg_first + i) & (stream->i_seg_max - 1)];
+}
+
+/* Finds the segment containing the given position */
+static unsigned httpd_StreamFind(const httpd_stream_t *stream, int64_t i_pos)
+{
+    unsigned lo = 0, hi = stream->i_seg;
+
+    while (hi - lo > 1) {
+        unsigned mid = (lo + hi) / 2;
+
+        if (httpd_SegmentPos(httpd_StreamSegment(stream, mid)) <= i_pos)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -632,44 +756,50 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
+        assert(cl->i_seg == 0);
+        vlc_mutex_lock(&stream->lock);
 
-        if (answer->i_body_offset >= stream->i_buffer_pos)
+        if (answer->i_body_offset >= stream->i_buffer_pos) {
+            vlc_mutex_unlock(&stream->lock);
             return VLC_EGENERIC;    /* wait, no data available */
+        }
 
         if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass) {
                 /* still waiting for the next keyframe */
+                vlc_mutex_unlock(&stream->lock);
                 return VLC_EGENERIC;
+            }
 
             /* seek to the new keyframe */
             answer->i_body_offset = stream->i_last_keyframe_seen_pos;
             cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
+        if (answer->i_body_offset < httpd_SegmentPos(httpd_StreamSegment(stream, 0)))
             answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
+        /* Queue references to the shared segments, no data is copied */
+        unsigned i = httpd_StreamFind(stream, answer->i_body_offset);
+        int64_t i_write = 0;
 
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
+        cl->i_seg_sent = answer->i_body_offset
+                       - httpd_SegmentPos(httpd_StreamSegment(stream, i));
+        while (i < stream->i_seg && cl->i_seg < HTTPD_CL_MAXSEG
+            && i_write < HTTPD_CL_BUFSIZE) {
+            block_t *seg = httpd_StreamSegment(stream, i++);
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+            cl->p_seg[cl->i_seg++] = httpd_SegmentHold(seg);
+            i_write += seg->i_buffer;
+        }
+        i_write -= cl->i_seg_sent;
+        vlc_mutex_unlock(&stream->lock);
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
         answer->i_body_offset += i_write;
 
         return VLC_SUCCESS;
@@ -766,7 +896,11 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
     stream->i_header = 0;
     stream->p_header = NULL;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
+    stream->i_seg_max = 64;
+    stream->pp_seg = xmalloc(stream->i_seg_max * sizeof (*stream->pp_seg));
+    stream->i_seg_first = 0;
+    stream->i_seg = 0;
+    stream->i_seg_size = 0;
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
@@ -802,22 +936,47 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
+static int httpd_AppendData(httpd_stream_t *stream, const uint8_t *p_data,
+                            size_t i_data)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
+    if (i_data == 0)
+        return VLC_SUCCESS;
+
+    block_t *seg = httpd_SegmentNew(p_data, i_data, stream->i_buffer_pos);
+    if (unlikely(seg == NULL))
+        return VLC_ENOMEM;
 
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
+    if (stream->i_seg == stream->i_seg_max) {
+        /* grow the ring, unwrapping it */
+        block_t **pp_seg = xmalloc(2 * stream->i_seg_max * sizeof (*pp_seg));
 
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
+        for (unsigned i = 0; i < stream->i_seg; i++)
+            pp_seg[i] = httpd_StreamSegment(stream, i);
+        free(stream->pp_seg);
+        stream->pp_seg = pp_seg;
+        stream->i_seg_max *= 2;
+        stream->i_seg_first = 0;
     }
 
+    stream->pp_seg[(stream->i_seg_first + stream->i_seg++)
+                   & (stream->i_seg_max - 1)] = seg;
+    stream->i_seg_size += i_data;
     stream->i_buffer_pos += i_data;
+
+    /* Drop the oldest segments. Clients still sending them keep a
+     * reference until they are done. */
+    while (stream->i_seg > 1) {
+        block_t *first = httpd_StreamSegment(stream, 0);
+
+        if (stream->i_seg_size - (int64_t)first->i_buffer < stream->i_buffer_size)
+            break;
+
+        stream->i_seg_first = (stream->i_seg_first + 1) & (stream->i_seg_max - 1);
+        stream->i_seg--;
+        stream->i_seg_size -= first->i_buffer;
+        block_Release(first);
+    }
+    return VLC_SUCCESS;
 }
 
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
@@ -835,10 +994,12 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
         stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
     }
 
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
+    int ret = httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
 
     vlc_mutex_unlock(&stream->lock);
-    return VLC_SUCCESS;
+
+    httpd_HostWake(stream->url->host);
+    return ret;
 }
 
 void httpd_StreamDelete(httpd_stream_t *stream)
@@ -852,14 +1013,18 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    for (unsigned i = 0; i < stream->i_seg; i++)
+        block_Release(httpd_StreamSegment(stream, i));
+    free(stream->pp_seg);
     free(stream);
 }
 
 /*****************************************************************************
  * Low level
  *****************************************************************************/
-static void* httpd_HostThread(void *);
+static int  httpd_WorkerInit(httpd_host_t *, httpd_worker_t *, bool);
+static void httpd_WorkerClean(httpd_worker_t *);
+static void *httpd_WorkerThread(void *);
 static httpd_host_t *httpd_HostCreate(vlc_object_t *, const char *,
                                        const char *, vlc_tls_creds_t *);
 
@@ -914,6 +1079,13 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     httpd_host_t *host;
     char *hostname = var_InheritString(p_this, hostvar);
     unsigned port = var_InheritInteger(p_this, portvar);
+#ifdef HAVE_SYS_EPOLL_H
+    unsigned workers = var_InheritInteger(p_this, "http-threads");
+    if (workers < 1)
+        workers = 1;
+#else
+    unsigned workers = 1; /* waiting clients are polled, not woken up */
+#endif
 
     vlc_url_t url;
     vlc_UrlParse(&url, hostname);
@@ -959,6 +1131,8 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     vlc_mutex_init(&host->lock);
     vlc_cond_init(&host->wait);
     host->i_ref = 1;
+    host->i_worker = 0;
+    host->worker = NULL;
 
     host->fds = net_ListenTCP(p_this, url.psz_host, port);
     if (!host->fds) {
@@ -970,16 +1144,29 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     host->port     = port;
     host->i_url    = 0;
     host->url      = NULL;
-    host->i_client = 0;
-    host->client   = NULL;
+    host->worker   = calloc(workers, sizeof (*host->worker));
+    host->i_next_worker = 0;
     host->p_tls    = p_tls;
-
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW)) {
-        msg_Err(p_this, "cannot spawn http host thread");
+    if (unlikely(host->worker == NULL))
         goto error;
+
+    /* create the threads */
+    while (host->i_worker < workers) {
+        httpd_worker_t *w = &host->worker[host->i_worker];
+
+        if (httpd_WorkerInit(host, w, host->i_worker == 0))
+            goto error;
+
+        if (vlc_clone(&w->thread, httpd_WorkerThread, w,
+                       VLC_THREAD_PRIORITY_LOW)) {
+            msg_Err(p_this, "cannot spawn http host thread");
+            httpd_WorkerClean(w);
+            goto error;
+        }
+        host->i_worker++;
     }
+    if (host->i_worker > 1)
+        msg_Dbg(host, "using %u threads", host->i_worker);
 
     /* now add it to httpd */
     TAB_APPEND(httpd.i_host, httpd.host, host);
@@ -993,6 +1180,12 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+        for (unsigned i = 0; i < host->i_worker; i++) {
+            vlc_cancel(host->worker[i].thread);
+            vlc_join(host->worker[i].thread, NULL);
+            httpd_WorkerClean(&host->worker[i]);
+        }
+        free(host->worker);
         net_ListenClose(host->fds);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
@@ -1024,19 +1217,27 @@ void httpd_HostDelete(httpd_host_t *host)
     }
     TAB_REMOVE(httpd.i_host, httpd.host, host);
 
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
+    for (unsigned i = 0; i < host->i_worker; i++)
+        vlc_cancel(host->worker[i].thread);
+    for (unsigned i = 0; i < host->i_worker; i++)
+        vlc_join(host->worker[i].thread, NULL);
 
     msg_Dbg(host, "HTTP host removed");
 
     for (int i = 0; i < host->i_url; i++)
         msg_Err(host, "url still registered: %s", host->url[i]->psz_url);
 
-    for (int i = 0; i < host->i_client; i++) {
-        msg_Warn(host, "client still connected");
-        httpd_ClientDestroy(host->client[i]);
+    for (unsigned i = 0; i < host->i_worker; i++) {
+        httpd_worker_t *w = &host->worker[i];
+
+        for (int j = 0; j < w->i_client; j++) {
+            if (!w->client[j]->b_dead)
+                msg_Warn(host, "client still connected");
+            httpd_ClientDestroy(w->client[j]);
+        }
+        httpd_WorkerClean(w);
     }
-    TAB_CLEAN(host->i_client, host->client);
+    free(host->worker);
 
     vlc_tls_Delete(host->p_tls);
     net_ListenClose(host->fds);
@@ -1075,7 +1276,7 @@ httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
     }
 
     TAB_APPEND(host->i_url, host->url, url);
-    vlc_cond_signal(&host->wait);
+    vlc_cond_broadcast(&host->wait);
     vlc_mutex_unlock(&host->lock);
 
     return url;
@@ -1100,26 +1301,39 @@ void httpd_UrlDelete(httpd_url_t *url)
 
     vlc_mutex_lock(&host->lock);
     TAB_REMOVE(host->i_url, host->url, url);
+    vlc_mutex_unlock(&host->lock);
+
+    /* Once removed from the host, the URL cannot be bound to new clients.
+     * Callbacks only run with the worker lock held, so after this loop none
+     * can be running for this URL. The workers destroy the clients. */
+    for (unsigned i = 0; i < host->i_worker; i++) {
+        httpd_worker_t *w = &host->worker[i];
+        bool b_kill = false;
+
+        vlc_mutex_lock(&w->lock);
+        for (int j = 0; j < w->i_client; j++) {
+            httpd_client_t *client = w->client[j];
+
+            if (client->url != url)
+                continue;
+
+            /* TODO complete it */
+            msg_Warn(host, "force closing connections");
+            client->url = NULL;
+            httpd_WorkerKill(w, client);
+            b_kill = true;
+        }
+        vlc_mutex_unlock(&w->lock);
+
+        if (b_kill)
+            httpd_WorkerWake(w);
+    }
 
     vlc_mutex_destroy(&url->lock);
     free(url->psz_url);
     free(url->psz_user);
     free(url->psz_password);
-
-    for (int i = 0; i < host->i_client; i++) {
-        httpd_client_t *client = host->client[i];
-
-        if (client->url != url)
-            continue;
-
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        TAB_REMOVE(host->i_client, host->client, client);
-        httpd_ClientDestroy(client);
-        i--;
-    }
     free(url);
-    vlc_mutex_unlock(&host->lock);
 }
 
 static void httpd_MsgInit(httpd_message_t *msg)
@@ -1201,6 +1415,8 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->i_seg = 0;
+    cl->i_seg_sent = 0;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1226,6 +1442,8 @@ static void httpd_ClientDestroy(httpd_client_t *cl)
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
+    for (unsigned i = 0; i < cl->i_seg; i++)
+        block_Release(cl->p_seg[i]);
     free(cl->p_buffer);
     free(cl);
 }
@@ -1240,6 +1458,9 @@ static httpd_client_t *httpd_ClientNew(int fd, vlc_tls_t *p_tls, mtime_t now)
     cl->fd      = fd;
     cl->url     = NULL;
     cl->p_tls = p_tls;
+    cl->b_waiting = false;
+    cl->b_dead  = false;
+    cl->i_events = 0;
 
     httpd_ClientInit(cl, now);
     if (p_tls)
@@ -1580,10 +1801,112 @@ static void httpd_ClientRecv(httpd_client_t *cl)
         cl->i_activity_timeout = 0;
 }
 
+static
+ssize_t httpd_NetSendv (httpd_client_t *cl, const struct iovec *iov,
+                        unsigned iovcnt)
+{
+    vlc_tls_t *p_tls;
+    ssize_t val;
+
+    p_tls = cl->p_tls;
+    do
+        if (p_tls != NULL)
+            val = p_tls->writev(p_tls, iov, iovcnt);
+        else {
+            struct msghdr msg = {
+                .msg_iov = (struct iovec *)iov,
+                .msg_iovlen = iovcnt,
+            };
+
+            val = sendmsg (cl->fd, &msg, MSG_NOSIGNAL);
+        }
+    while (val == -1 && errno == EINTR);
+    return val;
+}
+
+/* Picks the next data to send once the current buffer is fully sent */
+static void httpd_ClientSendNext(httpd_client_t *cl)
+{
+    if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
+        /* catch more body data */
+        int     i_msg = cl->query.i_type;
+        int64_t i_offset = cl->answer.i_body_offset;
+
+        httpd_MsgClean(&cl->answer);
+        cl->answer.i_body_offset = i_offset;
+
+        vlc_mutex_lock(&cl->url->host->lock);
+        cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                                  &cl->answer, &cl->query);
+        vlc_mutex_unlock(&cl->url->host->lock);
+    }
+
+    if (cl->answer.i_body > 0) {
+        /* send the body data */
+        free(cl->p_buffer);
+        cl->p_buffer = cl->answer.p_body;
+        cl->i_buffer_size = cl->answer.i_body;
+        cl->i_buffer = 0;
+
+        cl->answer.i_body = 0;
+        cl->answer.p_body = NULL;
+    } else if (cl->i_seg == 0) /* send finished */
+        cl->i_state = HTTPD_CLIENT_SEND_DONE;
+}
+
+/* Sends shared stream segments with scatter I/O */
+static void httpd_ClientSendShared(httpd_client_t *cl)
+{
+    struct iovec iov[HTTPD_CL_MAXSEG];
+
+    for (unsigned i = 0; i < cl->i_seg; i++) {
+        size_t i_skip = (i == 0) ? cl->i_seg_sent : 0;
+
+        iov[i].iov_base = cl->p_seg[i]->p_buffer + i_skip;
+        iov[i].iov_len = cl->p_seg[i]->i_buffer - i_skip;
+    }
+
+    ssize_t i_len = httpd_NetSendv(cl, iov, cl->i_seg);
+    if (i_len <= 0) {
+#if defined(_WIN32)
+        if (i_len == 0 || WSAGetLastError() != WSAEWOULDBLOCK)
+#else
+        if (i_len == 0 || errno != EAGAIN)
+#endif
+            cl->i_state = HTTPD_CLIENT_DEAD;
+        return;
+    }
+
+    /* release the segments sent completely */
+    unsigned i_done = 0;
+
+    while (i_done < cl->i_seg) {
+        size_t i_left = cl->p_seg[i_done]->i_buffer - cl->i_seg_sent;
+
+        if ((size_t)i_len < i_left) {
+            cl->i_seg_sent += i_len;
+            break;
+        }
+        i_len -= i_left;
+        cl->i_seg_sent = 0;
+        block_Release(cl->p_seg[i_done++]);
+    }
+    cl->i_seg -= i_done;
+    memmove(cl->p_seg, cl->p_seg + i_done, cl->i_seg * sizeof (cl->p_seg[0]));
+
+    if (cl->i_seg == 0)
+        httpd_ClientSendNext(cl);
+}
+
 static void httpd_ClientSend(httpd_client_t *cl)
 {
     int i_len;
 
+    if (cl->i_seg > 0) {
+        httpd_ClientSendShared(cl);
+        return;
+    }
+
     if (cl->i_buffer < 0) {
         /* We need to create the header */
         int i_size = 0;
@@ -1620,31 +1943,8 @@ static void httpd_ClientSend(httpd_client_t *cl)
     if (i_len >= 0) {
         cl->i_buffer += i_len;
 
-        if (cl->i_buffer >= cl->i_buffer_size) {
-            if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
-                /* catch more body data */
-                int     i_msg = cl->query.i_type;
-                int64_t i_offset = cl->answer.i_body_offset;
-
-                httpd_MsgClean(&cl->answer);
-                cl->answer.i_body_offset = i_offset;
-
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                                          &cl->answer, &cl->query);
-            }
-
-            if (cl->answer.i_body > 0) {
-                /* send the body data */
-                free(cl->p_buffer);
-                cl->p_buffer = cl->answer.p_body;
-                cl->i_buffer_size = cl->answer.i_body;
-                cl->i_buffer = 0;
-
-                cl->answer.i_body = 0;
-                cl->answer.p_body = NULL;
-            } else /* send finished */
-                cl->i_state = HTTPD_CLIENT_SEND_DONE;
-        }
+        if (cl->i_buffer >= cl->i_buffer_size)
+            httpd_ClientSendNext(cl);
     } else {
 #if defined(_WIN32)
         if ((i_len < 0 && WSAGetLastError() != WSAEWOULDBLOCK) || (i_len == 0))
@@ -1709,361 +2009,650 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* Handles a complete request: triggers the URL callbacks */
+static void httpd_ClientAnswer(httpd_host_t *host, httpd_client_t *cl)
 {
-    struct pollfd ufd[host->nfd + host->i_client];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
+    httpd_message_t *answer = &cl->answer;
+    httpd_message_t *query  = &cl->query;
+
+    httpd_MsgInit(answer);
+
+    /* Handle what we received */
+    switch (query->i_type) {
+        case HTTPD_MSG_ANSWER:
+            cl->url     = NULL;
+            cl->i_state = HTTPD_CLIENT_DEAD;
+            break;
+
+        case HTTPD_MSG_OPTIONS:
+            answer->i_type   = HTTPD_MSG_ANSWER;
+            answer->i_proto  = query->i_proto;
+            answer->i_status = 200;
+            answer->i_body = 0;
+            answer->p_body = NULL;
+
+            httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
+            httpd_MsgAdd(answer, "Content-Length", "0");
+
+            switch(query->i_proto) {
+            case HTTPD_PROTO_HTTP:
+                answer->i_version = 1;
+                httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
+                break;
+
+            case HTTPD_PROTO_RTSP:
+                answer->i_version = 0;
+
+                const char *p = httpd_MsgGet(query, "Cseq");
+                if (p)
+                    httpd_MsgAdd(answer, "Cseq", "%s", p);
+                p = httpd_MsgGet(query, "Timestamp");
+                if (p)
+                    httpd_MsgAdd(answer, "Timestamp", "%s", p);
+
+                p = httpd_MsgGet(query, "Require");
+                if (p) {
+                    answer->i_status = 551;
+                    httpd_MsgAdd(query, "Unsupported", "%s", p);
+                }
+
+                httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
+                        "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
+                break;
+            }
+
+            cl->i_buffer = -1;  /* Force the creation of the answer in
+                                 * httpd_ClientSend */
+            cl->i_state = HTTPD_CLIENT_SENDING;
+            break;
+
+        case HTTPD_MSG_NONE:
+            if (query->i_proto == HTTPD_PROTO_NONE) {
+                cl->url = NULL;
+                cl->i_state = HTTPD_CLIENT_DEAD;
+            } else {
+                /* unimplemented */
+                answer->i_proto  = query->i_proto ;
+                answer->i_type   = HTTPD_MSG_ANSWER;
+                answer->i_version= 0;
+                answer->i_status = 501;
+
+                char *p;
+                answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                answer->p_body = (uint8_t *)p;
+                httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+
+                cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                cl->i_state = HTTPD_CLIENT_SENDING;
+            }
+            break;
+
+        default: {
+            int i_msg = query->i_type;
+            bool b_auth_failed = false;
+
+            vlc_mutex_lock(&host->lock);
+            /* Search the url and trigger callbacks */
+            for (int i = 0; i < host->i_url; i++) {
+                httpd_url_t *url = host->url[i];
+
+                if (strcmp(url->psz_url, query->psz_url))
+                    continue;
+                if (!url->catch[i_msg].cb)
+                    continue;
+
+                if (answer) {
+                    b_auth_failed = !httpdAuthOk(url->psz_user,
+                       url->psz_password,
+                       httpd_MsgGet(query, "Authorization")); /* BASIC id */
+                    if (b_auth_failed)
+                       break;
+                }
+
+                if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
+                    continue;
+
+                if (answer->i_proto == HTTPD_PROTO_NONE)
+                    cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
+                else
+                    cl->i_buffer = -1;
+
+                /* only one url can answer */
+                answer = NULL;
+                if (!cl->url)
+                    cl->url = url;
+            }
+            vlc_mutex_unlock(&host->lock);
+
+            if (answer) {
+                answer->i_proto  = query->i_proto;
+                answer->i_type   = HTTPD_MSG_ANSWER;
+                answer->i_version= 0;
+
+               if (b_auth_failed) {
+                    httpd_MsgAdd(answer, "WWW-Authenticate",
+                            "Basic realm=\"VLC stream\"");
+                    answer->i_status = 401;
+                } else
+                    answer->i_status = 404; /* no url registered */
+
+                char *p;
+                answer->i_body = httpd_HtmlError (&p, answer->i_status,
+                        query->psz_url);
+                answer->p_body = (uint8_t *)p;
+
+                cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
+            }
+
+            cl->i_state = HTTPD_CLIENT_SENDING;
+        }
     }
+}
 
-    /* add all socket that should be read/write and close dead connection */
-    while (host->i_url <= 0) {
-        mutex_cleanup_push(&host->lock);
-        vlc_cond_wait(&host->wait, &host->lock);
-        vlc_cleanup_pop();
+/* Handles a complete answer: keeps the connection alive or waits for more
+ * stream data */
+static void httpd_ClientSendDone(httpd_client_t *cl)
+{
+    if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
+        const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
+        const char *psz_query = httpd_MsgGet(&cl->query, "Connection");
+        bool b_connection = false;
+        bool b_keepalive = false;
+        bool b_query = false;
+
+        cl->url = NULL;
+        if (psz_connection) {
+            b_connection = (strcasecmp(psz_connection, "Close") == 0);
+            b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
+        }
+
+        if (psz_query)
+            b_query = (strcasecmp(psz_query, "Close") == 0);
+
+        if (((cl->query.i_proto == HTTPD_PROTO_HTTP) &&
+                    ((cl->query.i_version == 0 && b_keepalive) ||
+                      (cl->query.i_version == 1 && !b_connection))) ||
+                ((cl->query.i_proto == HTTPD_PROTO_RTSP) &&
+                  !b_query && !b_connection)) {
+            httpd_MsgClean(&cl->query);
+            httpd_MsgInit(&cl->query);
+
+            cl->i_buffer = 0;
+            cl->i_buffer_size = 1000;
+            free(cl->p_buffer);
+            cl->p_buffer = xmalloc(cl->i_buffer_size);
+            cl->i_state = HTTPD_CLIENT_RECEIVING;
+        } else
+            cl->i_state = HTTPD_CLIENT_DEAD;
+        httpd_MsgClean(&cl->answer);
+    } else {
+        int64_t i_offset = cl->answer.i_body_offset;
+        httpd_MsgClean(&cl->answer);
+
+        cl->answer.i_body_offset = i_offset;
+        free(cl->p_buffer);
+        cl->p_buffer = NULL;
+        cl->i_buffer = 0;
+        cl->i_buffer_size = 0;
+
+        cl->i_state = HTTPD_CLIENT_WAITING;
     }
+}
 
-    mtime_t now = mdate();
-    bool b_low_delay = false;
+/* Asks the stream for more data, returns true if there was some */
+static bool httpd_ClientWait(httpd_host_t *host, httpd_client_t *cl)
+{
+    int64_t i_offset = cl->answer.i_body_offset;
+    int i_msg = cl->query.i_type;
 
-    int canc = vlc_savecancel();
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        int64_t i_offset;
-        httpd_client_t *cl = host->client[i_client];
-        if (cl->i_ref < 0 || (cl->i_ref == 0 &&
-                    (cl->i_state == HTTPD_CLIENT_DEAD ||
-                      (cl->i_activity_timeout > 0 &&
-                        cl->i_activity_date+cl->i_activity_timeout < now)))) {
-            TAB_REMOVE(host->i_client, host->client, cl);
-            i_client--;
-            httpd_ClientDestroy(cl);
-            continue;
-        }
+    httpd_MsgInit(&cl->answer);
+    cl->answer.i_body_offset = i_offset;
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+    vlc_mutex_lock(&host->lock);
+    cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+            &cl->answer, &cl->query);
+    vlc_mutex_unlock(&host->lock);
 
-        pufd->fd = cl->fd;
-        pufd->events = pufd->revents = 0;
+    if (cl->answer.i_type == HTTPD_MSG_NONE)
+        return false;
 
+    /* we have new data, so re-enter send mode */
+    cl->i_buffer      = 0;
+    cl->p_buffer      = cl->answer.p_body;
+    cl->i_buffer_size = cl->answer.i_body;
+    cl->answer.p_body = NULL;
+    cl->answer.i_body = 0;
+    cl->i_state = HTTPD_CLIENT_SENDING;
+    return true;
+}
+
+/**
+ * Runs the client state machine until it needs network I/O.
+ * \return the poll events to wait for, or 0 if the client is dead or
+ * waiting for stream data
+ */
+static short httpd_ClientAdvance(httpd_host_t *host, httpd_client_t *cl)
+{
+    for (;;)
         switch (cl->i_state) {
             case HTTPD_CLIENT_RECEIVING:
             case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
+                return POLLIN;
 
             case HTTPD_CLIENT_SENDING:
             case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
+                return POLLOUT;
+
+            case HTTPD_CLIENT_RECEIVE_DONE:
+                httpd_ClientAnswer(host, cl);
                 break;
 
-            case HTTPD_CLIENT_RECEIVE_DONE: {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
+            case HTTPD_CLIENT_SEND_DONE:
+                httpd_ClientSendDone(cl);
+                break;
 
-                httpd_MsgInit(answer);
+            case HTTPD_CLIENT_WAITING:
+                if (!httpd_ClientWait(host, cl))
+                    return 0;
+                break;
 
-                /* Handle what we received */
-                switch (query->i_type) {
-                    case HTTPD_MSG_ANSWER:
-                        cl->url     = NULL;
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                        break;
+            default:
+                return 0;
+        }
+}
 
-                    case HTTPD_MSG_OPTIONS:
-                        answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_proto  = query->i_proto;
-                        answer->i_status = 200;
-                        answer->i_body = 0;
-                        answer->p_body = NULL;
+/*****************************************************************************
+ * Workers
+ *****************************************************************************/
+static int httpd_WorkerInit(httpd_host_t *host, httpd_worker_t *w,
+                            bool b_listen)
+{
+    w->host = host;
+    vlc_mutex_init(&w->lock);
+    TAB_INIT(w->i_client, w->client);
+    TAB_INIT(w->i_waiting, w->waiting);
+    TAB_INIT(w->i_dead, w->dead);
+    w->i_next_expiry = 0;
+
+#ifdef HAVE_SYS_EPOLL_H
+    atomic_init(&w->b_woken, false);
+
+    w->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (w->epfd == -1)
+        goto error;
+    if (vlc_pipe(w->wakefd)) {
+        close(w->epfd);
+        goto error;
+    }
+    fcntl(w->wakefd[0], F_SETFL, O_NONBLOCK);
+    fcntl(w->wakefd[1], F_SETFL, O_NONBLOCK);
 
-                        httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
-                        httpd_MsgAdd(answer, "Content-Length", "0");
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = w };
 
-                        switch(query->i_proto) {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
-                            break;
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->wakefd[0], &ev))
+        goto error_epoll;
 
-                        case HTTPD_PROTO_RTSP:
-                            answer->i_version = 0;
+    for (unsigned i = 0; b_listen && i < host->nfd; i++) {
+        ev.data.ptr = &host->fds[i];
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, host->fds[i], &ev))
+            goto error_epoll;
+    }
+    return 0;
 
-                            const char *p = httpd_MsgGet(query, "Cseq");
-                            if (p)
-                                httpd_MsgAdd(answer, "Cseq", "%s", p);
-                            p = httpd_MsgGet(query, "Timestamp");
-                            if (p)
-                                httpd_MsgAdd(answer, "Timestamp", "%s", p);
+error_epoll:
+    vlc_close(w->wakefd[1]);
+    vlc_close(w->wakefd[0]);
+    close(w->epfd);
+error:
+    msg_Err(host, "cannot create HTTP event loop: %s",
+            vlc_strerror_c(errno));
+    vlc_mutex_destroy(&w->lock);
+    return -1;
+#else
+    (void) b_listen;
+    return 0;
+#endif
+}
 
-                            p = httpd_MsgGet(query, "Require");
-                            if (p) {
-                                answer->i_status = 551;
-                                httpd_MsgAdd(query, "Unsupported", "%s", p);
-                            }
+static void httpd_WorkerClean(httpd_worker_t *w)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    vlc_close(w->wakefd[1]);
+    vlc_close(w->wakefd[0]);
+    close(w->epfd);
+#endif
+    TAB_CLEAN(w->i_dead, w->dead);
+    TAB_CLEAN(w->i_waiting, w->waiting);
+    TAB_CLEAN(w->i_client, w->client);
+    vlc_mutex_destroy(&w->lock);
+}
 
-                            httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
-                                    "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
-                            break;
-                        }
+static void httpd_WorkerWake(httpd_worker_t *w)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (!atomic_exchange(&w->b_woken, true)
+     && write(w->wakefd[1], &(char){ 0 }, 1) < 0)
+        atomic_store(&w->b_woken, false);
+#else
+    (void) w;
+#endif
+}
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in
-                                             * httpd_ClientSend */
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                        break;
+/* wakes the workers up, so that waiting clients can send new data */
+static void httpd_HostWake(httpd_host_t *host)
+{
+    for (unsigned i = 0; i < host->i_worker; i++)
+        httpd_WorkerWake(&host->worker[i]);
+}
 
-                    case HTTPD_MSG_NONE:
-                        if (query->i_proto == HTTPD_PROTO_NONE) {
-                            cl->url = NULL;
-                            cl->i_state = HTTPD_CLIENT_DEAD;
-                        } else {
-                            /* unimplemented */
-                            answer->i_proto  = query->i_proto ;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-                            answer->i_status = 501;
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                            answer->p_body = (uint8_t *)p;
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            cl->i_state = HTTPD_CLIENT_SENDING;
-                        }
-                        break;
+/* Marks a client for destruction (with the worker lock held) */
+static void httpd_WorkerKill(httpd_worker_t *w, httpd_client_t *cl)
+{
+    cl->i_state = HTTPD_CLIENT_DEAD;
+    if (!cl->b_dead) {
+        cl->b_dead = true;
+        TAB_APPEND(w->i_dead, w->dead, cl);
+    }
+}
 
-                    default: {
-                        int i_msg = query->i_type;
-                        bool b_auth_failed = false;
-
-                        /* Search the url and trigger callbacks */
-                        for (int i = 0; i < host->i_url; i++) {
-                            httpd_url_t *url = host->url[i];
-
-                            if (strcmp(url->psz_url, query->psz_url))
-                                continue;
-                            if (!url->catch[i_msg].cb)
-                                continue;
-
-                            if (answer) {
-                                b_auth_failed = !httpdAuthOk(url->psz_user,
-                                   url->psz_password,
-                                   httpd_MsgGet(query, "Authorization")); /* BASIC id */
-                                if (b_auth_failed)
-                                   break;
-                            }
-
-                            if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
-                                continue;
-
-                            if (answer->i_proto == HTTPD_PROTO_NONE)
-                                cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
-                            else
-                                cl->i_buffer = -1;
-
-                            /* only one url can answer */
-                            answer = NULL;
-                            if (!cl->url)
-                                cl->url = url;
-                        }
+/* Runs the client until it blocks and updates the events to poll for */
+static void httpd_WorkerUpdate(httpd_worker_t *w, httpd_client_t *cl)
+{
+    short events = httpd_ClientAdvance(w->host, cl);
+    bool b_waiting = cl->i_state == HTTPD_CLIENT_WAITING;
 
-                        if (answer) {
-                            answer->i_proto  = query->i_proto;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-
-                           if (b_auth_failed) {
-                                httpd_MsgAdd(answer, "WWW-Authenticate",
-                                        "Basic realm=\"VLC stream\"");
-                                answer->i_status = 401;
-                            } else
-                                answer->i_status = 404; /* no url registered */
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, answer->i_status,
-                                    query->psz_url);
-                            answer->p_body = (uint8_t *)p;
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-                            httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
-                        }
+    if (b_waiting != cl->b_waiting) {
+        if (b_waiting)
+            TAB_APPEND(w->i_waiting, w->waiting, cl);
+        else
+            TAB_REMOVE(w->i_waiting, w->waiting, cl);
+        cl->b_waiting = b_waiting;
+    }
 
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                    }
-                }
-                break;
-            }
+    if (cl->i_state == HTTPD_CLIENT_DEAD) {
+        httpd_WorkerKill(w, cl);
+        return;
+    }
 
-            case HTTPD_CLIENT_SEND_DONE:
-                if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
-                    const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
-                    const char *psz_query = httpd_MsgGet(&cl->query, "Connection");
-                    bool b_connection = false;
-                    bool b_keepalive = false;
-                    bool b_query = false;
-
-                    cl->url = NULL;
-                    if (psz_connection) {
-                        b_connection = (strcasecmp(psz_connection, "Close") == 0);
-                        b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
-                    }
+    if (events == cl->i_events)
+        return;
+    cl->i_events = events;
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev = {
+        .events = ((events & POLLIN) ? EPOLLIN : 0)
+                | ((events & POLLOUT) ? EPOLLOUT : 0),
+        .data.ptr = cl,
+    };
+    epoll_ctl(w->epfd, EPOLL_CTL_MOD, cl->fd, &ev);
+#endif
+}
 
-                    if (psz_query)
-                        b_query = (strcasecmp(psz_query, "Close") == 0);
-
-                    if (((cl->query.i_proto == HTTPD_PROTO_HTTP) &&
-                                ((cl->query.i_version == 0 && b_keepalive) ||
-                                  (cl->query.i_version == 1 && !b_connection))) ||
-                            ((cl->query.i_proto == HTTPD_PROTO_RTSP) &&
-                              !b_query && !b_connection)) {
-                        httpd_MsgClean(&cl->query);
-                        httpd_MsgInit(&cl->query);
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
-                        cl->p_buffer = xmalloc(cl->i_buffer_size);
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    } else
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    httpd_MsgClean(&cl->answer);
-                } else {
-                    i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean(&cl->answer);
+static void httpd_WorkerAdd(httpd_worker_t *w, httpd_client_t *cl)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev = { .events = 0, .data.ptr = cl };
 
-                    cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, cl->fd, &ev)) {
+        msg_Err(w->host, "cannot poll HTTP client: %s",
+                vlc_strerror_c(errno));
+        httpd_ClientDestroy(cl);
+        return;
+    }
+#endif
+    TAB_APPEND(w->i_client, w->client, cl);
+    httpd_WorkerUpdate(w, cl);
+}
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
-                break;
+/* Handles network I/O readiness (or error) on a client socket */
+static void httpd_WorkerDispatch(httpd_worker_t *w, httpd_client_t *cl,
+                                 mtime_t now)
+{
+    if (cl->b_dead)
+        return; /* killed earlier in this iteration */
 
-            case HTTPD_CLIENT_WAITING:
-                i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
-
-                httpd_MsgInit(&cl->answer);
-                cl->answer.i_body_offset = i_offset;
-
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
-                if (cl->answer.i_type != HTTPD_MSG_NONE) {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
-        }
+    cl->i_activity_date = now;
 
-        if (pufd->events != 0)
-            nfd++;
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
+        case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            httpd_ClientTlsHandshake(w->host, cl);
+            break;
+        default: /* hang-up or error while not expecting any I/O */
+            cl->i_state = HTTPD_CLIENT_DEAD;
+            break;
+    }
+    httpd_WorkerUpdate(w, cl);
+}
+
+/* Retries the clients waiting for stream data */
+static void httpd_WorkerResume(httpd_worker_t *w)
+{
+    /* clients leaving the waiting list are removed from it */
+    for (int i = w->i_waiting - 1; i >= 0; i--)
+        if (i < w->i_waiting)
+            httpd_WorkerUpdate(w, w->waiting[i]);
+}
+
+static void httpd_WorkerExpire(httpd_worker_t *w, mtime_t now)
+{
+    if (now < w->i_next_expiry)
+        return;
+    w->i_next_expiry = now + CLOCK_FREQ;
+
+    for (int i = 0; i < w->i_client; i++) {
+        httpd_client_t *cl = w->client[i];
+
+        if (cl->i_ref < 0 || (cl->i_ref == 0 &&
+             cl->i_activity_timeout > 0 &&
+             cl->i_activity_date + cl->i_activity_timeout < now))
+            httpd_WorkerKill(w, cl);
+    }
+}
+
+static void httpd_WorkerReap(httpd_worker_t *w)
+{
+    for (int i = 0; i < w->i_dead; i++) {
+        httpd_client_t *cl = w->dead[i];
+
+        TAB_REMOVE(w->i_client, w->client, cl);
+        if (cl->b_waiting)
+            TAB_REMOVE(w->i_waiting, w->waiting, cl);
+#ifdef HAVE_SYS_EPOLL_H
+        epoll_ctl(w->epfd, EPOLL_CTL_DEL, cl->fd, NULL);
+#endif
+        httpd_ClientDestroy(cl);
+    }
+    TAB_CLEAN(w->i_dead, w->dead);
+}
+
+/* Accepts a new connection and hands it over to a worker */
+static void httpd_HostAccept(httpd_host_t *host, int fd, mtime_t now)
+{
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *p_tls;
+
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+
+        p_tls = vlc_tls_ServerSessionCreate(host->p_tls, fd, alpn);
+    }
+    else
+        p_tls = NULL;
+
+    httpd_client_t *cl = httpd_ClientNew(fd, p_tls, now);
+    if (unlikely(cl == NULL)) {
+        if (p_tls != NULL)
+            vlc_tls_Close(p_tls);
         else
-            b_low_delay = true;
+            net_Close(fd);
+        return;
     }
-    vlc_mutex_unlock(&host->lock);
-    vlc_restorecancel(canc);
 
-    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-    int ret = poll(ufd, nfd, b_low_delay ? 20 : -1);
+    httpd_worker_t *w = &host->worker[host->i_next_worker];
+    host->i_next_worker = (host->i_next_worker + 1) % host->i_worker;
 
-    canc = vlc_savecancel();
+    vlc_mutex_lock(&w->lock);
+    httpd_WorkerAdd(w, cl);
+    vlc_mutex_unlock(&w->lock);
+}
+
+static void httpd_HostWaitUrl(httpd_host_t *host)
+{
     vlc_mutex_lock(&host->lock);
-    switch(ret) {
-        case -1:
-            if (errno != EINTR) {
-                /* Kernel on low memory or a bug: pace */
-                msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
-                msleep(100000);
-            }
-        case 0:
-            vlc_restorecancel(canc);
-            return;
+    mutex_cleanup_push(&host->lock);
+    while (host->i_url <= 0)
+        vlc_cond_wait(&host->wait, &host->lock);
+    vlc_cleanup_pop();
+    vlc_mutex_unlock(&host->lock);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+#define HTTPD_MAX_EVENTS 64
+
+static void httpdLoop(httpd_worker_t *w)
+{
+    httpd_host_t *host = w->host;
+    struct epoll_event ev[HTTPD_MAX_EVENTS];
+
+    httpd_HostWaitUrl(host);
+
+    /* wake up at least once per second to expire idle connections */
+    int n = epoll_wait(w->epfd, ev, HTTPD_MAX_EVENTS, 1000);
+
+    int canc = vlc_savecancel();
+    if (n == -1) {
+        if (errno != EINTR) {
+            /* Kernel on low memory or a bug: pace */
+            msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+            msleep(100000);
+        }
+        n = 0;
     }
 
-    /* Handle client sockets */
-    now = mdate();
-    nfd = host->nfd;
+    mtime_t now = mdate();
+    bool b_woken = false;
 
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        httpd_client_t *cl = host->client[i_client];
-        const struct pollfd *pufd = &ufd[nfd];
+    /* Handle server sockets (accept new connections) */
+    for (int i = 0; i < n; i++) {
+        const int *fd = ev[i].data.ptr;
 
-        assert(pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])]);
+        if (w == host->worker
+         && fd >= host->fds && fd < host->fds + host->nfd) {
+            httpd_HostAccept(host, *fd, now);
+            ev[i].data.ptr = NULL;
+        }
+    }
 
-        if (cl->fd != pufd->fd)
-            continue; // we were not waiting for this client
-        ++nfd;
-        if (pufd->revents == 0)
-            continue; // no event received
+    vlc_mutex_lock(&w->lock);
+    /* Handle client sockets */
+    for (int i = 0; i < n; i++) {
+        void *ptr = ev[i].data.ptr;
 
-        cl->i_activity_date = now;
+        if (ptr == w) {
+            char dummy[16];
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
-            case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                httpd_ClientTlsHandshake(host, cl);
-                break;
+            while (read(w->wakefd[0], dummy, sizeof (dummy)) > 0);
+            atomic_store(&w->b_woken, false);
+            b_woken = true;
         }
+        else if (ptr != NULL)
+            httpd_WorkerDispatch(w, ptr, now);
     }
 
-    /* Handle server sockets (accept new connections) */
+    if (b_woken)
+        httpd_WorkerResume(w);
+    httpd_WorkerExpire(w, now);
+    httpd_WorkerReap(w);
+    vlc_mutex_unlock(&w->lock);
+    vlc_restorecancel(canc);
+}
+
+#else
+static void httpdLoop(httpd_worker_t *w)
+{
+    httpd_host_t *host = w->host;
+
+    httpd_HostWaitUrl(host);
+
+    /* Only one worker without epoll: clients are only added by this thread,
+     * and only destroyed by this thread. */
+    vlc_mutex_lock(&w->lock);
+
+    struct pollfd ufd[host->nfd + w->i_client];
+    httpd_client_t *clients[host->nfd + w->i_client];
+    unsigned nfd;
     for (nfd = 0; nfd < host->nfd; nfd++) {
-        httpd_client_t *cl;
-        int fd = ufd[nfd].fd;
+        ufd[nfd].fd = host->fds[nfd];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd].revents = 0;
+    }
 
-        assert (fd == host->fds[nfd]);
+    /* add all socket that should be read/write */
+    for (int i = 0; i < w->i_client; i++) {
+        httpd_client_t *cl = w->client[i];
 
-        if (ufd[nfd].revents == 0)
+        if (cl->i_events == 0)
             continue;
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
+        clients[nfd] = cl;
+        ufd[nfd].fd = cl->fd;
+        ufd[nfd].events = cl->i_events;
+        ufd[nfd].revents = 0;
+        nfd++;
+    }
 
-        vlc_tls_t *p_tls;
+    bool b_low_delay = w->i_waiting > 0;
+    vlc_mutex_unlock(&w->lock);
 
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
+    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
+    int ret = poll(ufd, nfd, b_low_delay ? 20 : 1000);
 
-            p_tls = vlc_tls_ServerSessionCreate(host->p_tls, fd, alpn);
-        }
-        else
-            p_tls = NULL;
+    int canc = vlc_savecancel();
+    if (ret == -1 && errno != EINTR) {
+        /* Kernel on low memory or a bug: pace */
+        msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+        msleep(100000);
+    }
 
-        cl = httpd_ClientNew(fd, p_tls, now);
+    mtime_t now = mdate();
 
-        TAB_APPEND(host->i_client, host->client, cl);
-    }
+    /* Handle server sockets (accept new connections) */
+    for (unsigned i = 0; ret > 0 && i < host->nfd; i++)
+        if (ufd[i].revents != 0)
+            httpd_HostAccept(host, ufd[i].fd, now);
 
+    vlc_mutex_lock(&w->lock);
+    /* Handle client sockets */
+    for (unsigned i = host->nfd; ret > 0 && i < nfd; i++)
+        if (ufd[i].revents != 0)
+            httpd_WorkerDispatch(w, clients[i], now);
+
+    if (b_low_delay)
+        httpd_WorkerResume(w);
+    httpd_WorkerExpire(w, now);
+    httpd_WorkerReap(w);
+    vlc_mutex_unlock(&w->lock);
     vlc_restorecancel(canc);
 }
+#endif
 
-static void* httpd_HostThread(void *data)
+static void *httpd_WorkerThread(void *data)
 {
-    httpd_host_t *host = data;
+    httpd_worker_t *w = data;
 
-    vlc_mutex_lock(&host->lock);
-    while (host->i_ref > 0)
-        httpdLoop(host);
-    vlc_mutex_unlock(&host->lock);
-    return NULL;
+    for (;;)
+        httpdLoop(w);
+    vlc_assert_unreachable();
 }
 
 int httpd_StreamSetHTTPHeaders(httpd_stream_t * p_stream, httpd_header * p_headers, size_t i_headers)
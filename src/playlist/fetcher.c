@@ -70,22 +70,40 @@ struct fetcher_entry_t
     fetcher_entry_t *p_next;
 };
 
+/* Entry being fetched by a worker thread */
+typedef struct
+{
+    vlc_interrupt_t *interrupt;
+    mtime_t          deadline;
+} fetcher_task_t;
+
 struct playlist_fetcher_t
 {
     vlc_object_t   *object;
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    bool            b_live;
-    vlc_interrupt_t *interrupt;
+    bool            b_closing;
+    unsigned        i_threads;
+    unsigned        i_max_threads;
+
+    /* Per item time limit */
+    mtime_t         i_timeout;
+    vlc_timer_t     timer;
+    mtime_t         i_next_deadline;
+
+    fetcher_task_t **pp_running;
+    int             i_running;
 
     fetcher_entry_t *p_waiting_head[PASS_COUNT];
     fetcher_entry_t *p_waiting_tail[PASS_COUNT];
+    unsigned        i_waiting;
 
     DECL_ARRAY(playlist_album_t) albums;
     meta_fetcher_scope_t e_scope;
 };
 
 static void *Thread( void * );
+static void Timeout( void * );
 
 
 /*****************************************************************************
@@ -97,16 +115,25 @@ playlist_fetcher_t *playlist_fetcher_New( vlc_object_t *parent )
     if( !p_fetcher )
         return NULL;
 
-    p_fetcher->interrupt = vlc_interrupt_create();
-    if( unlikely(p_fetcher->interrupt == NULL) )
+    p_fetcher->object = parent;
+    p_fetcher->i_timeout = var_InheritInteger( parent, "fetch-art-timeout" )
+                           * 1000;
+    if( p_fetcher->i_timeout > 0
+     && vlc_timer_create( &p_fetcher->timer, Timeout, p_fetcher ) )
     {
         free( p_fetcher );
         return NULL;
     }
-    p_fetcher->object = parent;
+    p_fetcher->i_next_deadline = 0;
+    p_fetcher->i_max_threads = var_InheritInteger( parent, "fetch-art-threads" );
+    if( p_fetcher->i_max_threads == 0 )
+        p_fetcher->i_max_threads = 1;
+
     vlc_mutex_init( &p_fetcher->lock );
     vlc_cond_init( &p_fetcher->wait );
-    p_fetcher->b_live = false;
+    p_fetcher->b_closing = false;
+    p_fetcher->i_threads = 0;
+    TAB_INIT( p_fetcher->i_running, p_fetcher->pp_running );
 
     bool b_access = var_InheritBool( parent, "metadata-network-access" );
     if ( !b_access )
@@ -116,39 +143,95 @@ playlist_fetcher_t *playlist_fetcher_New( vlc_object_t *parent )
 
     memset( p_fetcher->p_waiting_head, 0, PASS_COUNT * sizeof(fetcher_entry_t *) );
     memset( p_fetcher->p_waiting_tail, 0, PASS_COUNT * sizeof(fetcher_entry_t *) );
+    p_fetcher->i_waiting = 0;
 
     ARRAY_INIT( p_fetcher->albums );
 
     return p_fetcher;
 }
 
+/* Looks for a pending entry of the item, and moves it to the head of its
+ * queue if requested. */
+static fetcher_entry_t *FindPending( playlist_fetcher_t *p_fetcher,
+                                     input_item_t *p_item, bool b_head )
+{
+    for( int i = 0; i < PASS_COUNT; i++ )
+    {
+        fetcher_entry_t *p_prev = NULL;
+
+        for( fetcher_entry_t *p_entry = p_fetcher->p_waiting_head[i];
+             p_entry != NULL; p_prev = p_entry, p_entry = p_entry->p_next )
+        {
+            if( p_entry->p_item != p_item )
+                continue;
+
+            if( b_head && p_prev != NULL )
+            {
+                p_prev->p_next = p_entry->p_next;
+                if( p_fetcher->p_waiting_tail[i] == p_entry )
+                    p_fetcher->p_waiting_tail[i] = p_prev;
+                p_entry->p_next = p_fetcher->p_waiting_head[i];
+                p_fetcher->p_waiting_head[i] = p_entry;
+            }
+            return p_entry;
+        }
+    }
+    return NULL;
+}
+
 void playlist_fetcher_Push( playlist_fetcher_t *p_fetcher, input_item_t *p_item,
                             input_item_meta_request_option_t i_options )
 {
-    fetcher_entry_t *p_entry = malloc( sizeof(fetcher_entry_t) );
-    if ( !p_entry ) return;
+    const bool b_priority = i_options & META_REQUEST_OPTION_PRIORITY;
+
+    vlc_mutex_lock( &p_fetcher->lock );
+    fetcher_entry_t *p_entry = FindPending( p_fetcher, p_item, b_priority );
+    if( p_entry != NULL )
+    {   /* Already pending: merge the requests */
+        p_entry->i_options |= i_options;
+        vlc_mutex_unlock( &p_fetcher->lock );
+        return;
+    }
+
+    p_entry = malloc( sizeof(fetcher_entry_t) );
+    if ( !p_entry )
+    {
+        vlc_mutex_unlock( &p_fetcher->lock );
+        return;
+    }
 
     vlc_gc_incref( p_item );
     p_entry->p_item = p_item;
     p_entry->p_next = NULL;
     p_entry->i_options = i_options;
-    vlc_mutex_lock( &p_fetcher->lock );
-    /* Append last */
-    if ( p_fetcher->p_waiting_head[PASS1_LOCAL] )
-        p_fetcher->p_waiting_tail[PASS1_LOCAL]->p_next = p_entry;
-    else
+    if( b_priority )
+    {   /* Prepend */
+        p_entry->p_next = p_fetcher->p_waiting_head[PASS1_LOCAL];
+        if( p_entry->p_next == NULL )
+            p_fetcher->p_waiting_tail[PASS1_LOCAL] = p_entry;
         p_fetcher->p_waiting_head[PASS1_LOCAL] = p_entry;
-    p_fetcher->p_waiting_tail[PASS1_LOCAL] = p_entry;
+    }
+    else
+    {   /* Append last */
+        if ( p_fetcher->p_waiting_head[PASS1_LOCAL] )
+            p_fetcher->p_waiting_tail[PASS1_LOCAL]->p_next = p_entry;
+        else
+            p_fetcher->p_waiting_head[PASS1_LOCAL] = p_entry;
+        p_fetcher->p_waiting_tail[PASS1_LOCAL] = p_entry;
+    }
+    p_fetcher->i_waiting++;
 
-    if( !p_fetcher->b_live )
+    /* Spawn a worker unless there is an idle one already */
+    if( p_fetcher->i_threads < p_fetcher->i_max_threads
+     && p_fetcher->i_threads - (unsigned)p_fetcher->i_running
+                                                    < p_fetcher->i_waiting )
     {
-        assert( p_fetcher->p_waiting_head[PASS1_LOCAL] );
         if( vlc_clone_detach( NULL, Thread, p_fetcher,
                               VLC_THREAD_PRIORITY_LOW ) )
             msg_Err( p_fetcher->object,
                      "cannot spawn secondary preparse thread" );
         else
-            p_fetcher->b_live = true;
+            p_fetcher->i_threads++;
     }
     vlc_mutex_unlock( &p_fetcher->lock );
 }
@@ -157,10 +240,9 @@ void playlist_fetcher_Delete( playlist_fetcher_t *p_fetcher )
 {
     fetcher_entry_t *p_next;
 
-    vlc_interrupt_kill(p_fetcher->interrupt);
-
     vlc_mutex_lock( &p_fetcher->lock );
-    /* Remove any left-over item, the fetcher will exit */
+    p_fetcher->b_closing = true;
+    /* Remove any left-over item, the fetchers will exit */
     for ( int i_queue=0; i_queue<PASS_COUNT; i_queue++ )
     {
         while( p_fetcher->p_waiting_head[i_queue] )
@@ -172,16 +254,22 @@ void playlist_fetcher_Delete( playlist_fetcher_t *p_fetcher )
         }
         p_fetcher->p_waiting_head[i_queue] = NULL;
     }
+    p_fetcher->i_waiting = 0;
+
+    /* Abort the ongoing fetches */
+    for( int i = 0; i < p_fetcher->i_running; i++ )
+        vlc_interrupt_kill( p_fetcher->pp_running[i]->interrupt );
 
-    while( p_fetcher->b_live )
+    while( p_fetcher->i_threads > 0 )
         vlc_cond_wait( &p_fetcher->wait, &p_fetcher->lock );
     vlc_mutex_unlock( &p_fetcher->lock );
+    assert( p_fetcher->i_running == 0 );
 
+    if( p_fetcher->i_timeout > 0 )
+        vlc_timer_destroy( p_fetcher->timer );
     vlc_cond_destroy( &p_fetcher->wait );
     vlc_mutex_destroy( &p_fetcher->lock );
 
-    vlc_interrupt_destroy( p_fetcher->interrupt );
-
     playlist_album_t album;
     FOREACH_ARRAY( album, p_fetcher->albums )
         free( album.psz_album );
@@ -197,6 +285,47 @@ void playlist_fetcher_Delete( playlist_fetcher_t *p_fetcher )
 /*****************************************************************************
  * Privates functions
  *****************************************************************************/
+/**
+ * Timer callback interrupting the fetches that took too long.
+ */
+static void Timeout( void *data )
+{
+    playlist_fetcher_t *p_fetcher = data;
+    mtime_t now = mdate();
+    mtime_t next = 0;
+
+    vlc_mutex_lock( &p_fetcher->lock );
+    for( int i = 0; i < p_fetcher->i_running; i++ )
+    {
+        fetcher_task_t *task = p_fetcher->pp_running[i];
+
+        if( task->deadline <= now )
+            vlc_interrupt_kill( task->interrupt );
+        else if( next == 0 || task->deadline < next )
+            next = task->deadline;
+    }
+    p_fetcher->i_next_deadline = next;
+    if( next != 0 )
+        vlc_timer_schedule( p_fetcher->timer, true, next, 0 );
+    vlc_mutex_unlock( &p_fetcher->lock );
+}
+
+/* The fetcher lock must be held */
+static playlist_album_t *FindAlbum( playlist_fetcher_t *p_fetcher,
+                                    const char *psz_artist,
+                                    const char *psz_album )
+{
+    for( int i = 0; i < p_fetcher->albums.i_size; i++ )
+    {
+        playlist_album_t *p_album = &p_fetcher->albums.p_elems[i];
+
+        if( !strcmp( p_album->psz_artist, psz_artist ) &&
+            !strcmp( p_album->psz_album, psz_album ) )
+            return p_album;
+    }
+    return NULL;
+}
+
 /**
  * This function locates the art associated to an input item.
  * Return codes:
@@ -204,11 +333,11 @@ void playlist_fetcher_Delete( playlist_fetcher_t *p_fetcher )
  *   1 : Art found, need to download
  *  -X : Error/not found
  */
-static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
+static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item,
+                    meta_fetcher_scope_t e_scope )
 {
     int i_ret;
 
-    playlist_album_t *p_album = NULL;
     char *psz_artist = input_item_GetArtist( p_item );
     char *psz_album = input_item_GetAlbum( p_item );
     char *psz_title = input_item_GetTitle( p_item );
@@ -223,36 +352,51 @@ static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
     /* If we already checked this album in this session, skip */
     if( psz_artist && psz_album )
     {
-        FOREACH_ARRAY( playlist_album_t album, p_fetcher->albums )
-            if( !strcmp( album.psz_artist, psz_artist ) &&
-                !strcmp( album.psz_album, psz_album ) )
+        playlist_album_t *p_album;
+        bool b_known = false, b_found = false;
+        meta_fetcher_scope_t e_album_scope = 0;
+        char *psz_album_arturl = NULL;
+
+        vlc_mutex_lock( &p_fetcher->lock );
+        p_album = FindAlbum( p_fetcher, psz_artist, psz_album );
+        if( p_album != NULL )
+        {
+            b_known = true;
+            b_found = p_album->b_found;
+            e_album_scope = p_album->e_scope;
+            if( p_album->psz_arturl != NULL )
+                psz_album_arturl = strdup( p_album->psz_arturl );
+        }
+        vlc_mutex_unlock( &p_fetcher->lock );
+
+        if( b_known )
+        {
+            msg_Dbg( p_fetcher->object,
+                     " %s - %s has already been searched",
+                     psz_artist, psz_album );
+            /* TODO-fenrir if we cache art filename too, we can go faster */
+            if( b_found )
             {
-                msg_Dbg( p_fetcher->object,
-                         " %s - %s has already been searched",
-                         psz_artist, psz_album );
-                /* TODO-fenrir if we cache art filename too, we can go faster */
                 free( psz_artist );
                 free( psz_album );
-                if( album.b_found )
-                {
-                    if( !strncmp( album.psz_arturl, "file://", 7 ) )
-                        input_item_SetArtURL( p_item, album.psz_arturl );
-                    else /* Actually get URL from cache */
-                        playlist_FindArtInCache( p_item );
-                    return 0;
-                }
-                else if ( album.e_scope >= p_fetcher->e_scope )
-                {
-                    return VLC_EGENERIC;
-                }
-                msg_Dbg( p_fetcher->object,
-                         " will search at higher scope, if possible" );
-                p_album = &p_fetcher->albums.p_elems[fe_idx];
-
-                psz_artist = psz_album = NULL;
-                break;
+                if( psz_album_arturl != NULL
+                 && !strncmp( psz_album_arturl, "file://", 7 ) )
+                    input_item_SetArtURL( p_item, psz_album_arturl );
+                else /* Actually get URL from cache */
+                    playlist_FindArtInCache( p_item );
+                free( psz_album_arturl );
+                return 0;
+            }
+            free( psz_album_arturl );
+            if( e_album_scope >= e_scope )
+            {
+                free( psz_artist );
+                free( psz_album );
+                return VLC_EGENERIC;
             }
-        FOREACH_END();
+            msg_Dbg( p_fetcher->object,
+                     " will search at higher scope, if possible" );
+        }
     }
 
     free( psz_artist );
@@ -308,7 +452,7 @@ static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
         module_t *p_module;
 
         p_finder->p_item = p_item;
-        p_finder->e_scope = p_fetcher->e_scope;
+        p_finder->e_scope = e_scope;
 
         p_module = module_need( p_finder, "art finder", NULL, false );
         if( p_module )
@@ -326,11 +470,16 @@ static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
     /* Record this album */
     if( psz_artist && psz_album )
     {
+        char *psz_arturl = input_item_GetArtURL( p_item );
+
+        vlc_mutex_lock( &p_fetcher->lock );
+        playlist_album_t *p_album = FindAlbum( p_fetcher, psz_artist,
+                                               psz_album );
         if ( p_album )
         {
-            p_album->e_scope = p_fetcher->e_scope;
+            p_album->e_scope = e_scope;
             free( p_album->psz_arturl );
-            p_album->psz_arturl = input_item_GetArtURL( p_item );
+            p_album->psz_arturl = psz_arturl;
             p_album->b_found = (i_ret == VLC_EGENERIC ? false : true );
             free( psz_artist );
             free( psz_album );
@@ -340,11 +489,12 @@ static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
             playlist_album_t a;
             a.psz_artist = psz_artist;
             a.psz_album = psz_album;
-            a.psz_arturl = input_item_GetArtURL( p_item );
+            a.psz_arturl = psz_arturl;
             a.b_found = (i_ret == VLC_EGENERIC ? false : true );
-            a.e_scope = p_fetcher->e_scope;
+            a.e_scope = e_scope;
             ARRAY_APPEND( p_fetcher->albums, a );
         }
+        vlc_mutex_unlock( &p_fetcher->lock );
     }
     else
     {
@@ -428,14 +578,15 @@ error:
  * connections, and gather information upon the playing media.
  * (even artwork).
  */
-static void FetchMeta( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
+static void FetchMeta( playlist_fetcher_t *p_fetcher, input_item_t *p_item,
+                       meta_fetcher_scope_t e_scope )
 {
     meta_fetcher_t *p_finder =
         vlc_custom_create( p_fetcher->object, sizeof( *p_finder ), "art finder" );
     if ( !p_finder )
         return;
 
-    p_finder->e_scope = p_fetcher->e_scope;
+    p_finder->e_scope = e_scope;
     p_finder->p_item = p_item;
 
     module_t *p_module = module_need( p_finder, "meta fetcher", NULL, false );
@@ -445,17 +596,24 @@ static void FetchMeta( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
     vlc_object_release( p_finder );
 }
 
+/**
+ * Worker thread: fetches the art of the pending items, until there are no
+ * more pending entries.
+ */
 static void *Thread( void *p_data )
 {
     playlist_fetcher_t *p_fetcher = p_data;
     vlc_object_t *obj = p_fetcher->object;
-    fetcher_pass_t e_pass = PASS1_LOCAL;
-
-    vlc_interrupt_set(p_fetcher->interrupt);
+    fetcher_task_t task;
 
     for( ;; )
     {
         fetcher_entry_t *p_entry = NULL;
+        fetcher_pass_t e_pass = PASS1_LOCAL;
+
+        /* The interrupt context may be killed by a timeout, so a new one is
+         * used for each item */
+        task.interrupt = vlc_interrupt_create();
 
         vlc_mutex_lock( &p_fetcher->lock );
         for ( int i=0; i<PASS_COUNT; i++ )
@@ -467,37 +625,57 @@ static void *Thread( void *p_data )
             }
         }
 
-        if( p_fetcher->p_waiting_head[e_pass] )
+        if( p_fetcher->p_waiting_head[e_pass] && task.interrupt != NULL )
         {
             p_entry = p_fetcher->p_waiting_head[e_pass];
             p_fetcher->p_waiting_head[e_pass] = p_entry->p_next;
             if ( p_entry->p_next == NULL )
                 p_fetcher->p_waiting_tail[e_pass] = NULL;
             p_entry->p_next = NULL;
+            p_fetcher->i_waiting--;
+
+            task.deadline = 0;
+            if( p_fetcher->i_timeout > 0 )
+            {
+                task.deadline = mdate() + p_fetcher->i_timeout;
+                if( p_fetcher->i_next_deadline == 0
+                 || task.deadline < p_fetcher->i_next_deadline )
+                {
+                    p_fetcher->i_next_deadline = task.deadline;
+                    vlc_timer_schedule( p_fetcher->timer, true,
+                                        task.deadline, 0 );
+                }
+            }
+            TAB_APPEND( p_fetcher->i_running, p_fetcher->pp_running, &task );
         }
         else
         {
-            vlc_interrupt_set( NULL );
-            p_fetcher->b_live = false;
+            p_fetcher->i_threads--;
             vlc_cond_signal( &p_fetcher->wait );
         }
         vlc_mutex_unlock( &p_fetcher->lock );
 
         if( !p_entry )
+        {
+            if( task.interrupt != NULL )
+                vlc_interrupt_destroy( task.interrupt );
             break;
+        }
 
-        meta_fetcher_scope_t e_prev_scope = p_fetcher->e_scope;
+        vlc_interrupt_set( task.interrupt );
+
+        meta_fetcher_scope_t e_scope = p_fetcher->e_scope;
 
         /* scope override */
-        switch ( p_entry->i_options ) {
+        switch ( p_entry->i_options & META_REQUEST_OPTION_SCOPE_ANY ) {
         case META_REQUEST_OPTION_SCOPE_ANY:
-            p_fetcher->e_scope = FETCHER_SCOPE_ANY;
+            e_scope = FETCHER_SCOPE_ANY;
             break;
         case META_REQUEST_OPTION_SCOPE_LOCAL:
-            p_fetcher->e_scope = FETCHER_SCOPE_LOCAL;
+            e_scope = FETCHER_SCOPE_LOCAL;
             break;
         case META_REQUEST_OPTION_SCOPE_NETWORK:
-            p_fetcher->e_scope = FETCHER_SCOPE_NETWORK;
+            e_scope = FETCHER_SCOPE_NETWORK;
             break;
         case META_REQUEST_OPTION_NONE:
         default:
@@ -510,22 +688,22 @@ static void *Thread( void *p_data )
 
         int i_ret = -1;
 
-        if( e_pass == PASS1_LOCAL && ( p_fetcher->e_scope & FETCHER_SCOPE_LOCAL ) )
+        if( e_pass == PASS1_LOCAL && ( e_scope & FETCHER_SCOPE_LOCAL ) )
         {
             /* only fetch from local */
-            p_fetcher->e_scope = FETCHER_SCOPE_LOCAL;
+            e_scope = FETCHER_SCOPE_LOCAL;
         }
-        else if( e_pass == PASS2_NETWORK && ( p_fetcher->e_scope & FETCHER_SCOPE_NETWORK ) )
+        else if( e_pass == PASS2_NETWORK && ( e_scope & FETCHER_SCOPE_NETWORK ) )
         {
             /* only fetch from network */
-            p_fetcher->e_scope = FETCHER_SCOPE_NETWORK;
+            e_scope = FETCHER_SCOPE_NETWORK;
         }
         else
-            p_fetcher->e_scope = 0;
-        if ( p_fetcher->e_scope & FETCHER_SCOPE_ANY )
+            e_scope = 0;
+        if ( e_scope & FETCHER_SCOPE_ANY )
         {
-            FetchMeta( p_fetcher, p_entry->p_item );
-            i_ret = FindArt( p_fetcher, p_entry->p_item );
+            FetchMeta( p_fetcher, p_entry->p_item, e_scope );
+            i_ret = FindArt( p_fetcher, p_entry->p_item, e_scope );
             switch( i_ret )
             {
             case 1: /* Found, need to dl */
@@ -539,20 +717,26 @@ static void *Thread( void *p_data )
             }
         }
 
-        p_fetcher->e_scope = e_prev_scope;
-        /* */
-        if ( i_ret != VLC_SUCCESS && (e_pass != PASS2_NETWORK) )
+        vlc_interrupt_set( NULL );
+
+        vlc_mutex_lock( &p_fetcher->lock );
+        TAB_REMOVE( p_fetcher->i_running, p_fetcher->pp_running, &task );
+        if ( i_ret != VLC_SUCCESS && (e_pass != PASS2_NETWORK)
+          && !p_fetcher->b_closing )
         {
             /* Move our entry to next pass queue */
-            vlc_mutex_lock( &p_fetcher->lock );
             if ( p_fetcher->p_waiting_head[e_pass + 1] )
                 p_fetcher->p_waiting_tail[e_pass + 1]->p_next = p_entry;
             else
                 p_fetcher->p_waiting_head[e_pass + 1] = p_entry;
             p_fetcher->p_waiting_tail[e_pass + 1] = p_entry;
-            vlc_mutex_unlock( &p_fetcher->lock );
+            p_fetcher->i_waiting++;
+            p_entry = NULL;
         }
-        else
+        vlc_mutex_unlock( &p_fetcher->lock );
+        vlc_interrupt_destroy( task.interrupt );
+
+        if( p_entry != NULL )
         {
             /* */
             char *psz_name = input_item_GetName( p_entry->p_item );
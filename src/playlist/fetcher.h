@@ -36,7 +36,10 @@
 typedef struct playlist_fetcher_t playlist_fetcher_t;
 
 /**
- * This function creates the fetcher object and thread.
+ * This function creates the fetcher object.
+ *
+ * Art is fetched by up to "fetch-art-threads" worker threads, each item for
+ * at most "fetch-art-timeout".
  */
 playlist_fetcher_t *playlist_fetcher_New( vlc_object_t * );
 
@@ -44,13 +47,15 @@ playlist_fetcher_t *playlist_fetcher_New( vlc_object_t * );
  * This function enqueues the provided item to be art fetched.
  *
  * The input item is retained until the art fetching is done or until the
- * fetcher object is destroyed.
+ * fetcher object is destroyed. If the item is already pending, the requests
+ * are merged. With META_REQUEST_OPTION_PRIORITY, the item is fetched before
+ * the items pushed without it.
  */
 void playlist_fetcher_Push( playlist_fetcher_t *, input_item_t *,
                             input_item_meta_request_option_t );
 
 /**
- * This function destroys the fetcher object and thread.
+ * This function destroys the fetcher object and threads.
  *
  * All pending input items will be released.
  */
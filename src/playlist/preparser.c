@@ -46,25 +46,37 @@ struct preparser_entry_t
     mtime_t          timeout;
 };
 
-struct playlist_preparser_t
-{
-    vlc_object_t        *object;
-    playlist_fetcher_t  *p_fetcher;
-    mtime_t              default_timeout;
+typedef struct preparser_task_t preparser_task_t;
 
-    void                *input_id;
+/* Entry being preparsed by a worker thread */
+struct preparser_task_t
+{
+    playlist_preparser_t *owner;
+    preparser_entry_t    *p_entry;
+    void                 *id;
+    vlc_cond_t            wait;
     enum {
         INPUT_RUNNING,
         INPUT_STOPPED,
         INPUT_CANCELED,
     } input_state;
+};
+
+struct playlist_preparser_t
+{
+    vlc_object_t        *object;
+    playlist_fetcher_t  *p_fetcher;
+    mtime_t              default_timeout;
+    unsigned             i_max_threads;
 
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    vlc_cond_t      thread_wait;
-    bool            b_live;
+    unsigned        i_threads;
+    preparser_task_t  **pp_running;
+    int             i_running;
     preparser_entry_t  **pp_waiting;
     size_t          i_waiting;
+    size_t          i_priority; /* priority entries at the head of the queue */
 };
 
 static void *Thread( void * );
@@ -78,19 +90,21 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *parent )
     if( !p_preparser )
         return NULL;
 
-    p_preparser->input_id = NULL;
-    p_preparser->input_state = INPUT_RUNNING;
     p_preparser->object = parent;
     p_preparser->default_timeout = var_InheritInteger( parent, "preparse-timeout" );
+    p_preparser->i_max_threads = var_InheritInteger( parent, "preparse-threads" );
+    if( p_preparser->i_max_threads == 0 )
+        p_preparser->i_max_threads = 1;
     p_preparser->p_fetcher = playlist_fetcher_New( parent );
     if( unlikely(p_preparser->p_fetcher == NULL) )
         msg_Err( parent, "cannot create fetcher" );
 
     vlc_mutex_init( &p_preparser->lock );
     vlc_cond_init( &p_preparser->wait );
-    vlc_cond_init( &p_preparser->thread_wait );
-    p_preparser->b_live = false;
+    p_preparser->i_threads = 0;
+    TAB_INIT( p_preparser->i_running, p_preparser->pp_running );
     p_preparser->i_waiting = 0;
+    p_preparser->i_priority = 0;
     p_preparser->pp_waiting = NULL;
 
     return p_preparser;
@@ -100,26 +114,75 @@ void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p
                               input_item_meta_request_option_t i_options,
                               int timeout, void *id )
 {
-    preparser_entry_t *p_entry = malloc( sizeof(preparser_entry_t) );
-
-    if ( !p_entry )
-        return;
-    p_entry->p_item = p_item;
-    p_entry->i_options = i_options;
-    p_entry->id = id;
-    p_entry->timeout = (timeout < 0 ? p_preparser->default_timeout : timeout) * 1000;
-    vlc_gc_incref( p_entry->p_item );
+    const bool b_priority = i_options & META_REQUEST_OPTION_PRIORITY;
+    mtime_t i_timeout = (timeout < 0 ? p_preparser->default_timeout : timeout) * 1000;
+    preparser_entry_t *p_entry = NULL;
+    size_t i;
 
     vlc_mutex_lock( &p_preparser->lock );
-    INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
-                 p_preparser->i_waiting, p_entry );
-    if( !p_preparser->b_live )
+    /* Merge with a pending request for the same item */
+    for( i = 0; i < p_preparser->i_waiting; i++ )
+    {
+        preparser_entry_t *p_pending = p_preparser->pp_waiting[i];
+        if( p_pending->p_item == p_item && p_pending->id == id )
+        {
+            p_entry = p_pending;
+            break;
+        }
+    }
+
+    if( p_entry != NULL )
+    {
+        p_entry->i_options |= i_options;
+        if( p_entry->timeout > 0
+         && ( i_timeout <= 0 || i_timeout > p_entry->timeout ) )
+            p_entry->timeout = i_timeout;
+
+        if( b_priority && i >= p_preparser->i_priority )
+        {
+            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, i );
+            INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
+                         p_preparser->i_priority, p_entry );
+            p_preparser->i_priority++;
+        }
+    }
+    else
+    {
+        p_entry = malloc( sizeof(preparser_entry_t) );
+        if( !p_entry )
+        {
+            vlc_mutex_unlock( &p_preparser->lock );
+            return;
+        }
+        p_entry->p_item = p_item;
+        p_entry->i_options = i_options;
+        p_entry->id = id;
+        p_entry->timeout = i_timeout;
+        vlc_gc_incref( p_entry->p_item );
+
+        /* Priority requests go after the pending priority requests, but
+         * before any other one */
+        if( b_priority )
+        {
+            INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
+                         p_preparser->i_priority, p_entry );
+            p_preparser->i_priority++;
+        }
+        else
+            INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
+                         p_preparser->i_waiting, p_entry );
+    }
+
+    /* Spawn a worker unless there is an idle one already */
+    if( p_preparser->i_threads < p_preparser->i_max_threads
+     && p_preparser->i_threads - (unsigned)p_preparser->i_running
+                                                    < p_preparser->i_waiting )
     {
         if( vlc_clone_detach( NULL, Thread, p_preparser,
                               VLC_THREAD_PRIORITY_LOW ) )
             msg_Warn( p_preparser->object, "cannot spawn pre-parser thread" );
         else
-            p_preparser->b_live = true;
+            p_preparser->i_threads++;
     }
     vlc_mutex_unlock( &p_preparser->lock );
 }
@@ -145,14 +208,20 @@ void playlist_preparser_Cancel( playlist_preparser_t *p_preparser, void *id )
             vlc_gc_decref( p_entry->p_item );
             free( p_entry );
             REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, i );
+            if( (size_t)i < p_preparser->i_priority )
+                p_preparser->i_priority--;
         }
     }
 
-    /* Stop the input_thread reading the item (if any) */
-    if( p_preparser->input_id == id )
+    /* Stop the input_threads reading the items (if any) */
+    for( int i = 0; i < p_preparser->i_running; i++ )
     {
-        p_preparser->input_state = INPUT_CANCELED;
-        vlc_cond_signal( &p_preparser->thread_wait );
+        preparser_task_t *task = p_preparser->pp_running[i];
+        if( task->id == id )
+        {
+            task->input_state = INPUT_CANCELED;
+            vlc_cond_signal( &task->wait );
+        }
     }
     vlc_mutex_unlock( &p_preparser->lock );
 }
@@ -168,16 +237,21 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
         free( p_entry );
         REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
     }
+    p_preparser->i_priority = 0;
 
-    p_preparser->input_state = INPUT_CANCELED;
-    vlc_cond_signal( &p_preparser->thread_wait );
+    for( int i = 0; i < p_preparser->i_running; i++ )
+    {
+        preparser_task_t *task = p_preparser->pp_running[i];
+        task->input_state = INPUT_CANCELED;
+        vlc_cond_signal( &task->wait );
+    }
 
-    while( p_preparser->b_live )
+    while( p_preparser->i_threads > 0 )
         vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
     vlc_mutex_unlock( &p_preparser->lock );
+    assert( p_preparser->i_running == 0 );
 
     /* Destroy the item preparser */
-    vlc_cond_destroy( &p_preparser->thread_wait );
     vlc_cond_destroy( &p_preparser->wait );
     vlc_mutex_destroy( &p_preparser->lock );
 
@@ -193,15 +267,16 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 static int InputEvent( vlc_object_t *obj, const char *varname,
                        vlc_value_t old, vlc_value_t cur, void *data )
 {
-    playlist_preparser_t *preparser = data;
+    preparser_task_t *task = data;
+    playlist_preparser_t *preparser = task->owner;
     int event = cur.i_int;
 
     if( event == INPUT_EVENT_DEAD )
     {
         vlc_mutex_lock( &preparser->lock );
 
-        preparser->input_state = INPUT_STOPPED;
-        vlc_cond_signal( &preparser->thread_wait );
+        task->input_state = INPUT_STOPPED;
+        vlc_cond_signal( &task->wait );
 
         vlc_mutex_unlock( &preparser->lock );
     }
@@ -214,8 +289,9 @@ static int InputEvent( vlc_object_t *obj, const char *varname,
  * This function preparses an item when needed.
  */
 static void Preparse( playlist_preparser_t *preparser,
-                      preparser_entry_t *p_entry )
+                      preparser_task_t *task )
 {
+    preparser_entry_t *p_entry = task->p_entry;
     input_item_t *p_item = p_entry->p_item;
 
     vlc_mutex_lock( &p_item->lock );
@@ -245,7 +321,7 @@ static void Preparse( playlist_preparser_t *preparser,
             return;
         }
 
-        var_AddCallback( input, "intf-event", InputEvent, preparser );
+        var_AddCallback( input, "intf-event", InputEvent, task );
         if( input_Start( input ) == VLC_SUCCESS )
         {
             vlc_mutex_lock( &preparser->lock );
@@ -253,21 +329,21 @@ static void Preparse( playlist_preparser_t *preparser,
             if( p_entry->timeout > 0 )
             {
                 mtime_t deadline = mdate() + p_entry->timeout;
-                while( preparser->input_state == INPUT_RUNNING )
+                while( task->input_state == INPUT_RUNNING )
                 {
-                    if( vlc_cond_timedwait( &preparser->thread_wait,
+                    if( vlc_cond_timedwait( &task->wait,
                                             &preparser->lock, deadline ) )
-                        preparser->input_state = INPUT_CANCELED; /* timeout */
+                        task->input_state = INPUT_CANCELED; /* timeout */
                 }
             }
             else
             {
-                while( preparser->input_state == INPUT_RUNNING )
-                    vlc_cond_wait( &preparser->thread_wait, &preparser->lock );
+                while( task->input_state == INPUT_RUNNING )
+                    vlc_cond_wait( &task->wait, &preparser->lock );
             }
-            assert( preparser->input_state == INPUT_STOPPED
-                 || preparser->input_state == INPUT_CANCELED );
-            status = preparser->input_state == INPUT_STOPPED ?
+            assert( task->input_state == INPUT_STOPPED
+                 || task->input_state == INPUT_CANCELED );
+            status = task->input_state == INPUT_STOPPED ?
                      ITEM_PREPARSE_DONE : ITEM_PREPARSE_TIMEOUT;
 
             vlc_mutex_unlock( &preparser->lock );
@@ -275,7 +351,7 @@ static void Preparse( playlist_preparser_t *preparser,
         else
             status = ITEM_PREPARSE_FAILED;
 
-        var_DelCallback( input, "intf-event", InputEvent, preparser );
+        var_DelCallback( input, "intf-event", InputEvent, task );
         if( status == ITEM_PREPARSE_TIMEOUT )
             input_Stop( input );
         input_Close( input );
@@ -291,7 +367,8 @@ static void Preparse( playlist_preparser_t *preparser,
 /**
  * This function ask the fetcher object to fetch the art when needed
  */
-static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
+static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item,
+                 input_item_meta_request_option_t i_options )
 {
     vlc_object_t *obj = p_preparser->object;
     playlist_fetcher_t *p_fetcher = p_preparser->p_fetcher;
@@ -326,46 +403,49 @@ static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
     vlc_mutex_unlock( &p_item->lock );
 
     if( b_fetch && p_fetcher )
-        playlist_fetcher_Push( p_fetcher, p_item, 0 );
+        playlist_fetcher_Push( p_fetcher, p_item,
+                               i_options & META_REQUEST_OPTION_PRIORITY );
 }
 
 /**
- * This function does the preparsing and issues the art fetching requests
+ * Worker thread: does the preparsing and issues the art fetching requests,
+ * until there are no more pending entries.
  */
 static void *Thread( void *data )
 {
     playlist_preparser_t *p_preparser = data;
+    preparser_task_t task;
 
-    for( ;; )
-    {
-        preparser_entry_t *p_entry;
+    task.owner = p_preparser;
+    vlc_cond_init( &task.wait );
 
-        vlc_mutex_lock( &p_preparser->lock );
-        /* */
-        p_preparser->input_state = INPUT_RUNNING;
-        if( p_preparser->i_waiting > 0 )
-        {
-            p_entry = p_preparser->pp_waiting[0];
-            p_preparser->input_id = p_entry->id;
-            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
-        }
-        else
-        {
-            p_preparser->b_live = false;
-            p_preparser->input_id = NULL;
-            vlc_cond_signal( &p_preparser->wait );
-            vlc_mutex_unlock( &p_preparser->lock );
-            break;
-        }
+    vlc_mutex_lock( &p_preparser->lock );
+    while( p_preparser->i_waiting > 0 )
+    {
+        task.p_entry = p_preparser->pp_waiting[0];
+        task.id = task.p_entry->id;
+        task.input_state = INPUT_RUNNING;
+        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+        if( p_preparser->i_priority > 0 )
+            p_preparser->i_priority--;
+        TAB_APPEND( p_preparser->i_running, p_preparser->pp_running, &task );
         vlc_mutex_unlock( &p_preparser->lock );
-        assert( p_entry );
 
-        Preparse( p_preparser, p_entry );
+        preparser_entry_t *p_entry = task.p_entry;
+
+        Preparse( p_preparser, &task );
 
-        Art( p_preparser, p_entry->p_item );
+        Art( p_preparser, p_entry->p_item, p_entry->i_options );
         vlc_gc_decref( p_entry->p_item );
         free( p_entry );
+
+        vlc_mutex_lock( &p_preparser->lock );
+        TAB_REMOVE( p_preparser->i_running, p_preparser->pp_running, &task );
     }
+    p_preparser->i_threads--;
+    vlc_cond_signal( &p_preparser->wait );
+    vlc_mutex_unlock( &p_preparser->lock );
+
+    vlc_cond_destroy( &task.wait );
     return NULL;
 }
-
@@ -36,7 +36,9 @@
 typedef struct playlist_preparser_t playlist_preparser_t;
 
 /**
- * This function creates the preparser object and thread.
+ * This function creates the preparser object.
+ *
+ * Items are preparsed by up to "preparse-threads" worker threads.
  */
 playlist_preparser_t *playlist_preparser_New( vlc_object_t * );
 
@@ -53,6 +55,10 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t * );
  * indefinitely. If > 0, the timeout will be used (in milliseconds).
  * @param id unique id provided by the caller. This is can be used to cancel
  * the request with playlist_preparser_Cancel()
+ *
+ * If the item is already pending with the same id, the requests are merged.
+ * With META_REQUEST_OPTION_PRIORITY, the item is preparsed before the items
+ * pushed without it.
  */
 void playlist_preparser_Push( playlist_preparser_t *, input_item_t *,
                               input_item_meta_request_option_t,
@@ -69,7 +75,7 @@ void playlist_preparser_fetcher_Push( playlist_preparser_t *, input_item_t *,
 void playlist_preparser_Cancel( playlist_preparser_t *, void *id );
 
 /**
- * This function destroys the preparser object and thread.
+ * This function destroys the preparser object and threads.
  *
  * All pending input items will be released.
  */
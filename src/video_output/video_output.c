@@ -52,6 +52,7 @@
 #include "interlacing.h"
 #include "display.h"
 #include "window.h"
+#include "../misc/filter_chain.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -344,7 +345,7 @@ bool vout_IsEmpty(vout_thread_t *vout)
     if (picture)
         picture_Release(picture);
 
-    return !picture;
+    return !picture && !atomic_load(&vout->p->filter.is_busy);
 }
 
 void vout_NextPicture(vout_thread_t *vout, mtime_t *duration)
@@ -634,13 +635,25 @@ static picture_t *VoutVideoFilterStaticNewPicture(filter_t *filter)
 {
     vout_thread_t *vout = filter->owner.sys;
 
-    vlc_assert_locked(&vout->p->filter.lock);
+    /* In pipelined mode, this is called from the last filter thread. The
+     * pools and the interactive chain only change once the static chain is
+     * flushed, which stops the filter threads. */
+    if (!vout->p->filter.is_pipelined)
+        vlc_assert_locked(&vout->p->filter.lock);
     if (filter_chain_GetLength(vout->p->filter.chain_interactive) == 0)
         return VoutVideoFilterInteractiveNewPicture(filter);
 
     return picture_NewFromFormat(&filter->fmt_out.video);
 }
 
+static void VoutVideoFilterStaticWake(void *data)
+{
+    vout_thread_t *vout = data;
+
+    /* A picture is ready at the output of the pipelined static chain */
+    vout_control_Wake(&vout->p->control);
+}
+
 static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
 {
     if (vout->p->displayed.current)
@@ -655,6 +668,7 @@ static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
         vlc_mutex_lock(&vout->p->filter.lock);
     filter_chain_VideoFlush(vout->p->filter.chain_static);
     filter_chain_VideoFlush(vout->p->filter.chain_interactive);
+    atomic_store(&vout->p->filter.is_busy, false);
     if (!is_locked)
         vlc_mutex_unlock(&vout->p->filter.lock);
 }
@@ -686,7 +700,10 @@ static void ThreadChangeFilters(vout_thread_t *vout,
             vout_filter_t *e = xmalloc(sizeof(*e));
             e->name = name;
             e->cfg  = cfg;
-            if (!strcmp(e->name, "deinterlace") ||
+            /* In pipelined mode, all filters go to the static chain, as the
+             * interactive chain is run on the vout thread */
+            if (vout->p->filter.is_pipelined ||
+                !strcmp(e->name, "deinterlace") ||
                 !strcmp(e->name, "postproc")) {
                 vlc_array_append(&array_static, e);
             } else {
@@ -804,6 +821,9 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
         picture = filter_chain_VideoFilter(vout->p->filter.chain_static, decoded);
     }
 
+    /* Pictures still in the pipeline must not be seen as drained */
+    atomic_store(&vout->p->filter.is_busy,
+                 filter_chain_IsPipelineBusy(vout->p->filter.chain_static));
     vlc_mutex_unlock(&vout->p->filter.lock);
 
     if (!picture)
@@ -1309,6 +1329,12 @@ static int ThreadStart(vout_thread_t *vout, vout_display_state_t *state)
     vout->p->filter.chain_static =
         filter_chain_NewVideo( vout, true, &owner );
 
+    vout->p->filter.is_pipelined = var_InheritBool(vout, "video-filter-pipeline");
+    atomic_init(&vout->p->filter.is_busy, false);
+    if (vout->p->filter.is_pipelined && vout->p->filter.chain_static != NULL)
+        filter_chain_EnablePipeline(vout->p->filter.chain_static, true,
+                                    VoutVideoFilterStaticWake, vout);
+
     owner.video.buffer_new = VoutVideoFilterInteractiveNewPicture;
     vout->p->filter.chain_interactive =
         filter_chain_NewVideo( vout, true, &owner );
@@ -29,6 +29,7 @@
 #include <vlc_picture_pool.h>
 #include <vlc_vout_display.h>
 #include <vlc_vout_wrapper.h>
+#include <vlc_atomic.h>
 #include "vout_control.h"
 #include "control.h"
 #include "snapshot.h"
@@ -119,6 +120,8 @@ struct vout_thread_sys_t
         video_format_t  format;
         struct filter_chain_t *chain_static;
         struct filter_chain_t *chain_interactive;
+        bool            is_pipelined;
+        atomic_bool     is_busy; /* pictures in the pipelined static chain */
     } filter;
 
     /* */
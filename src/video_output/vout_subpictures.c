@@ -61,11 +61,25 @@ typedef struct {
     spu_heap_entry_t entry[VOUT_MAX_SUBPICTURES];
 } spu_heap_t;
 
+#define SPU_CACHE_CHROMA_MAX 16
+
+/* Last rendered subpictures, reused as long as the same subpictures are
+ * rendered unchanged for the same formats */
+typedef struct {
+    subpicture_t   *output;        /**< rendered subpicture, NULL if none */
+    unsigned       count;
+    subpicture_t   *subpicture[VOUT_MAX_SUBPICTURES];
+    vlc_fourcc_t   chroma_list[SPU_CACHE_CHROMA_MAX + 1];
+    video_format_t fmt_dst;
+    video_format_t fmt_src;
+} spu_cache_t;
+
 struct spu_private_t {
     vlc_mutex_t  lock;            /* lock to protect all followings fields */
     vlc_object_t *input;
 
     spu_heap_t   heap;
+    spu_cache_t  cache;
 
     int channel;             /**< number of subpicture channels registered */
     filter_t *text;                              /**< text renderer module */
@@ -156,6 +170,116 @@ static void SpuHeapClean(spu_heap_t *heap)
     }
 }
 
+/*****************************************************************************
+ * render cache
+ *****************************************************************************/
+/**
+ * Create a region showing the given picture, without allocating one.
+ */
+static subpicture_region_t *SpuRegionNew(const video_format_t *fmt,
+                                         picture_t *picture)
+{
+    video_format_t text_fmt = *fmt;
+    text_fmt.i_chroma  = VLC_CODEC_TEXT;
+    text_fmt.p_palette = NULL;
+
+    subpicture_region_t *region = subpicture_region_New(&text_fmt);
+    if (!region)
+        return NULL;
+    if (video_format_Copy(&region->fmt, fmt)) {
+        subpicture_region_Delete(region);
+        return NULL;
+    }
+    region->p_picture = picture_Hold(picture);
+    return region;
+}
+
+static void SpuCacheInit(spu_cache_t *cache)
+{
+    cache->output = NULL;
+}
+
+static void SpuCacheInvalidate(spu_cache_t *cache)
+{
+    if (cache->output)
+        subpicture_Delete(cache->output);
+    cache->output = NULL;
+}
+
+static bool SpuCacheMatch(const spu_cache_t *cache,
+                          unsigned count, subpicture_t *const *subpicture,
+                          const vlc_fourcc_t *chroma_list,
+                          const video_format_t *fmt_dst,
+                          const video_format_t *fmt_src)
+{
+    if (!cache->output || cache->count != count ||
+        memcmp(cache->subpicture, subpicture, count * sizeof(*subpicture)))
+        return false;
+
+    for (unsigned i = 0; i <= SPU_CACHE_CHROMA_MAX; i++) {
+        if (cache->chroma_list[i] != chroma_list[i])
+            return false;
+        if (chroma_list[i] == 0)
+            break;
+    }
+    return video_format_IsSimilar(&cache->fmt_dst, fmt_dst) &&
+           video_format_IsSimilar(&cache->fmt_src, fmt_src);
+}
+
+static void SpuCacheStore(spu_cache_t *cache, subpicture_t *output,
+                          unsigned count, subpicture_t *const *subpicture,
+                          const vlc_fourcc_t *chroma_list,
+                          const video_format_t *fmt_dst,
+                          const video_format_t *fmt_src)
+{
+    SpuCacheInvalidate(cache);
+
+    unsigned chroma_count = 0;
+    while (chroma_list[chroma_count] != 0)
+        if (++chroma_count > SPU_CACHE_CHROMA_MAX)
+            return;
+    memcpy(cache->chroma_list, chroma_list,
+           (chroma_count + 1) * sizeof(*chroma_list));
+
+    cache->output = output;
+    cache->count  = count;
+    memcpy(cache->subpicture, subpicture, count * sizeof(*subpicture));
+    cache->fmt_dst = *fmt_dst;
+    cache->fmt_dst.p_palette = NULL;
+    cache->fmt_src = *fmt_src;
+    cache->fmt_src.p_palette = NULL;
+}
+
+/**
+ * Duplicate the cached subpicture, sharing the pictures of its regions.
+ */
+static subpicture_t *SpuCacheGet(const spu_cache_t *cache)
+{
+    const subpicture_t *output = cache->output;
+
+    subpicture_t *dup = subpicture_New(NULL);
+    if (!dup)
+        return NULL;
+    dup->i_order = output->i_order;
+    dup->i_original_picture_width  = output->i_original_picture_width;
+    dup->i_original_picture_height = output->i_original_picture_height;
+
+    subpicture_region_t **last_ptr = &dup->p_region;
+    for (const subpicture_region_t *r = output->p_region; r != NULL; r = r->p_next) {
+        subpicture_region_t *region = SpuRegionNew(&r->fmt, r->p_picture);
+        if (!region)
+            break;
+        region->i_x     = r->i_x;
+        region->i_y     = r->i_y;
+        region->i_align = r->i_align;
+        region->i_alpha = r->i_alpha;
+
+        *last_ptr = region;
+        last_ptr  = &region->p_next;
+    }
+    return dup;
+}
+
 static void FilterRelease(filter_t *filter)
 {
     if (filter->p_module)
@@ -570,8 +694,10 @@ static void SpuSelectSubpictures(spu_t *spu,
             bool is_late;
 
             if (!current || entry->reject) {
-                if (entry->reject)
+                if (entry->reject) {
                     SpuHeapDeleteAt(&sys->heap, index);
+                    SpuCacheInvalidate(&sys->cache);
+                }
                 continue;
             }
 
@@ -635,10 +761,12 @@ static void SpuSelectSubpictures(spu_t *spu,
                     is_rejeted = true;
             }
 
-            if (is_rejeted)
+            if (is_rejeted) {
                 SpuHeapDeleteSubpicture(&sys->heap, current);
-            else
+                SpuCacheInvalidate(&sys->cache);
+            } else {
                 subpicture_array[(*subpicture_count)++] = current;
+            }
         }
     }
 
@@ -649,9 +777,12 @@ static void SpuSelectSubpictures(spu_t *spu,
 
 /**
  * It will transform the provided region into another region suitable for rendering.
+ *
+ * *cacheable is reset if the result depends on the rendering date.
  */
 static void SpuRenderRegion(spu_t *spu,
                             subpicture_region_t **dst_ptr, spu_area_t *dst_area,
+                            bool *cacheable,
                             subpicture_t *subpic, subpicture_region_t *region,
                             const spu_scale_t scale_size,
                             const vlc_fourcc_t *chroma_list,
@@ -905,16 +1036,15 @@ static void SpuRenderRegion(spu_t *spu,
         }
     }
 
-    subpicture_region_t *dst = *dst_ptr = subpicture_region_New(&region_fmt);
+    subpicture_region_t *dst = *dst_ptr = SpuRegionNew(&region_fmt, region_picture);
     if (dst) {
         dst->i_x       = x_offset;
         dst->i_y       = y_offset;
         dst->i_align   = 0;
-        if (dst->p_picture)
-            picture_Release(dst->p_picture);
-        dst->p_picture = picture_Hold(region_picture);
         int fade_alpha = 255;
         if (subpic->b_fade) {
+            *cacheable = false;
+
             mtime_t fade_start = subpic->i_start + 3 * (subpic->i_stop - subpic->i_start) / 4;
 
             if (fade_start <= render_date && fade_start < subpic->i_stop)
@@ -926,6 +1056,8 @@ static void SpuRenderRegion(spu_t *spu,
 
 exit:
     if (restore_text) {
+        *cacheable = false;
+
         /* Some forms of subtitles need to be re-rendered more than
          * once, eg. karaoke. We therefore restore the region to its
          * pre-rendered state, so the next time through everything is
@@ -945,8 +1077,11 @@ exit:
 
 /**
  * This function renders all sub picture units in the list.
+ *
+ * *cacheable tells if the result can be reused for the next dates.
  */
 static subpicture_t *SpuRenderSubpictures(spu_t *spu,
+                                          bool *cacheable,
                                           unsigned int i_subpicture,
                                           subpicture_t **pp_subpicture,
                                           const vlc_fourcc_t *chroma_list,
@@ -1028,6 +1163,8 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
          * We always transform non absolute subtitle into absolute one on the
          * first rendering to allow good subtitle overlap support.
          */
+        if (subpic->b_subtitle && !subpic->b_absolute)
+            *cacheable = false;
         for (region = subpic->p_region; region != NULL; region = region->p_next) {
             spu_area_t area;
 
@@ -1054,7 +1191,7 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
                 continue;
 
             /* */
-            SpuRenderRegion(spu, output_last_ptr, &area,
+            SpuRenderRegion(spu, output_last_ptr, &area, cacheable,
                             subpic, region, scale,
                             chroma_list, fmt_dst,
                             subtitle_area, subtitle_area_count,
@@ -1102,6 +1239,7 @@ static void UpdateSPU(spu_t *spu, vlc_object_t *object)
 
     sys->force_palette = false;
     sys->force_crop = false;
+    SpuCacheInvalidate(&sys->cache);
 
     if (var_Get(object, "highlight", &val) || !val.b_bool) {
         vlc_mutex_unlock(&sys->lock);
@@ -1198,6 +1336,7 @@ spu_t *spu_Create(vlc_object_t *object)
     vlc_mutex_init(&sys->lock);
 
     SpuHeapInit(&sys->heap);
+    SpuCacheInit(&sys->cache);
 
     sys->text = NULL;
     sys->scale = NULL;
@@ -1261,6 +1400,7 @@ void spu_Destroy(spu_t *spu)
     free(sys->filter_chain_update);
 
     /* Destroy all remaining subpictures */
+    SpuCacheInvalidate(&sys->cache);
     SpuHeapClean(&sys->heap);
 
     vlc_mutex_destroy(&sys->lock);
@@ -1287,6 +1427,7 @@ void spu_Attach(spu_t *spu, vlc_object_t *input, bool attach)
         if (spu->p->text)
             FilterRelease(spu->p->text);
         spu->p->text = SpuRenderCreateAndLoadText(spu);
+        SpuCacheInvalidate(&spu->p->cache);
 
         vlc_mutex_unlock(&spu->p->lock);
     } else {
@@ -1394,6 +1535,7 @@ void spu_PutSubpicture(spu_t *spu, subpicture_t *subpic)
         subpicture_Delete(subpic);
         return;
     }
+    SpuCacheInvalidate(&sys->cache);
     vlc_mutex_unlock(&sys->lock);
 }
 
@@ -1464,23 +1606,42 @@ subpicture_t *spu_Render(spu_t *spu,
     /* Updates the subpictures */
     for (unsigned i = 0; i < subpicture_count; i++) {
         subpicture_t *subpic = subpicture_array[i];
-        subpicture_Update(subpic,
-                          fmt_src, fmt_dst,
-                          subpic->b_subtitle ? render_subtitle_date : render_osd_date);
+        if (subpicture_Update(subpic,
+                              fmt_src, fmt_dst,
+                              subpic->b_subtitle ? render_subtitle_date : render_osd_date))
+            SpuCacheInvalidate(&sys->cache);
     }
 
     /* Now order the subpicture array
      * XXX The order is *really* important for overlap subtitles positionning */
     qsort(subpicture_array, subpicture_count, sizeof(*subpicture_array), SubpictureCmp);
 
+    /* Reuse the previous rendering if nothing has changed since */
+    if (SpuCacheMatch(&sys->cache, subpicture_count, subpicture_array,
+                      chroma_list, fmt_dst, fmt_src)) {
+        subpicture_t *render = SpuCacheGet(&sys->cache);
+        vlc_mutex_unlock(&sys->lock);
+        return render;
+    }
+
     /* Render the subpictures */
-    subpicture_t *render = SpuRenderSubpictures(spu,
+    bool cacheable = true;
+    subpicture_t *render = SpuRenderSubpictures(spu, &cacheable,
                                                 subpicture_count, subpicture_array,
                                                 chroma_list,
                                                 fmt_dst,
                                                 fmt_src,
                                                 render_subtitle_date,
                                                 render_osd_date);
+    if (render && cacheable) {
+        SpuCacheStore(&sys->cache, render,
+                      subpicture_count, subpicture_array,
+                      chroma_list, fmt_dst, fmt_src);
+        if (sys->cache.output == render)
+            render = SpuCacheGet(&sys->cache);
+    } else {
+        SpuCacheInvalidate(&sys->cache);
+    }
     vlc_mutex_unlock(&sys->lock);
 
     return render;
@@ -1568,6 +1729,7 @@ void spu_ChangeMargin(spu_t *spu, int margin)
 
     vlc_mutex_lock(&sys->lock);
     sys->margin = margin;
+    SpuCacheInvalidate(&sys->cache);
     vlc_mutex_unlock(&sys->lock);
 }
 
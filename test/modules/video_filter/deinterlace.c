@@ -0,0 +1,476 @@
+/*****************************************************************************
+ * deinterlace.c: deinterlacer SIMD kernels tests and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Checks that the SIMD versions of the yadif, X and merge kernels give the
+ * same output as their reference version, and prints their throughput.
+ * The number of benchmarked frames can be given as argument. */
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <string.h>
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include "../modules/video_filter/deinterlace/merge.h"
+#include "../modules/video_filter/deinterlace/algo_x.c"
+#include "../modules/video_filter/deinterlace/algo_yadif.c"
+
+#define WIDTH  1920
+#define HEIGHT 1080
+#define MARGIN 64 /* pixels read or written around the lines by the kernels */
+#define PITCH  (WIDTH + 2 * MARGIN)
+#define LINES  (HEIGHT + 16)
+
+static unsigned frames = 2;
+
+typedef struct
+{
+    uint8_t *base;
+    uint8_t *pixels; /* first visible pixel */
+} plane_buffer_t;
+
+static void plane_Alloc( plane_buffer_t *p, size_t i_pixel_size )
+{
+    p->base = malloc( PITCH * LINES * i_pixel_size );
+    assert( p->base != NULL );
+    memset( p->base, 0, PITCH * LINES * i_pixel_size );
+    p->pixels = p->base + MARGIN * i_pixel_size;
+}
+
+static uint32_t seed = 1;
+
+static unsigned Rand( void )
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+/* Smooth pictures with noise, and moving details on odd lines so that
+ * all the branches of the kernels are taken */
+static void FillPicture( plane_buffer_t *p, int i_frame, unsigned i_max,
+                         size_t i_pixel_size )
+{
+    for( int y = 0; y < LINES; y++ )
+        for( int x = -MARGIN; x < PITCH - MARGIN; x++ )
+        {
+            unsigned v = (x + 2 * y + 7 * i_frame) % (i_max + 1);
+            if( (y & 1) && ((x + 13 * i_frame) / 24) % 3 == 0 )
+                v = i_max - v;
+            v = (v + Rand() % (i_max / 16 + 1)) % (i_max + 1);
+            if( i_pixel_size == 1 )
+                p->pixels[y * PITCH + x] = v;
+            else
+                ((uint16_t *)p->pixels)[y * PITCH + x] = v;
+        }
+}
+
+static void CheckSame( const char *psz_name, const plane_buffer_t *ref,
+                       const plane_buffer_t *out, int i_width,
+                       size_t i_pixel_size )
+{
+    for( int y = 0; y < HEIGHT; y++ )
+        if( memcmp( &ref->pixels[y * PITCH * i_pixel_size],
+                    &out->pixels[y * PITCH * i_pixel_size],
+                    i_width * i_pixel_size ) )
+        {
+            fprintf( stderr, "%s: line %d differs\n", psz_name, y );
+            abort();
+        }
+}
+
+static void PrintSpeed( const char *psz_kernel, const char *psz_name,
+                        mtime_t i_duration, unsigned i_frames )
+{
+    printf( "%-6s %-8s %8.3f ms/frame\n", psz_kernel, psz_name,
+            i_duration / 1000. / i_frames );
+}
+
+/*****************************************************************************
+ * Yadif
+ *****************************************************************************/
+typedef void (*yadif_line_t)( void *dst, void *prev, void *cur, void *next,
+                              int w, int prefs, int mrefs, int parity,
+                              int mode );
+
+typedef struct
+{
+    const char *psz_name;
+    yadif_line_t pf_line;
+    bool b_available;
+} yadif_kernel_t;
+
+static void RenderYadifPlane( yadif_line_t pf_line, plane_buffer_t *dst,
+                              plane_buffer_t *pic, int i_width,
+                              int i_parity, size_t i_pixel_size )
+{
+    const int i_pitch = PITCH * i_pixel_size;
+
+    for( int y = 1; y < HEIGHT - 1; y += 2 )
+    {
+        const int mode = (y >= 2 && y < HEIGHT - 2) ? 0 : 2;
+        const int o = y * i_pitch;
+
+        pf_line( &dst->pixels[o], &pic[0].pixels[o], &pic[1].pixels[o],
+                 &pic[2].pixels[o], i_width,
+                 y < HEIGHT - 2 ? i_pitch : -i_pitch,
+                 y - 1 ? -i_pitch : i_pitch, i_parity, mode );
+    }
+}
+
+static void TestYadif( const yadif_kernel_t *kernels, size_t i_count,
+                       unsigned i_max, size_t i_pixel_size )
+{
+    plane_buffer_t pic[3], ref, out;
+
+    for( int i = 0; i < 3; i++ )
+    {
+        plane_Alloc( &pic[i], i_pixel_size );
+        FillPicture( &pic[i], i, i_max, i_pixel_size );
+    }
+    plane_Alloc( &ref, i_pixel_size );
+    plane_Alloc( &out, i_pixel_size );
+
+    /* Also check widths which are not multiple of the vector sizes */
+    for( int i_width = WIDTH - 7; i_width <= WIDTH; i_width += 7 )
+        for( int i_parity = 0; i_parity < 2; i_parity++ )
+        {
+            RenderYadifPlane( kernels[0].pf_line, &ref, pic, i_width,
+                              i_parity, i_pixel_size );
+            for( size_t k = 1; k < i_count; k++ )
+            {
+                if( !kernels[k].b_available )
+                    continue;
+                RenderYadifPlane( kernels[k].pf_line, &out, pic, i_width,
+                                  i_parity, i_pixel_size );
+                EndMMX();
+                CheckSame( kernels[k].psz_name, &ref, &out, i_width,
+                           i_pixel_size );
+            }
+        }
+
+    for( size_t k = 0; k < i_count; k++ )
+    {
+        if( !kernels[k].b_available )
+            continue;
+
+        mtime_t i_start = mdate();
+        for( unsigned i = 0; i < frames; i++ )
+            RenderYadifPlane( kernels[k].pf_line, &out, pic, WIDTH, i & 1,
+                              i_pixel_size );
+        EndMMX();
+        PrintSpeed( i_pixel_size == 1 ? "yadif" : "yadif16",
+                    kernels[k].psz_name, mdate() - i_start, frames );
+    }
+
+    for( int i = 0; i < 3; i++ )
+        free( pic[i].base );
+    free( ref.base );
+    free( out.base );
+}
+
+static void plane_Wrap( picture_t *p_pic, plane_buffer_t *p,
+                        size_t i_pixel_size )
+{
+    p_pic->i_planes = 1;
+    p_pic->p[0] = (plane_t) {
+        .p_pixels = p->pixels,
+        .i_lines = LINES,
+        .i_pitch = PITCH * i_pixel_size,
+        .i_pixel_pitch = i_pixel_size,
+        .i_visible_lines = HEIGHT,
+        .i_visible_pitch = WIDTH * i_pixel_size,
+    };
+}
+
+/* Checks that YadifSlice() gives the same output by slices as in one go */
+static void TestYadifSlices( const yadif_kernel_t *kernels, size_t i_count,
+                             unsigned i_max, size_t i_pixel_size )
+{
+    plane_buffer_t pic[3], ref, out;
+    picture_t pictures[3], ref_pic, out_pic;
+
+    for( int i = 0; i < 3; i++ )
+    {
+        plane_Alloc( &pic[i], i_pixel_size );
+        FillPicture( &pic[i], i, i_max, i_pixel_size );
+        plane_Wrap( &pictures[i], &pic[i], i_pixel_size );
+    }
+    plane_Alloc( &ref, i_pixel_size );
+    plane_Wrap( &ref_pic, &ref, i_pixel_size );
+    plane_Alloc( &out, i_pixel_size );
+    plane_Wrap( &out_pic, &out, i_pixel_size );
+
+    for( size_t k = 0; k < i_count; k++ )
+    {
+        if( !kernels[k].b_available )
+            continue;
+
+        for( int i_parity = 0; i_parity < 2; i_parity++ )
+        {
+            yadif_slice_t job = {
+                .p_dst = &ref_pic, .p_prev = &pictures[0],
+                .p_cur = &pictures[1], .p_next = &pictures[2],
+                .filter = (yadif_filter_t)kernels[k].pf_line,
+                .i_pixel_size = i_pixel_size,
+                .i_field = i_parity, .parity = i_parity,
+            };
+
+            YadifSlice( &job, 0, 1 );
+
+            /* Backwards, so that writes past the lines of a slice are not
+             * overwritten by the next slice */
+            const unsigned i_slices = 7;
+            job.p_dst = &out_pic;
+            for( unsigned i = i_slices; i-- > 0; )
+                YadifSlice( &job, i, i_slices );
+            EndMMX();
+            CheckSame( kernels[k].psz_name, &ref, &out, WIDTH,
+                       i_pixel_size );
+        }
+    }
+
+    for( int i = 0; i < 3; i++ )
+        free( pic[i].base );
+    free( ref.base );
+    free( out.base );
+}
+
+/*****************************************************************************
+ * X
+ *****************************************************************************/
+typedef void (*x_band_t)( uint8_t *dst, int i_dst, uint8_t *src, int i_src,
+                          const int i_mbx, int i_modx );
+
+typedef struct
+{
+    const char *psz_name;
+    x_band_t pf_band;
+    bool b_available;
+} x_kernel_t;
+
+static void RenderXPlane( x_band_t pf_band, plane_buffer_t *dst,
+                          plane_buffer_t *src, int i_width )
+{
+    for( int y = 0; y < HEIGHT / 8; y++ )
+        pf_band( &dst->pixels[8 * y * PITCH], PITCH,
+                 &src->pixels[8 * y * PITCH], PITCH, i_width / 8, i_width % 8 );
+}
+
+static void TestX( const x_kernel_t *kernels, size_t i_count )
+{
+    plane_buffer_t src, ref, out;
+
+    plane_Alloc( &src, 1 );
+    plane_Alloc( &ref, 1 );
+    plane_Alloc( &out, 1 );
+    FillPicture( &src, 0, 255, 1 );
+
+    /* The C version does not detect interlacing exactly as the SIMD ones:
+     * those are checked against the first available one */
+    const x_kernel_t *p_ref = NULL;
+    for( size_t k = 1; k < i_count; k++ )
+    {
+        if( !kernels[k].b_available )
+            continue;
+
+        if( p_ref == NULL )
+        {
+            p_ref = &kernels[k];
+            RenderXPlane( p_ref->pf_band, &ref, &src, WIDTH - 3 );
+            EndMMX();
+            continue;
+        }
+        RenderXPlane( kernels[k].pf_band, &out, &src, WIDTH - 3 );
+        EndMMX();
+        CheckSame( kernels[k].psz_name, &ref, &out, WIDTH - 3, 1 );
+    }
+
+    for( size_t k = 0; k < i_count; k++ )
+    {
+        if( !kernels[k].b_available )
+            continue;
+
+        mtime_t i_start = mdate();
+        for( unsigned i = 0; i < frames; i++ )
+            RenderXPlane( kernels[k].pf_band, &out, &src, WIDTH );
+        EndMMX();
+        PrintSpeed( "x", kernels[k].psz_name, mdate() - i_start, frames );
+    }
+
+    free( src.base );
+    free( ref.base );
+    free( out.base );
+}
+
+/*****************************************************************************
+ * Merge
+ *****************************************************************************/
+typedef void (*merge_t)( void *, const void *, const void *, size_t );
+
+typedef struct
+{
+    const char *psz_name;
+    merge_t pf_merge;
+    bool b_available;
+} merge_kernel_t;
+
+static void RenderMergePlane( merge_t pf_merge, plane_buffer_t *dst,
+                              plane_buffer_t *src, int i_offset, int i_width,
+                              size_t i_pixel_size )
+{
+    const int i_pitch = PITCH * i_pixel_size;
+
+    for( int y = 0; y < HEIGHT - 1; y++ )
+        pf_merge( &dst->pixels[y * i_pitch + i_offset],
+                  &src->pixels[y * i_pitch + i_offset],
+                  &src->pixels[(y + 1) * i_pitch + i_offset],
+                  i_width * i_pixel_size );
+}
+
+static void TestMerge( const merge_kernel_t *kernels, size_t i_count,
+                       size_t i_pixel_size )
+{
+    plane_buffer_t src, ref, out;
+
+    plane_Alloc( &src, i_pixel_size );
+    plane_Alloc( &ref, i_pixel_size );
+    plane_Alloc( &out, i_pixel_size );
+    FillPicture( &src, 0, i_pixel_size == 1 ? 255 : 1023, i_pixel_size );
+
+    /* The SIMD versions round up, unlike the C version. Misaligned lines
+     * check that the SIMD versions agree with each other. */
+    for( int i_offset = 0; i_offset < 40; i_offset += 3 * (int)i_pixel_size )
+    {
+        const merge_kernel_t *p_ref = NULL;
+
+        for( size_t k = 1; k < i_count; k++ )
+        {
+            if( !kernels[k].b_available )
+                continue;
+
+            if( p_ref == NULL )
+            {
+                p_ref = &kernels[k];
+                RenderMergePlane( p_ref->pf_merge, &ref, &src, i_offset,
+                                  WIDTH - 5, i_pixel_size );
+                continue;
+            }
+            RenderMergePlane( kernels[k].pf_merge, &out, &src, i_offset,
+                              WIDTH - 5, i_pixel_size );
+            CheckSame( kernels[k].psz_name, &ref, &out, WIDTH - 5,
+                       i_pixel_size );
+        }
+        EndMMX();
+    }
+
+    for( size_t k = 0; k < i_count; k++ )
+    {
+        if( !kernels[k].b_available )
+            continue;
+
+        mtime_t i_start = mdate();
+        for( unsigned i = 0; i < frames; i++ )
+            RenderMergePlane( kernels[k].pf_merge, &out, &src, 0, WIDTH,
+                              i_pixel_size );
+        EndMMX();
+        PrintSpeed( i_pixel_size == 1 ? "merge" : "merge16",
+                    kernels[k].psz_name, mdate() - i_start, frames );
+    }
+
+    free( src.base );
+    free( ref.base );
+    free( out.base );
+}
+
+int main( int argc, char *argv[] )
+{
+    test_init();
+
+    if( argc > 1 )
+    {
+        frames = strtoul( argv[1], NULL, 0 );
+        alarm( 0 );
+    }
+
+    const yadif_kernel_t yadif[] = {
+        { "C", (yadif_line_t)yadif_filter_line_c, true },
+#if defined(HAVE_YADIF_MMX)
+        { "MMX", (yadif_line_t)yadif_filter_line_mmx, vlc_CPU_MMX() },
+#endif
+#if defined(HAVE_YADIF_SSE2)
+        { "SSE2", (yadif_line_t)yadif_filter_line_sse2, vlc_CPU_SSE2() },
+#endif
+#if defined(HAVE_YADIF_SSSE3)
+        { "SSSE3", (yadif_line_t)yadif_filter_line_ssse3, vlc_CPU_SSSE3() },
+#endif
+#if defined(HAVE_YADIF_AVX2)
+        { "AVX2", (yadif_line_t)yadif_filter_line_avx2, vlc_CPU_AVX2() },
+#endif
+    };
+    TestYadif( yadif, ARRAY_SIZE(yadif), 255, 1 );
+    TestYadifSlices( yadif, ARRAY_SIZE(yadif), 255, 1 );
+
+    const yadif_kernel_t yadif16[] = {
+        { "C", (yadif_line_t)yadif_filter_line_c_16bit, true },
+#if defined(HAVE_YADIF_AVX2)
+        { "AVX2", (yadif_line_t)yadif_filter_line_avx2_16bit, vlc_CPU_AVX2() },
+#endif
+    };
+    TestYadif( yadif16, ARRAY_SIZE(yadif16), 1023, 2 );
+    TestYadif( yadif16, ARRAY_SIZE(yadif16), 65535, 2 );
+    TestYadifSlices( yadif16, ARRAY_SIZE(yadif16), 1023, 2 );
+
+    const x_kernel_t x[] = {
+        { "C", XDeintBand8x8C, true },
+#if defined(CAN_COMPILE_MMXEXT)
+        { "MMXEXT", XDeintBand8x8MMXEXT, vlc_CPU_MMXEXT() },
+#endif
+#if defined(CAN_COMPILE_AVX2)
+        { "AVX2", XDeintBand8x8AVX2, vlc_CPU_AVX2() },
+#endif
+    };
+    TestX( x, ARRAY_SIZE(x) );
+
+    const merge_kernel_t merge[] = {
+        { "C", Merge8BitGeneric, true },
+#if defined(CAN_COMPILE_SSE)
+        { "SSE2", Merge8BitSSE2, vlc_CPU_SSE2() },
+#endif
+#if defined(CAN_COMPILE_AVX2)
+        { "AVX2", Merge8BitAVX2, vlc_CPU_AVX2() },
+#endif
+    };
+    TestMerge( merge, ARRAY_SIZE(merge), 1 );
+
+    const merge_kernel_t merge16[] = {
+        { "C", Merge16BitGeneric, true },
+#if defined(CAN_COMPILE_SSE)
+        { "SSE2", Merge16BitSSE2, vlc_CPU_SSE2() },
+#endif
+#if defined(CAN_COMPILE_AVX2)
+        { "AVX2", Merge16BitAVX2, vlc_CPU_AVX2() },
+#endif
+    };
+    TestMerge( merge16, ARRAY_SIZE(merge16), 2 );
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*****************************************************************************
+ * fifo.c test block FIFOs
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <assert.h>
+
+#define BLOCKS 100000
+
+static void test_order(block_fifo_t *fifo)
+{
+    block_t *chain = NULL, **pp = &chain;
+    int64_t expected[1001];
+    unsigned n = 0;
+    size_t bytes = 0;
+
+    /* enough blocks to overflow the lock-free ring, some as chains */
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        block_t *b = block_Alloc(i % 17);
+        assert(b != NULL);
+        b->i_dts = i;
+        bytes += i % 17;
+
+        if (i % 3)
+        {
+            block_FifoPut(fifo, b);
+            expected[n++] = i;
+        }
+        else
+        {
+            *pp = b;
+            pp = &b->p_next;
+        }
+
+        if (i % 10 == 9 || i == 999)
+        {
+            for (block_t *c = chain; c != NULL; c = c->p_next)
+                expected[n++] = c->i_dts;
+            block_FifoPut(fifo, chain);
+            chain = NULL;
+            pp = &chain;
+        }
+    }
+    assert(n == 1000);
+    vlc_fifo_Lock(fifo);
+    assert(vlc_fifo_GetCount(fifo) == 1000);
+    assert(vlc_fifo_GetBytes(fifo) == bytes);
+    vlc_fifo_Unlock(fifo);
+
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        if (i == 500)
+        {   /* queue more while the overflow list is still in use */
+            block_t *b = block_Alloc(0);
+            b->i_dts = 1000;
+            block_FifoPut(fifo, b);
+            expected[n++] = 1000;
+        }
+
+        block_t *b = block_FifoShow(fifo);
+        assert(b->i_dts == expected[i]);
+        b = block_FifoGet(fifo);
+        assert(b->p_next == NULL);
+        assert(b->i_dts == expected[i]);
+        block_Release(b);
+    }
+
+    block_t *b = block_FifoGet(fifo);
+    assert(b->i_dts == expected[1000]);
+    block_Release(b);
+
+    vlc_fifo_Lock(fifo);
+    assert(vlc_fifo_IsEmpty(fifo));
+    assert(vlc_fifo_GetBytes(fifo) == 0);
+    vlc_fifo_Unlock(fifo);
+
+    for (unsigned i = 0; i < 400; i++)
+        block_FifoPut(fifo, block_Alloc(1));
+    assert(block_FifoCount(fifo) == 400);
+    block_FifoEmpty(fifo);
+    assert(block_FifoCount(fifo) == 0);
+}
+
+static block_t blocks[BLOCKS];
+
+static void *producer(void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+        block_FifoPut(fifo, &blocks[i]);
+    return NULL;
+}
+
+static void init_blocks(void)
+{
+    for (unsigned i = 0; i < BLOCKS; i++)
+        block_Init(&blocks[i], NULL, 0);
+}
+
+/* Measures the FIFO itself (the blocks are allocated beforehand),
+ * without contention */
+static mtime_t test_single(block_fifo_t *fifo)
+{
+    init_blocks();
+
+    mtime_t start = mdate();
+
+    for (unsigned i = 0; i < BLOCKS; i += 64)
+    {
+        for (unsigned j = i; j < i + 64 && j < BLOCKS; j++)
+            block_FifoPut(fifo, &blocks[j]);
+        for (unsigned j = i; j < i + 64 && j < BLOCKS; j++)
+            assert(block_FifoGet(fifo) == &blocks[j]);
+    }
+    return mdate() - start;
+}
+
+/* Same with one producer and one consumer thread */
+static mtime_t test_threads(block_fifo_t *fifo)
+{
+    vlc_thread_t th;
+
+    init_blocks();
+
+    mtime_t start = mdate();
+
+    if (vlc_clone(&th, producer, fifo, VLC_THREAD_PRIORITY_LOW))
+        abort();
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+        assert(block_FifoGet(fifo) == &blocks[i]);
+
+    vlc_join(th, NULL);
+    assert(block_FifoCount(fifo) == 0);
+    return mdate() - start;
+}
+
+int main(void)
+{
+    test_init();
+
+    block_fifo_t *fifo = block_FifoNew();
+    block_fifo_t *spsc = block_FifoNewSPSC();
+    assert(fifo != NULL && spsc != NULL);
+
+    test_order(fifo);
+    test_order(spsc);
+
+    mtime_t locked = test_single(fifo);
+    mtime_t lockfree = test_single(spsc);
+
+    printf("%u blocks, one thread: locked %"PRId64" us, "
+           "single producer %"PRId64" us\n", BLOCKS, locked, lockfree);
+
+    locked = test_threads(fifo);
+    lockfree = test_threads(spsc);
+
+    printf("%u blocks, two threads: locked %"PRId64" us, "
+           "single producer %"PRId64" us\n", BLOCKS, locked, lockfree);
+
+    block_FifoRelease(spsc);
+    block_FifoRelease(fifo);
+    return 0;
+}
@@ -448,6 +448,88 @@ static void test_creation_and_type( libvlc_int_t *p_libvlc )
     assert( var_Get( p_libvlc, "bla", &val ) == VLC_ENOVAR );
 }
 
+#define MANY_COUNT 1000
+
+static void test_many( libvlc_int_t *p_libvlc )
+{
+    static bool created[MANY_COUNT];
+    char name[16];
+
+    /* Random creations and destructions, checking all the variables */
+    for( unsigned round = 0; round < 4 * MANY_COUNT; round++ )
+    {
+        unsigned i = rand() % MANY_COUNT;
+
+        snprintf( name, sizeof (name), "many-%u", i );
+        if( created[i] )
+            var_Destroy( p_libvlc, name );
+        else
+        {
+            var_Create( p_libvlc, name, VLC_VAR_INTEGER );
+            var_SetInteger( p_libvlc, name, i );
+        }
+        created[i] = !created[i];
+
+        if( round % 64 )
+            continue;
+        for( i = 0; i < MANY_COUNT; i++ )
+        {
+            snprintf( name, sizeof (name), "many-%u", i );
+            if( created[i] )
+                assert( var_GetInteger( p_libvlc, name ) == i );
+            else
+                assert( var_Type( p_libvlc, name ) == 0 );
+        }
+    }
+
+    for( unsigned i = 0; i < MANY_COUNT; i++ )
+    {
+        snprintf( name, sizeof (name), "many-%u", i );
+        if( created[i] )
+            var_Destroy( p_libvlc, name );
+        assert( var_Type( p_libvlc, name ) == 0 );
+    }
+}
+
+static void bench_lookup( libvlc_int_t *p_libvlc, unsigned count )
+{
+    char names[64][16];
+    const unsigned loops = 200000;
+
+    for( unsigned i = 0; i < count; i++ )
+    {
+        char name[16];
+        snprintf( name, sizeof (name), "bench-%u", i );
+        var_Create( p_libvlc, name, VLC_VAR_INTEGER );
+    }
+    for( unsigned i = 0; i < 64; i++ )
+        snprintf( names[i], sizeof (names[i]), "bench-%u", i * count / 64 );
+
+    mtime_t start = mdate();
+    int64_t sum = 0;
+    for( unsigned i = 0; i < loops; i++ )
+        sum += var_GetInteger( p_libvlc, names[i % 64] );
+    mtime_t duration = mdate() - start;
+    assert( sum == 0 );
+
+    log( "  %u extra variables: %"PRId64" ns per lookup\n", count,
+         duration * 1000 / loops );
+
+    for( unsigned i = 0; i < count; i++ )
+    {
+        char name[16];
+        snprintf( name, sizeof (name), "bench-%u", i );
+        var_Destroy( p_libvlc, name );
+    }
+}
+
+static void test_lookup_speed( libvlc_int_t *p_libvlc )
+{
+    bench_lookup( p_libvlc, 64 );
+    bench_lookup( p_libvlc, 1024 );
+    bench_lookup( p_libvlc, 16384 );
+}
+
 static void test_variables( libvlc_instance_t *p_vlc )
 {
     libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
@@ -485,6 +567,12 @@ static void test_variables( libvlc_instance_t *p_vlc )
 
     log( "Testing type at creation\n" );
     test_creation_and_type( p_libvlc );
+
+    log( "Testing many variables\n" );
+    test_many( p_libvlc );
+
+    log( "Testing lookup speed\n" );
+    test_lookup_speed( p_libvlc );
 }
 
 